@@ -54,6 +54,17 @@
 #define UP_CPU_THRESHOLD		11
 #define MAX_CPU_THRESHOLD		20
 #define CPU_SLOPE_SIZE			7
+#define BURST_WINDOW_US			10000
+
+/*
+ * Bytes moved per clock: two 32-bit LPDDR2 channels at double data rate
+ * behind the MIF, one 64-bit channel per direction on an INT port. The
+ * efficiencies leave room for refresh, bank conflicts and arbitration.
+ */
+#define MIF_BYTES_PER_CYCLE		16
+#define INT_BYTES_PER_CYCLE		8
+#define MIF_EFFICIENCY			50
+#define INT_EFFICIENCY			70
 
 static unsigned int dmc_max_threshold;
 static bool mif_locking;
@@ -692,9 +703,85 @@ struct opp *exynos4x12_monitor(struct busfreq_data *data)
 
 	opp = opp_find_freq_ceil(data->dev, &newfreq);
 
+	data->load = dmc_load;
+
 	return opp;
 }
 
+/*
+ * Level for a burst of load percent measured by PPMU id over the last
+ * overflow period. Mirrors the up-scaling part of exynos4x12_monitor()
+ * without the history, which is what delays ramps there.
+ */
+struct opp *exynos4x12_burst(struct busfreq_data *data, int id,
+			unsigned int load)
+{
+	unsigned long currfreq = opp_get_freq(data->curr_opp) / 1000;
+	unsigned long maxfreq = opp_get_freq(data->max_opp) / 1000;
+	unsigned long dmc_load, dmcfreq;
+
+	if (id == PPMU_CPU)
+		return load >= MAX_CPU_THRESHOLD ? data->max_opp : data->curr_opp;
+
+	dmc_load = div64_u64((u64)load * currfreq, maxfreq);
+	if (dmc_load >= dmc_max_threshold)
+		return data->max_opp;
+
+	dmcfreq = div64_u64(maxfreq * dmc_load * 1000, dmc_max_threshold);
+
+	return opp_find_freq_ceil(data->dev, &dmcfreq);
+}
+
+/*
+ * Events after which PPMU id interrupts: the count at the load above
+ * which exynos4x12_burst() picks a higher level, over BURST_WINDOW_US.
+ */
+unsigned int exynos4x12_burst_count(struct busfreq_data *data, int id)
+{
+	unsigned long currfreq = opp_get_freq(data->curr_opp) / 1000;
+	unsigned int threshold;
+
+	if (data->curr_opp == data->max_opp)
+		return 0;
+
+	threshold = id == PPMU_CPU ? MAX_CPU_THRESHOLD : dmc_max_threshold;
+
+	return currfreq * BURST_WINDOW_US / 100 * threshold;
+}
+
+/*
+ * Levels are named MIF MHz * 1000 + INT MHz. MHz times bytes per cycle
+ * is MB/s.
+ */
+unsigned long exynos4x12_bw_to_freq(struct busfreq_data *data,
+			unsigned long mif_mbps, unsigned long int_mbps)
+{
+	unsigned long freq, mif_mhz, int_mhz;
+	struct opp *opp;
+	int i;
+
+	for (i = LV_END - 1; i >= 0; i--) {
+		freq = exynos4_busfreq_table[i].mem_clk;
+		if (freq > opp_get_freq(data->max_opp))
+			break;
+
+		opp = opp_find_freq_exact(data->dev, freq, true);
+		if (IS_ERR(opp))
+			continue;
+
+		mif_mhz = freq / 1000;
+		int_mhz = freq % 1000;
+
+		if (mif_mhz * MIF_BYTES_PER_CYCLE * MIF_EFFICIENCY / 100 >=
+		    mif_mbps &&
+		    int_mhz * INT_BYTES_PER_CYCLE * INT_EFFICIENCY / 100 >=
+		    int_mbps)
+			return freq;
+	}
+
+	return opp_get_freq(data->max_opp);
+}
+
 #define ARM_INT_CORRECTION 160160
 
 static int exynos4x12_busfreq_cpufreq_transition(struct notifier_block *nb,
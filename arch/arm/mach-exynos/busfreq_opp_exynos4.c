@@ -47,12 +47,16 @@
 #include <plat/cpu.h>
 #include <plat/clock.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/busfreq.h>
+
 #define BUSFREQ_DEBUG	1
 
 static DEFINE_MUTEX(busfreq_lock);
 
 struct busfreq_control {
 	struct opp *opp_lock;
+	struct opp *opp_limit;		/* ceiling, e.g. thermal */
 	struct device *dev;
 	struct busfreq_data *data;
 	bool init_done;
@@ -150,13 +154,64 @@ static unsigned int _target(struct busfreq_data *data, struct opp *new)
 	return index;
 }
 
+/*
+ * Arms the PPMU overflow interrupts for the current level. Called with
+ * busfreq_lock held.
+ */
+static void exynos_busfreq_arm(struct busfreq_data *data)
+{
+	unsigned int count;
+	int i;
+
+	for (i = 0; i < PPMU_END; i++) {
+		if (!(data->burst_irq & (1 << i)))
+			continue;
+
+		count = data->use ? data->burst_count(data, i) : 0;
+		exynos4_ppmu_set_overflow(&exynos_ppmu[i], 3, count);
+	}
+}
+
+/*
+ * Applies the ceiling to a level picked from the load or a device lock. A
+ * fixed level from force_opp or the user lock is left alone.
+ */
+static struct opp *exynos_busfreq_limit_opp(struct busfreq_data *data,
+					    struct opp *opp)
+{
+	if (bus_ctrl.opp_limit && !data->force_opp && !bus_ctrl.opp_lock &&
+	    opp_get_freq(opp) > opp_get_freq(bus_ctrl.opp_limit))
+		return bus_ctrl.opp_limit;
+
+	return opp;
+}
+
+/* Called with busfreq_lock held. */
+static void exynos_busfreq_set(struct busfreq_data *data, struct opp *opp,
+			       bool burst)
+{
+	unsigned long old_freq = opp_get_freq(data->curr_opp);
+	unsigned int index;
+
+	opp = exynos_busfreq_limit_opp(data, opp);
+
+	index = _target(data, opp);
+	update_busfreq_stat(data, index);
+
+	if (opp_get_freq(data->curr_opp) != old_freq)
+		trace_busfreq_target(old_freq, opp_get_freq(data->curr_opp),
+				     data->load, burst);
+
+	exynos_busfreq_arm(data);
+}
+
 static void exynos_busfreq_timer(struct work_struct *work)
 {
 	struct delayed_work *delayed_work = to_delayed_work(work);
 	struct busfreq_data *data = container_of(delayed_work, struct busfreq_data,
 			worker);
 	struct opp *opp;
-	unsigned int index;
+	unsigned long lockfreq;
 
 	opp = data->monitor(data);
 
@@ -164,19 +219,82 @@ static void exynos_busfreq_timer(struct work_struct *work)
 
 	mutex_lock(&busfreq_lock);
 
+	/*
+	 * Load increases are handled as they happen by the overflow
+	 * interrupts; the averaged samples only lower the level, or raise
+	 * it for a device lock.
+	 */
+	if (data->burst_only_up &&
+	    opp_get_freq(opp) > opp_get_freq(data->curr_opp)) {
+		lockfreq = dev_max_freq(data->dev);
+		if (lockfreq > opp_get_freq(data->curr_opp))
+			opp = opp_find_freq_ceil(data->dev, &lockfreq);
+		else
+			opp = data->curr_opp;
+	}
+
 	if (data->force_opp)
 		opp = data->force_opp;
 
 	if (bus_ctrl.opp_lock)
 		opp = bus_ctrl.opp_lock;
 
-	index = _target(data, opp);
+	exynos_busfreq_set(data, opp, false);
 
-	update_busfreq_stat(data, index);
 	mutex_unlock(&busfreq_lock);
 	queue_delayed_work(system_freezable_wq, &data->worker, data->sampling_rate);
 }
 
+static void exynos_busfreq_burst(struct work_struct *work)
+{
+	struct busfreq_data *data = container_of(work, struct busfreq_data,
+			burst_work);
+	struct opp *opp, *new;
+	unsigned int load;
+	int i;
+
+	mutex_lock(&busfreq_lock);
+
+	opp = data->curr_opp;
+	for (i = 0; i < PPMU_END; i++) {
+		load = xchg(&data->burst_load[i], 0);
+		if (!load)
+			continue;
+
+		new = data->burst(data, i, load);
+		if (opp_get_freq(new) > opp_get_freq(opp)) {
+			opp = new;
+			data->load = load;
+		}
+	}
+
+	if (!data->use || data->force_opp || bus_ctrl.opp_lock ||
+	    opp == data->curr_opp)
+		goto out;
+
+	exynos_busfreq_set(data, opp, true);
+out:
+	mutex_unlock(&busfreq_lock);
+}
+
+static irqreturn_t exynos_busfreq_ppmu_irq(int irq, void *dev_id)
+{
+	struct exynos4_ppmu_hw *ppmu = dev_id;
+	struct busfreq_data *data = bus_ctrl.data;
+	int load;
+
+	load = exynos4_ppmu_overflow(ppmu, 3);
+	if (load < 0)
+		return IRQ_NONE;
+
+	if (load > data->burst_load[ppmu->id])
+		data->burst_load[ppmu->id] = load;
+
+	queue_work(system_freezable_wq, &data->burst_work);
+
+	return IRQ_HANDLED;
+}
+
 static int exynos_buspm_notifier_event(struct notifier_block *this,
 		unsigned long event, void *ptr)
 {
@@ -187,8 +305,9 @@ static int exynos_buspm_notifier_event(struct notifier_block *this,
 	case PM_SUSPEND_PREPARE:
 		mutex_lock(&busfreq_lock);
 		_target(data, data->max_opp);
-		mutex_unlock(&busfreq_lock);
 		data->use = false;
+		exynos_busfreq_arm(data);
+		mutex_unlock(&busfreq_lock);
 		return NOTIFY_OK;
 	case PM_POST_RESTORE:
 	case PM_POST_SUSPEND:
@@ -342,17 +461,112 @@ void exynos_request_apply(unsigned long freq, bool fix, bool disable)
 	if (bus_ctrl.opp_lock)
 		opp = bus_ctrl.opp_lock;
 
+	opp = exynos_busfreq_limit_opp(bus_ctrl.data, opp);
+
 	if (!fix && opp_get_freq(bus_ctrl.data->curr_opp) >= opp_get_freq(opp))
 		goto out;
 
 	index = _target(bus_ctrl.data, opp);
 
 	update_busfreq_stat(bus_ctrl.data, index);
+	exynos_busfreq_arm(bus_ctrl.data);
 
 out:
 	mutex_unlock(&busfreq_lock);
 }
 
+/**
+ * exynos_busfreq_limit - cap the bus level
+ * @freq: highest level allowed, rounded down to a level; 0 removes the cap
+ *
+ * Takes effect at once when the current level is above it. Device locks
+ * are capped too, only a fixed level is not.
+ */
+void exynos_busfreq_limit(unsigned long freq)
+{
+	struct busfreq_data *data;
+	struct opp *opp = NULL;
+
+	mutex_lock(&busfreq_lock);
+
+	if (!bus_ctrl.init_done)
+		goto out;
+
+	data = bus_ctrl.data;
+	if (freq) {
+		opp = opp_find_freq_floor(data->dev, &freq);
+		if (IS_ERR(opp))
+			opp = data->min_opp;
+	}
+	bus_ctrl.opp_limit = opp;
+
+	if (opp && opp_get_freq(data->curr_opp) > opp_get_freq(opp))
+		exynos_busfreq_set(data, opp, false);
+out:
+	mutex_unlock(&busfreq_lock);
+}
+
+/*
+ * Lowest level carrying mif_mbps through the memory and int_mbps through
+ * the busiest internal bus port, 0 before the driver is up.
+ */
+unsigned long exynos_busfreq_bw_to_freq(unsigned long mif_mbps,
+					unsigned long int_mbps)
+{
+	if (!bus_ctrl.init_done || !bus_ctrl.data->bw_to_freq)
+		return 0;
+
+	return bus_ctrl.data->bw_to_freq(bus_ctrl.data, mif_mbps, int_mbps);
+}
+
+static void exynos_busfreq_free_irqs(struct busfreq_data *data)
+{
+	int i;
+
+	for (i = 0; i < PPMU_END; i++)
+		if (data->burst_irq & (1 << i)) {
+			exynos4_ppmu_set_overflow(&exynos_ppmu[i], 3, 0);
+			free_irq(exynos_ppmu[i].irq, &exynos_ppmu[i]);
+		}
+
+	data->burst_irq = 0;
+	data->burst_only_up = false;
+	cancel_work_sync(&data->burst_work);
+}
+
+/*
+ * Without an overflow interrupt for every PPMU of the bus the sampling
+ * timer keeps raising the level as well.
+ */
+static void exynos_busfreq_request_irqs(struct busfreq_data *data)
+{
+	struct exynos4_ppmu_hw *ppmu;
+	int i;
+
+	data->burst_only_up = true;
+
+	for (i = 0; i < PPMU_END; i++) {
+		ppmu = &exynos_ppmu[i];
+		if (ppmu->dev != data->dev)
+			continue;
+
+		if (!ppmu->irq || request_irq(ppmu->irq,
+				exynos_busfreq_ppmu_irq, 0, "busfreq-ppmu",
+				ppmu)) {
+			data->burst_only_up = false;
+			continue;
+		}
+
+		data->burst_irq |= 1 << i;
+	}
+
+	if (!data->burst_irq)
+		data->burst_only_up = false;
+	else
+		pr_info("busfreq: up-scaling on PPMU overflow (irq mask %x)\n",
+			data->burst_irq);
+}
+
 static __devinit int exynos_busfreq_probe(struct platform_device *pdev)
 {
 	struct busfreq_data *data;
@@ -390,6 +604,9 @@ static __devinit int exynos_busfreq_probe(struct platform_device *pdev)
 		data->get_int_volt = exynos4x12_get_int_volt;
 		data->get_table_index = exynos4x12_get_table_index;
 		data->monitor = exynos4x12_monitor;
+		data->burst = exynos4x12_burst;
+		data->burst_count = exynos4x12_burst_count;
+		data->bw_to_freq = exynos4x12_bw_to_freq;
 		data->busfreq_prepare = exynos4x12_prepare;
 		data->busfreq_post = exynos4x12_post;
 		data->busfreq_suspend = exynos4x12_suspend;
@@ -406,6 +623,7 @@ static __devinit int exynos_busfreq_probe(struct platform_device *pdev)
 	bus_ctrl.data =  data;
 
 	INIT_DELAYED_WORK(&data->worker, exynos_busfreq_timer);
+	INIT_WORK(&data->burst_work, exynos_busfreq_burst);
 
 	if (data->init(&pdev->dev, data, pop)) {
 		pr_err("Failed to init busfreq.\n");
@@ -434,6 +652,8 @@ static __devinit int exynos_busfreq_probe(struct platform_device *pdev)
 		goto err_pm_notifier;
 	}
 
+	exynos_busfreq_request_irqs(data);
+
 	data->use = true;
 	bus_ctrl.init_done = true;
 
@@ -463,6 +683,7 @@ static __devexit int exynos_busfreq_remove(struct platform_device *pdev)
 {
 	struct busfreq_data *data = platform_get_drvdata(pdev);
 
+	exynos_busfreq_free_irqs(data);
 	unregister_pm_notifier(&data->exynos_buspm_notifier);
 	unregister_reboot_notifier(&data->exynos_reboot_notifier);
 	regulator_put(data->vdd_int);
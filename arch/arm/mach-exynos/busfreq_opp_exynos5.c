@@ -360,6 +360,13 @@ void exynos_request_apply(unsigned long freq, bool fix, bool disable)
 	blocking_notifier_call_chain(&exynos_busfreq_notifier_list, freq, NULL);
 }
 
+/* Bandwidth requests are not mapped to EXYNOS5 levels yet */
+unsigned long exynos_busfreq_bw_to_freq(unsigned long mif_mbps,
+					unsigned long int_mbps)
+{
+	return 0;
+}
+
 static __devinit int exynos_busfreq_probe(struct platform_device *pdev)
 {
 	struct busfreq_data *data;
@@ -0,0 +1,309 @@
+/* linux/arch/arm/mach-exynos/cpu-park.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * EXYNOS - CPU parking and hotplug latency statistics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+/*
+ * A parked CPU stays online with only its bound kthreads, idling in
+ * cpuidle, see sched_cpu_park(). Parking skips the notifier chains and the
+ * core power sequence of cpu_down()/cpu_up(), so it is a much faster way
+ * to take a core in and out of use. /sys/devices/system/cpu/cpuN/park
+ * parks and unparks a CPU by hand.
+ *
+ * Every cpu_up()/cpu_down() is time stamped at the points listed in
+ * enum exynos_hotplug_mark and the time spent in each phase is summed up
+ * in debugfs exynos_hotplug/latency, along with park and unpark times.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/sched.h>
+#include <linux/notifier.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/sysdev.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <mach/cpu-park.h>
+
+struct hotplug_phase {
+	const char *name;
+	enum exynos_hotplug_mark from;
+	enum exynos_hotplug_mark to;
+};
+
+static const struct hotplug_phase hotplug_phases[] = {
+	{ "up_prepare",	HOTPLUG_UP_START,	HOTPLUG_UP_PREPARED },
+	{ "up_power",	HOTPLUG_UP_PREPARED,	HOTPLUG_UP_POWERED },
+	{ "up_release",	HOTPLUG_UP_POWERED,	HOTPLUG_UP_RELEASED },
+	{ "up_boot",	HOTPLUG_UP_RELEASED,	HOTPLUG_UP_ONLINE },
+	{ "up_online",	HOTPLUG_UP_ONLINE,	HOTPLUG_UP_DONE },
+	{ "up_total",	HOTPLUG_UP_START,	HOTPLUG_UP_DONE },
+	{ "down_prepare", HOTPLUG_DOWN_START,	HOTPLUG_DOWN_PREPARED },
+	{ "down_stop",	HOTPLUG_DOWN_PREPARED,	HOTPLUG_DOWN_DEAD },
+	{ "down_dead",	HOTPLUG_DOWN_DEAD,	HOTPLUG_DOWN_DONE },
+	{ "down_total",	HOTPLUG_DOWN_START,	HOTPLUG_DOWN_DONE },
+};
+
+#define NR_HOTPLUG_PHASES	ARRAY_SIZE(hotplug_phases)
+#define PARK_STAT		NR_HOTPLUG_PHASES
+#define UNPARK_STAT		(NR_HOTPLUG_PHASES + 1)
+#define NR_HOTPLUG_STATS	(NR_HOTPLUG_PHASES + 2)
+
+struct hotplug_stat {
+	unsigned int count;
+	u64 total_ns;
+	u64 max_ns;
+	u64 last_ns;
+};
+
+/*
+ * cpu_up()/cpu_down() are serialized by the hotplug lock and parking by
+ * park_lock, so each is updated by one path at a time.
+ */
+static ktime_t hotplug_marks[NR_CPUS][HOTPLUG_MARK_END];
+static struct hotplug_stat hotplug_stats[NR_HOTPLUG_STATS];
+static DEFINE_MUTEX(park_lock);
+
+static void hotplug_stat_add(struct hotplug_stat *stat, s64 ns)
+{
+	stat->count++;
+	stat->total_ns += ns;
+	stat->last_ns = ns;
+	if (ns > stat->max_ns)
+		stat->max_ns = ns;
+}
+
+/* Account the phases between the @first and @last marks of @cpu */
+static void hotplug_account(unsigned int cpu, enum exynos_hotplug_mark first,
+			    enum exynos_hotplug_mark last)
+{
+	ktime_t *marks = hotplug_marks[cpu];
+	int i;
+
+	for (i = 0; i < NR_HOTPLUG_PHASES; i++) {
+		const struct hotplug_phase *phase = &hotplug_phases[i];
+
+		if (phase->from < first || phase->to > last)
+			continue;
+
+		/* a failed or unmarked phase */
+		if (!marks[phase->from].tv64 || !marks[phase->to].tv64)
+			continue;
+
+		hotplug_stat_add(&hotplug_stats[i],
+			ktime_to_ns(ktime_sub(marks[phase->to],
+					      marks[phase->from])));
+	}
+}
+
+void exynos_hotplug_mark(unsigned int cpu, enum exynos_hotplug_mark mark)
+{
+	ktime_t *marks = hotplug_marks[cpu];
+
+	if (mark == HOTPLUG_UP_START)
+		memset(&marks[HOTPLUG_UP_START], 0,
+		       (HOTPLUG_UP_DONE - HOTPLUG_UP_START + 1) * sizeof(*marks));
+	else if (mark == HOTPLUG_DOWN_START)
+		memset(&marks[HOTPLUG_DOWN_START], 0,
+		       (HOTPLUG_DOWN_DONE - HOTPLUG_DOWN_START + 1) *
+		       sizeof(*marks));
+
+	marks[mark] = ktime_get();
+
+	if (mark == HOTPLUG_UP_DONE)
+		hotplug_account(cpu, HOTPLUG_UP_START, HOTPLUG_UP_DONE);
+	else if (mark == HOTPLUG_DOWN_DONE)
+		hotplug_account(cpu, HOTPLUG_DOWN_START, HOTPLUG_DOWN_DONE);
+}
+
+static int __cpuinit hotplug_first_notify(struct notifier_block *nb,
+					  unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_UP_PREPARE:
+		exynos_hotplug_mark(cpu, HOTPLUG_UP_START);
+		break;
+	case CPU_ONLINE:
+		exynos_hotplug_mark(cpu, HOTPLUG_UP_ONLINE);
+		break;
+	case CPU_DOWN_PREPARE:
+		exynos_hotplug_mark(cpu, HOTPLUG_DOWN_START);
+		break;
+	case CPU_DEAD:
+		exynos_hotplug_mark(cpu, HOTPLUG_DOWN_DEAD);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static int __cpuinit hotplug_last_notify(struct notifier_block *nb,
+					 unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_UP_PREPARE:
+		exynos_hotplug_mark(cpu, HOTPLUG_UP_PREPARED);
+		break;
+	case CPU_ONLINE:
+		exynos_hotplug_mark(cpu, HOTPLUG_UP_DONE);
+		break;
+	case CPU_DOWN_PREPARE:
+		exynos_hotplug_mark(cpu, HOTPLUG_DOWN_PREPARED);
+		break;
+	case CPU_DEAD:
+		exynos_hotplug_mark(cpu, HOTPLUG_DOWN_DONE);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __cpuinitdata hotplug_first_nb = {
+	.notifier_call = hotplug_first_notify,
+	.priority = INT_MAX,
+};
+
+static struct notifier_block __cpuinitdata hotplug_last_nb = {
+	.notifier_call = hotplug_last_notify,
+	.priority = INT_MIN,
+};
+
+int exynos_cpu_park(unsigned int cpu, bool park)
+{
+	ktime_t start;
+	int ret;
+
+	mutex_lock(&park_lock);
+	start = ktime_get();
+	ret = sched_cpu_park(cpu, park);
+	if (!ret)
+		hotplug_stat_add(&hotplug_stats[park ? PARK_STAT : UNPARK_STAT],
+				 ktime_to_ns(ktime_sub(ktime_get(), start)));
+	mutex_unlock(&park_lock);
+
+	return ret;
+}
+
+static ssize_t park_show(struct sys_device *dev,
+			 struct sysdev_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", sched_cpu_parked(dev->id));
+}
+
+static ssize_t park_store(struct sys_device *dev,
+			  struct sysdev_attribute *attr,
+			  const char *buf, size_t count)
+{
+	unsigned long park;
+	int ret;
+
+	if (strict_strtoul(buf, 0, &park))
+		return -EINVAL;
+
+	ret = exynos_cpu_park(dev->id, !!park);
+
+	return ret ? ret : count;
+}
+
+static SYSDEV_ATTR(park, 0644, park_show, park_store);
+
+#ifdef CONFIG_DEBUG_FS
+static void hotplug_stat_show(struct seq_file *s, const char *name,
+			      struct hotplug_stat *stat)
+{
+	u64 avg = stat->total_ns;
+
+	if (stat->count)
+		do_div(avg, stat->count);
+
+	seq_printf(s, "%-14s %8u %10llu %10llu %10llu\n", name, stat->count,
+		   div_u64(avg, NSEC_PER_USEC),
+		   div_u64(stat->max_ns, NSEC_PER_USEC),
+		   div_u64(stat->last_ns, NSEC_PER_USEC));
+}
+
+static int hotplug_latency_show(struct seq_file *s, void *data)
+{
+	int i;
+
+	seq_printf(s, "%-14s %8s %10s %10s %10s\n", "phase", "count",
+		   "avg(us)", "max(us)", "last(us)");
+
+	for (i = 0; i < NR_HOTPLUG_PHASES; i++)
+		hotplug_stat_show(s, hotplug_phases[i].name, &hotplug_stats[i]);
+
+	hotplug_stat_show(s, "park", &hotplug_stats[PARK_STAT]);
+	hotplug_stat_show(s, "unpark", &hotplug_stats[UNPARK_STAT]);
+
+	return 0;
+}
+
+static int hotplug_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, hotplug_latency_show, inode->i_private);
+}
+
+static const struct file_operations hotplug_latency_fops = {
+	.open		= hotplug_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init exynos_hotplug_debugfs_init(void)
+{
+	struct dentry *root;
+
+	root = debugfs_create_dir("exynos_hotplug", NULL);
+	if (IS_ERR_OR_NULL(root))
+		return;
+
+	debugfs_create_file("latency", S_IRUGO, root, NULL,
+			    &hotplug_latency_fops);
+}
+#else
+static inline void exynos_hotplug_debugfs_init(void)
+{
+}
+#endif
+
+/* secondary CPUs are brought up before this, so their boot is not counted */
+static int __init exynos_cpu_park_init(void)
+{
+	struct sys_device *dev;
+	unsigned int cpu;
+
+	register_hotcpu_notifier(&hotplug_first_nb);
+	register_hotcpu_notifier(&hotplug_last_nb);
+
+	for_each_possible_cpu(cpu) {
+		dev = get_cpu_sysdev(cpu);
+		if (!cpu || !dev)
+			continue;
+
+		if (sysdev_create_file(dev, &attr_park))
+			pr_err("%s: failed to add park for cpu%u\n",
+			       __func__, cpu);
+	}
+
+	exynos_hotplug_debugfs_init();
+
+	return 0;
+}
+late_initcall(exynos_cpu_park_init);
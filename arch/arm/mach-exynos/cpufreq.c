@@ -20,6 +20,12 @@
 #include <linux/cpufreq.h>
 #include <linux/suspend.h>
 #include <linux/reboot.h>
+#include <linux/spinlock.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
+#include <linux/plist.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <mach/map.h>
 #include <mach/regs-clock.h>
@@ -39,14 +45,35 @@ static bool exynos_cpufreq_disable;
 static bool exynos_cpufreq_lock_disable;
 static bool exynos_cpufreq_init_done;
 static DEFINE_MUTEX(set_freq_lock);
-static DEFINE_MUTEX(set_cpu_freq_lock);
+static DEFINE_SPINLOCK(set_cpu_freq_lock);
+
+/*
+ * Level changes which stay within the voltage last programmed to the
+ * PMIC need no regulator call and set_freq() only polls registers, so
+ * exynos_cpufreq_fast_switch() does them under switch_lock without
+ * sleeping. The transition notifiers of such switches run afterwards
+ * from a work item. cur_index is the level of the hardware and
+ * notified_index the one last reported to the notifiers; both only
+ * differ while such a report is pending. slow_busy keeps fast switches
+ * out while set_freq_lock holders change the voltage.
+ */
+static DEFINE_SPINLOCK(switch_lock);
+static unsigned int cur_index;
+static unsigned int notified_index;
+static bool slow_busy;
+static unsigned int arm_volt_cur;	/* 0 if unknown */
+
+/*
+ * Min (lock) and max (upper limit) requests sorted by level, so the
+ * effective levels are the first resp. last entry. They are cached in
+ * g_cpufreq_lock_level and g_cpufreq_limit_level for the switch paths.
+ * Both lists are protected by set_cpu_freq_lock, a spinlock so that
+ * timed requests can be made from atomic context.
+ */
+static struct plist_head lock_reqs = PLIST_HEAD_INIT(lock_reqs);
+static struct plist_head limit_reqs = PLIST_HEAD_INIT(limit_reqs);
 
-unsigned int g_cpufreq_limit_id;
-unsigned int g_cpufreq_limit_val[DVFS_LOCK_ID_END];
 unsigned int g_cpufreq_limit_level;
-
-unsigned int g_cpufreq_lock_id;
-unsigned int g_cpufreq_lock_val[DVFS_LOCK_ID_END];
 unsigned int g_cpufreq_lock_level;
 
 int exynos_verify_speed(struct cpufreq_policy *policy)
@@ -84,6 +111,169 @@ static unsigned int exynos_get_safe_armvolt(unsigned int old_index, unsigned int
 	return safe_arm_volt;
 }
 
+/* Called with set_freq_lock held. */
+static void exynos_cpufreq_set_volt(unsigned int volt)
+{
+	if (volt == arm_volt_cur)
+		return;
+
+	if (regulator_set_voltage(arm_regulator, volt, volt + 25000))
+		arm_volt_cur = 0;
+	else
+		arm_volt_cur = volt;
+}
+
+/* Called with set_freq_lock held. */
+static void exynos_cpufreq_set_level(unsigned int index)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&switch_lock, flags);
+	if (index != cur_index)
+		exynos_info->set_freq(cur_index, index);
+	cur_index = index;
+	notified_index = index;
+	spin_unlock_irqrestore(&switch_lock, flags);
+}
+
+/* Reports fast switches not yet seen by the transition notifiers. */
+static void exynos_cpufreq_sync_notify(void)
+{
+	struct cpufreq_freqs sync;
+	unsigned long flags;
+
+	spin_lock_irqsave(&switch_lock, flags);
+	sync.old = exynos_info->freq_table[notified_index].frequency;
+	sync.new = exynos_info->freq_table[cur_index].frequency;
+	notified_index = cur_index;
+	spin_unlock_irqrestore(&switch_lock, flags);
+
+	if (sync.old == sync.new)
+		return;
+
+	sync.cpu = 0;
+	sync.flags = 0;
+	cpufreq_notify_transition(&sync, CPUFREQ_PRECHANGE);
+	cpufreq_notify_transition(&sync, CPUFREQ_POSTCHANGE);
+}
+
+/*
+ * Takes set_freq_lock for a transition which may change the voltage.
+ * Returns the current level.
+ */
+static unsigned int exynos_cpufreq_begin(void)
+{
+	unsigned long flags;
+	unsigned int index;
+
+	mutex_lock(&set_freq_lock);
+	exynos_cpufreq_sync_notify();
+
+	spin_lock_irqsave(&switch_lock, flags);
+	slow_busy = true;
+	index = cur_index;
+	spin_unlock_irqrestore(&switch_lock, flags);
+
+	return index;
+}
+
+static void exynos_cpufreq_end(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&switch_lock, flags);
+	slow_busy = false;
+	spin_unlock_irqrestore(&switch_lock, flags);
+
+	mutex_unlock(&set_freq_lock);
+}
+
+static void exynos_cpufreq_notify_work_fn(struct work_struct *work)
+{
+	mutex_lock(&set_freq_lock);
+	exynos_cpufreq_sync_notify();
+	mutex_unlock(&set_freq_lock);
+}
+static DECLARE_WORK(exynos_cpufreq_notify_work, exynos_cpufreq_notify_work_fn);
+
+/*
+ * schedule_work() may take a runqueue lock the caller holds, and
+ * irq_work is only run from the tick on ARM. The work is queued from a
+ * pinned hrtimer, started without waking softirqs as hrtick_start()
+ * does.
+ */
+static DEFINE_PER_CPU(struct hrtimer, exynos_cpufreq_notify_kick);
+
+static enum hrtimer_restart exynos_cpufreq_notify_kick_fn(struct hrtimer *t)
+{
+	schedule_work(&exynos_cpufreq_notify_work);
+	return HRTIMER_NORESTART;
+}
+
+static void exynos_cpufreq_queue_notify(void)
+{
+	struct hrtimer *timer = &__get_cpu_var(exynos_cpufreq_notify_kick);
+
+	if (!hrtimer_active(timer))
+		__hrtimer_start_range_ns(timer,
+					 ns_to_ktime(20 * NSEC_PER_USEC), 0,
+					 HRTIMER_MODE_REL_PINNED, 0);
+}
+
+/**
+ * exynos_cpufreq_fast_switch - change the level without sleeping
+ * @policy: policy of the cpus
+ * @target_freq: requested frequency in kHz
+ * @relation: CPUFREQ_RELATION_L or CPUFREQ_RELATION_H
+ *
+ * Can be called from any context, e.g. the scheduler. Returns -EAGAIN
+ * if the new level needs another voltage or a transition is in flight,
+ * in which case the caller has to use __cpufreq_driver_target() from
+ * process context.
+ */
+int exynos_cpufreq_fast_switch(struct cpufreq_policy *policy,
+			       unsigned int target_freq,
+			       unsigned int relation)
+{
+	struct cpufreq_frequency_table *freq_table = exynos_info->freq_table;
+	unsigned int index;
+	unsigned long flags;
+	int ret = 0;
+
+	if (!exynos_cpufreq_init_done || exynos_cpufreq_disable)
+		return -EPERM;
+
+	if (cpufreq_frequency_table_target(policy, freq_table,
+					   target_freq, relation, &index))
+		return -EINVAL;
+
+	if (!exynos_cpufreq_lock_disable && (index > g_cpufreq_lock_level))
+		index = g_cpufreq_lock_level;
+
+	if (index < g_cpufreq_limit_level)
+		index = g_cpufreq_limit_level;
+
+	spin_lock_irqsave(&switch_lock, flags);
+	if (index == cur_index)
+		goto out;
+
+	if (slow_busy || !arm_volt_cur ||
+	    exynos_info->volt_table[index] != arm_volt_cur ||
+	    exynos_get_safe_armvolt(cur_index, index)) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	exynos_info->set_freq(cur_index, index);
+	cur_index = index;
+	exynos_cpufreq_queue_notify();
+out:
+	spin_unlock_irqrestore(&switch_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(exynos_cpufreq_fast_switch);
+
 static int exynos_target(struct cpufreq_policy *policy,
 			  unsigned int target_freq,
 			  unsigned int relation)
@@ -94,18 +284,12 @@ static int exynos_target(struct cpufreq_policy *policy,
 	struct cpufreq_frequency_table *freq_table = exynos_info->freq_table;
 	unsigned int *volt_table = exynos_info->volt_table;
 
-	mutex_lock(&set_freq_lock);
+	old_index = exynos_cpufreq_begin();
 
 	if (exynos_cpufreq_disable)
 		goto out;
 
-	freqs.old = policy->cur;
-
-	if (cpufreq_frequency_table_target(policy, freq_table,
-					   freqs.old, relation, &old_index)) {
-		ret = -EINVAL;
-		goto out;
-	}
+	freqs.old = freq_table[old_index].frequency;
 
 	if (cpufreq_frequency_table_target(policy, freq_table,
 					   target_freq, relation, &index)) {
@@ -123,6 +307,10 @@ static int exynos_target(struct cpufreq_policy *policy,
 	freqs.new = freq_table[index].frequency;
 	freqs.cpu = policy->cpu;
 
+	/* nothing to do, in particular no notifier to call */
+	if (index == old_index)
+		goto out;
+
 	safe_arm_volt = exynos_get_safe_armvolt(old_index, index);
 
 	arm_volt = volt_table[index];
@@ -132,15 +320,13 @@ static int exynos_target(struct cpufreq_policy *policy,
 	/* When the new frequency is higher than current frequency */
 	if ((freqs.new > freqs.old) && !safe_arm_volt) {
 		/* Firstly, voltage up to increase frequency */
-		regulator_set_voltage(arm_regulator, arm_volt,
-				     arm_volt + 25000);
+		exynos_cpufreq_set_volt(arm_volt);
 	}
 
 	if (safe_arm_volt)
-		regulator_set_voltage(arm_regulator, safe_arm_volt,
-				     safe_arm_volt + 25000);
-	if (freqs.new != freqs.old)
-		exynos_info->set_freq(old_index, index);
+		exynos_cpufreq_set_volt(safe_arm_volt);
+
+	exynos_cpufreq_set_level(index);
 
 	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
 
@@ -148,11 +334,10 @@ static int exynos_target(struct cpufreq_policy *policy,
 	if ((freqs.new < freqs.old) ||
 	   ((freqs.new > freqs.old) && safe_arm_volt)) {
 		/* down the voltage after frequency change */
-		regulator_set_voltage(arm_regulator, arm_volt,
-				     arm_volt + 25000);
+		exynos_cpufreq_set_volt(arm_volt);
 	}
 out:
-	mutex_unlock(&set_freq_lock);
+	exynos_cpufreq_end();
 
 	return ret;
 }
@@ -229,229 +414,464 @@ int exynos_cpufreq_get_level(unsigned int freq, unsigned int *level)
 }
 EXPORT_SYMBOL_GPL(exynos_cpufreq_get_level);
 
-atomic_t exynos_cpufreq_lock_count;
+/* Frequency and voltage of a supported level, for power estimates */
+int exynos_cpufreq_get_level_info(unsigned int level, unsigned int *freq,
+				  unsigned int *volt)
+{
+	if (!exynos_cpufreq_init_done ||
+	    level < exynos_info->max_support_idx ||
+	    level > exynos_info->min_support_idx ||
+	    exynos_info->freq_table[level].frequency == CPUFREQ_ENTRY_INVALID)
+		return -EINVAL;
 
-int exynos_cpufreq_lock(unsigned int nId,
-			 enum cpufreq_level_index cpufreq_level)
+	*freq = exynos_info->freq_table[level].frequency;
+	*volt = exynos_info->volt_table[level];
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(exynos_cpufreq_get_level_info);
+
+static const char * const exynos_cpufreq_lock_name[DVFS_LOCK_ID_END] = {
+	[DVFS_LOCK_ID_G2D] = "G2D",
+	[DVFS_LOCK_ID_TV] = "TV",
+	[DVFS_LOCK_ID_MFC] = "MFC",
+	[DVFS_LOCK_ID_USB] = "USB",
+	[DVFS_LOCK_ID_CAM] = "CAM",
+	[DVFS_LOCK_ID_PM] = "PM",
+	[DVFS_LOCK_ID_USER] = "USER",
+	[DVFS_LOCK_ID_TMU] = "TMU",
+	[DVFS_LOCK_ID_LPA] = "LPA",
+	[DVFS_LOCK_ID_DRM] = "DRM",
+	[DVFS_LOCK_ID_G3D] = "G3D",
+};
+
+/* Requests of the legacy nId based API */
+static struct exynos_cpufreq_req lock_id_req[DVFS_LOCK_ID_END];
+static struct exynos_cpufreq_req limit_id_req[DVFS_LOCK_ID_END];
+
+static struct plist_head *exynos_cpufreq_req_list(struct exynos_cpufreq_req *req)
 {
-	int ret = 0, i, old_idx = 0;
-	unsigned int freq_old, freq_new, arm_volt, safe_arm_volt;
-	unsigned int *volt_table;
-	struct cpufreq_policy *policy;
-	struct cpufreq_frequency_table *freq_table;
+	return req->type == EXYNOS_CPUFREQ_REQ_MIN ? &lock_reqs : &limit_reqs;
+}
 
-	if (!exynos_cpufreq_init_done)
-		return -EPERM;
+static unsigned int exynos_cpufreq_req_default(struct exynos_cpufreq_req *req)
+{
+	return req->type == EXYNOS_CPUFREQ_REQ_MIN ?
+		exynos_info->min_support_idx : exynos_info->max_support_idx;
+}
 
-	if (!exynos_info)
-		return -EPERM;
+/* Called with set_cpu_freq_lock held. */
+static void exynos_cpufreq_req_refresh(void)
+{
+	if (plist_head_empty(&lock_reqs))
+		g_cpufreq_lock_level = exynos_info->min_support_idx;
+	else
+		g_cpufreq_lock_level = plist_first(&lock_reqs)->prio;
 
-	if (exynos_cpufreq_disable && (nId != DVFS_LOCK_ID_TMU)) {
-		pr_info("CPUFreq is already fixed\n");
-		return -EPERM;
-	}
+	if (plist_head_empty(&limit_reqs))
+		g_cpufreq_limit_level = exynos_info->max_support_idx;
+	else
+		g_cpufreq_limit_level = plist_last(&limit_reqs)->prio;
+}
 
-	policy = cpufreq_cpu_get(0);
-	if (!policy)
-		return -EPERM;
+/*
+ * Moves req to level and refreshes the effective levels. Called with
+ * set_cpu_freq_lock held.
+ */
+static void exynos_cpufreq_req_set(struct exynos_cpufreq_req *req,
+				   unsigned int level)
+{
+	struct plist_head *head = exynos_cpufreq_req_list(req);
 
-	volt_table = exynos_info->volt_table;
-	freq_table = exynos_info->freq_table;
+	level = clamp(level, exynos_info->max_support_idx,
+		      exynos_info->min_support_idx);
 
-	if (g_cpufreq_lock_id & (1 << nId)) {
-		printk(KERN_ERR "%s:Device [%d] already locked cpufreq\n",
-				__func__,  nId);
-		return 0;
+	plist_del(&req->node, head);
+	plist_node_init(&req->node, level);
+	plist_add(&req->node, head);
+
+	exynos_cpufreq_req_refresh();
+}
+
+/*
+ * Moves the current level into the effective [limit, lock] range. The
+ * lock is ignored if the governor does not support it or it is above
+ * the limit, unless force is set.
+ */
+static void exynos_cpufreq_apply(bool force)
+{
+	struct cpufreq_frequency_table *freq_table = exynos_info->freq_table;
+	unsigned int old_idx, new_idx, safe_arm_volt;
+
+	old_idx = exynos_cpufreq_begin();
+	new_idx = old_idx;
+
+	if (new_idx > g_cpufreq_lock_level &&
+	    (force || !exynos_cpufreq_lock_disable))
+		new_idx = g_cpufreq_lock_level;
+
+	if (new_idx < g_cpufreq_limit_level && !force)
+		new_idx = g_cpufreq_limit_level;
+
+	if (new_idx == old_idx)
+		goto out;
+
+	freqs.old = freq_table[old_idx].frequency;
+	freqs.new = freq_table[new_idx].frequency;
+	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
+
+	safe_arm_volt = exynos_get_safe_armvolt(old_idx, new_idx);
+
+	if (new_idx < old_idx) {
+		if (safe_arm_volt)
+			exynos_cpufreq_set_volt(safe_arm_volt);
+		exynos_cpufreq_set_volt(exynos_info->volt_table[new_idx]);
+		exynos_cpufreq_set_level(new_idx);
+	} else {
+		if (safe_arm_volt)
+			exynos_cpufreq_set_volt(safe_arm_volt);
+		exynos_cpufreq_set_level(new_idx);
+		exynos_cpufreq_set_volt(exynos_info->volt_table[new_idx]);
 	}
-	mutex_lock(&set_cpu_freq_lock);
-	g_cpufreq_lock_id |= (1 << nId);
-	g_cpufreq_lock_val[nId] = cpufreq_level;
 
-	/* If the requested cpufreq is higher than current min frequency */
-	if (cpufreq_level < g_cpufreq_lock_level)
-		g_cpufreq_lock_level = cpufreq_level;
+	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
+out:
+	exynos_cpufreq_end();
+}
 
-	mutex_unlock(&set_cpu_freq_lock);
+/* Applies changed requests. May sleep. */
+static void exynos_cpufreq_req_apply(void)
+{
+	if (!exynos_cpufreq_disable)
+		exynos_cpufreq_apply(false);
+}
 
-	if ((g_cpufreq_lock_level < g_cpufreq_limit_level)
-				&& (nId != DVFS_LOCK_ID_PM))
-		return 0;
+static void exynos_cpufreq_apply_fn(struct work_struct *work)
+{
+	exynos_cpufreq_req_apply();
+}
+static DECLARE_WORK(exynos_cpufreq_apply_work, exynos_cpufreq_apply_fn);
 
-	/* Do not setting cpufreq lock frequency
-	 * because current governor doesn't support dvfs level lock
-	 * except DVFS_LOCK_ID_PM */
-	if (exynos_cpufreq_lock_disable && (nId != DVFS_LOCK_ID_PM))
-		return 0;
+static void exynos_cpufreq_req_expire(struct work_struct *work)
+{
+	struct exynos_cpufreq_req *req = container_of(to_delayed_work(work),
+					struct exynos_cpufreq_req, work);
+	unsigned long flags;
+	bool expired = false;
 
-	/* If current frequency is lower than requested freq,
-	 * it needs to update
+	spin_lock_irqsave(&set_cpu_freq_lock, flags);
+	/*
+	 * The timeout may have been dropped or restarted since the work
+	 * was queued, as it is not cancelled synchronously.
 	 */
-	mutex_lock(&set_freq_lock);
-	freq_old = policy->cur;
-	freq_new = freq_table[cpufreq_level].frequency;
-	if (freq_old < freq_new) {
-		/* Find out current level index */
-		for (i = 0 ; i <= exynos_info->min_support_idx;  i++) {
-			if (freq_old == freq_table[i].frequency) {
-				old_idx = freq_table[i].index;
-				break;
-			} else if (i == exynos_info->min_support_idx) {
-				printk(KERN_ERR "%s: Level not found\n",
-					__func__);
-				mutex_unlock(&set_freq_lock);
-				return -EINVAL;
-			} else {
-				continue;
-			}
-		}
-		freqs.old = freq_old;
-		freqs.new = freq_new;
-		cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
+	if (req->expires && time_before(jiffies, req->expires)) {
+		schedule_delayed_work(&req->work, req->expires - jiffies);
+	} else if (req->expires) {
+		req->expires = 0;
+		exynos_cpufreq_req_set(req, exynos_cpufreq_req_default(req));
+		expired = true;
+	}
+	spin_unlock_irqrestore(&set_cpu_freq_lock, flags);
 
-		/* get the voltage value */
-		safe_arm_volt = exynos_get_safe_armvolt(old_idx, cpufreq_level);
-		if (safe_arm_volt)
-			regulator_set_voltage(arm_regulator, safe_arm_volt,
-					     safe_arm_volt + 25000);
+	/* only a max request can make the current level invalid */
+	if (expired && req->type == EXYNOS_CPUFREQ_REQ_MAX)
+		exynos_cpufreq_req_apply();
+}
 
-		arm_volt = volt_table[cpufreq_level];
-		regulator_set_voltage(arm_regulator, arm_volt,
-				     arm_volt + 25000);
+/*
+ * Adds req without constraining anything yet. Returns -EBUSY if it has
+ * already been added.
+ */
+static int exynos_cpufreq_req_add(struct exynos_cpufreq_req *req,
+				  enum exynos_cpufreq_req_type type,
+				  const char *name)
+{
+	unsigned long flags;
 
-		exynos_info->set_freq(old_idx, cpufreq_level);
-		cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
+	spin_lock_irqsave(&set_cpu_freq_lock, flags);
+	if (exynos_cpufreq_request_active(req)) {
+		spin_unlock_irqrestore(&set_cpu_freq_lock, flags);
+		return -EBUSY;
 	}
-	mutex_unlock(&set_freq_lock);
+
+	req->type = type;
+	req->name = name;
+	req->expires = 0;
+	INIT_DELAYED_WORK(&req->work, exynos_cpufreq_req_expire);
+	plist_node_init(&req->node, exynos_cpufreq_req_default(req));
+	plist_add(&req->node, exynos_cpufreq_req_list(req));
+	spin_unlock_irqrestore(&set_cpu_freq_lock, flags);
+
+	return 0;
+}
+
+/* Moves req to level, without applying it. Does not sleep. */
+static int exynos_cpufreq_req_update(struct exynos_cpufreq_req *req,
+				     unsigned int level, unsigned long timeout_us)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&set_cpu_freq_lock, flags);
+	if (!exynos_cpufreq_request_active(req)) {
+		spin_unlock_irqrestore(&set_cpu_freq_lock, flags);
+		return -EINVAL;
+	}
+
+	req->expires = timeout_us ? jiffies + usecs_to_jiffies(timeout_us) : 0;
+	exynos_cpufreq_req_set(req, level);
+	spin_unlock_irqrestore(&set_cpu_freq_lock, flags);
+
+	/* a running expiry sees the new expires and leaves req alone */
+	cancel_delayed_work(&req->work);
+	if (timeout_us)
+		schedule_delayed_work(&req->work, usecs_to_jiffies(timeout_us));
+
+	return 0;
+}
+
+/**
+ * exynos_cpufreq_add_request - add a frequency constraint
+ * @req: request owned by the caller
+ * @type: EXYNOS_CPUFREQ_REQ_MIN or EXYNOS_CPUFREQ_REQ_MAX
+ * @name: shown in debugfs
+ * @level: cpufreq level, L0 being the fastest
+ *
+ * A min request keeps the cpu at @level or faster, a max request at
+ * @level or slower. The fastest min and the slowest max request take
+ * effect, a max request winning over a min request. May sleep.
+ */
+int exynos_cpufreq_add_request(struct exynos_cpufreq_req *req,
+			       enum exynos_cpufreq_req_type type,
+			       const char *name, unsigned int level)
+{
+	int ret;
+
+	if (!exynos_cpufreq_init_done)
+		return -EPERM;
+
+	if (exynos_cpufreq_req_add(req, type, name)) {
+		WARN(1, "%s: %s already added\n", __func__, req->name);
+		return -EBUSY;
+	}
+
+	ret = exynos_cpufreq_req_update(req, level, 0);
+	if (!ret)
+		exynos_cpufreq_req_apply();
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(exynos_cpufreq_add_request);
+
+/* May sleep. */
+int exynos_cpufreq_update_request(struct exynos_cpufreq_req *req,
+				  unsigned int level)
+{
+	int ret;
+
+	ret = exynos_cpufreq_req_update(req, level, 0);
+	if (!ret)
+		exynos_cpufreq_req_apply();
 
 	return ret;
 }
+EXPORT_SYMBOL_GPL(exynos_cpufreq_update_request);
+
+/**
+ * exynos_cpufreq_update_request_timeout - constrain for a limited time
+ * @req: request added with exynos_cpufreq_add_request()
+ * @level: cpufreq level, L0 being the fastest
+ * @timeout_us: time after which @req falls back to no constraint
+ *
+ * Meant for boosts, e.g. on input events: calling it again while the
+ * boost runs restarts the timeout. Can be called from atomic context;
+ * the new level is then reached from a work item.
+ */
+int exynos_cpufreq_update_request_timeout(struct exynos_cpufreq_req *req,
+					  unsigned int level,
+					  unsigned long timeout_us)
+{
+	int ret;
+
+	if (!timeout_us)
+		return -EINVAL;
+
+	ret = exynos_cpufreq_req_update(req, level, timeout_us);
+	if (!ret)
+		schedule_work(&exynos_cpufreq_apply_work);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(exynos_cpufreq_update_request_timeout);
+
+/* May sleep. */
+void exynos_cpufreq_remove_request(struct exynos_cpufreq_req *req)
+{
+	unsigned long flags;
+
+	if (!exynos_cpufreq_request_active(req))
+		return;
+
+	cancel_delayed_work_sync(&req->work);
+
+	spin_lock_irqsave(&set_cpu_freq_lock, flags);
+	plist_del(&req->node, exynos_cpufreq_req_list(req));
+	exynos_cpufreq_req_refresh();
+	req->name = NULL;
+	spin_unlock_irqrestore(&set_cpu_freq_lock, flags);
+
+	/*
+	 * Dropping a min request leaves lowering the level to the governor
+	 * as before; dropping a max request lets it raise the level again.
+	 */
+}
+EXPORT_SYMBOL_GPL(exynos_cpufreq_remove_request);
+
+int exynos_cpufreq_lock(unsigned int nId,
+			 enum cpufreq_level_index cpufreq_level)
+{
+	struct exynos_cpufreq_req *req = &lock_id_req[nId];
+	unsigned long flags;
+
+	if (!exynos_cpufreq_init_done)
+		return -EPERM;
+
+	if (exynos_cpufreq_disable && (nId != DVFS_LOCK_ID_TMU)) {
+		pr_info("CPUFreq is already fixed\n");
+		return -EPERM;
+	}
+
+	if (exynos_cpufreq_req_add(req, EXYNOS_CPUFREQ_REQ_MIN,
+				   exynos_cpufreq_lock_name[nId])) {
+		printk(KERN_ERR "%s:Device [%d] already locked cpufreq\n",
+				__func__,  nId);
+		return 0;
+	}
+
+	spin_lock_irqsave(&set_cpu_freq_lock, flags);
+	exynos_cpufreq_req_set(req, cpufreq_level);
+	spin_unlock_irqrestore(&set_cpu_freq_lock, flags);
+
+	/*
+	 * The PM lock has to be reached for suspend and reboot, even above
+	 * the upper limit or with a governor which does not support locks.
+	 */
+	exynos_cpufreq_apply(nId == DVFS_LOCK_ID_PM);
+
+	return 0;
+}
 EXPORT_SYMBOL_GPL(exynos_cpufreq_lock);
 
 void exynos_cpufreq_lock_free(unsigned int nId)
 {
-	unsigned int i;
-
 	if (!exynos_cpufreq_init_done)
 		return;
 
-	mutex_lock(&set_cpu_freq_lock);
-	g_cpufreq_lock_id &= ~(1 << nId);
-	g_cpufreq_lock_val[nId] = exynos_info->min_support_idx;
-	g_cpufreq_lock_level = exynos_info->min_support_idx;
-	if (g_cpufreq_lock_id) {
-		for (i = 0; i < DVFS_LOCK_ID_END; i++) {
-			if (g_cpufreq_lock_val[i] < g_cpufreq_lock_level)
-				g_cpufreq_lock_level = g_cpufreq_lock_val[i];
-		}
-	}
-	mutex_unlock(&set_cpu_freq_lock);
+	exynos_cpufreq_remove_request(&lock_id_req[nId]);
 }
 EXPORT_SYMBOL_GPL(exynos_cpufreq_lock_free);
 
 int exynos_cpufreq_upper_limit(unsigned int nId,
 				enum cpufreq_level_index cpufreq_level)
 {
-	int ret = 0, old_idx = 0, i;
-	unsigned int freq_old, freq_new, arm_volt, safe_arm_volt;
-	unsigned int *volt_table;
-	struct cpufreq_policy *policy;
-	struct cpufreq_frequency_table *freq_table;
+	struct exynos_cpufreq_req *req = &limit_id_req[nId];
 
 	if (!exynos_cpufreq_init_done)
 		return -EPERM;
 
-	if (!exynos_info)
-		return -EPERM;
-
 	if (exynos_cpufreq_disable) {
 		pr_info("CPUFreq is already fixed\n");
 		return -EPERM;
 	}
 
-	policy = cpufreq_cpu_get(0);
-	if (!policy)
-		return -EPERM;
-
-	volt_table = exynos_info->volt_table;
-	freq_table = exynos_info->freq_table;
-
-	if (g_cpufreq_limit_id & (1 << nId)) {
+	if (exynos_cpufreq_req_add(req, EXYNOS_CPUFREQ_REQ_MAX,
+				   exynos_cpufreq_lock_name[nId])) {
 		pr_err("[CPUFREQ]This device [%d] already limited cpufreq\n", nId);
 		return 0;
 	}
 
-	mutex_lock(&set_cpu_freq_lock);
-	g_cpufreq_limit_id |= (1 << nId);
-	g_cpufreq_limit_val[nId] = cpufreq_level;
+	return exynos_cpufreq_update_request(req, cpufreq_level);
+}
 
-	/* If the requested limit level is lower than current value */
-	if (cpufreq_level > g_cpufreq_limit_level)
-		g_cpufreq_limit_level = cpufreq_level;
+void exynos_cpufreq_upper_limit_free(unsigned int nId)
+{
+	if (!exynos_cpufreq_init_done)
+		return;
 
-	mutex_unlock(&set_cpu_freq_lock);
+	exynos_cpufreq_remove_request(&limit_id_req[nId]);
+}
 
-	mutex_lock(&set_freq_lock);
-	/* If cur frequency is higher than limit freq, it needs to update */
-	freq_old = policy->cur;
-	freq_new = freq_table[cpufreq_level].frequency;
-	if (freq_old > freq_new) {
-		/* Find out current level index */
-		for (i = 0; i <= exynos_info->min_support_idx; i++) {
-			if (freq_old == freq_table[i].frequency) {
-				old_idx = freq_table[i].index;
-				break;
-			} else if (i == exynos_info->min_support_idx) {
-				printk(KERN_ERR "%s: Level is not found\n", __func__);
-				mutex_unlock(&set_freq_lock);
-
-				return -EINVAL;
-			} else {
-				continue;
-			}
-		}
-		freqs.old = freq_old;
-		freqs.new = freq_new;
+#ifdef CONFIG_DEBUG_FS
+static void exynos_cpufreq_req_show(struct seq_file *s,
+				    struct exynos_cpufreq_req *req)
+{
+	unsigned int level = req->node.prio;
 
-		cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
+	seq_printf(s, "%-12s %s L%-2u %8u kHz", req->name,
+		   req->type == EXYNOS_CPUFREQ_REQ_MIN ? "min" : "max",
+		   level, exynos_info->freq_table[level].frequency);
 
-		exynos_info->set_freq(old_idx, cpufreq_level);
+	if (req->expires)
+		seq_printf(s, "  expires in %u ms",
+			   jiffies_to_msecs(max_t(long,
+				req->expires - jiffies, 0)));
 
-		safe_arm_volt = exynos_get_safe_armvolt(old_idx, cpufreq_level);
-		if (safe_arm_volt)
-			regulator_set_voltage(arm_regulator, safe_arm_volt,
-					     safe_arm_volt + 25000);
+	seq_printf(s, "\n");
+}
+
+static int exynos_cpufreq_req_debug_show(struct seq_file *s, void *data)
+{
+	struct cpufreq_frequency_table *freq_table = exynos_info->freq_table;
+	struct exynos_cpufreq_req *req;
+	unsigned long flags;
 
-		arm_volt = volt_table[cpufreq_level];
-		regulator_set_voltage(arm_regulator, arm_volt, arm_volt + 25000);
+	spin_lock_irqsave(&set_cpu_freq_lock, flags);
 
-		cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
-	}
+	seq_printf(s, "effective min L%-2u %8u kHz%s\n", g_cpufreq_lock_level,
+		   freq_table[g_cpufreq_lock_level].frequency,
+		   exynos_cpufreq_lock_disable ? " (ignored by governor)" : "");
+	seq_printf(s, "effective max L%-2u %8u kHz\n\n", g_cpufreq_limit_level,
+		   freq_table[g_cpufreq_limit_level].frequency);
 
-	mutex_unlock(&set_freq_lock);
+	plist_for_each_entry(req, &lock_reqs, node)
+		exynos_cpufreq_req_show(s, req);
+	plist_for_each_entry(req, &limit_reqs, node)
+		exynos_cpufreq_req_show(s, req);
 
-	return ret;
+	spin_unlock_irqrestore(&set_cpu_freq_lock, flags);
+
+	return 0;
 }
 
-void exynos_cpufreq_upper_limit_free(unsigned int nId)
+static int exynos_cpufreq_req_debug_open(struct inode *inode,
+					 struct file *file)
 {
-	unsigned int i;
+	return single_open(file, exynos_cpufreq_req_debug_show,
+			   inode->i_private);
+}
 
-	if (!exynos_cpufreq_init_done)
-		return;
+static const struct file_operations exynos_cpufreq_req_debug_fops = {
+	.open		= exynos_cpufreq_req_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
 
-	mutex_lock(&set_cpu_freq_lock);
-	g_cpufreq_limit_id &= ~(1 << nId);
-	g_cpufreq_limit_val[nId] = exynos_info->max_support_idx;
-	g_cpufreq_limit_level = exynos_info->max_support_idx;
+static void __init exynos_cpufreq_debugfs_init(void)
+{
+	struct dentry *root;
 
-	if (g_cpufreq_limit_id) {
-		for (i = 0; i < DVFS_LOCK_ID_END; i++) {
-			if (g_cpufreq_limit_val[i] > g_cpufreq_limit_level)
-				g_cpufreq_limit_level = g_cpufreq_limit_val[i];
-		}
-	}
-	mutex_unlock(&set_cpu_freq_lock);
+	root = debugfs_create_dir("exynos_cpufreq", NULL);
+	if (IS_ERR_OR_NULL(root))
+		return;
+
+	debugfs_create_file("requests", S_IRUGO, root, NULL,
+			    &exynos_cpufreq_req_debug_fops);
 }
+#else
+static inline void exynos_cpufreq_debugfs_init(void)
+{
+}
+#endif
 
 /* This API serve highest priority level locking */
 int exynos_cpufreq_level_fix(unsigned int freq)
@@ -528,29 +948,32 @@ static int exynos_cpufreq_notifier_event(struct notifier_block *this,
 	case PM_POST_RESTORE:
 	case PM_POST_SUSPEND:
 		pr_debug("PM_POST_SUSPEND for CPUFREQ: %d\n", ret);
+		/* the PMIC may not hold the cached voltage any more */
+		mutex_lock(&set_freq_lock);
+		arm_volt_cur = 0;
+		mutex_unlock(&set_freq_lock);
+
 		exynos_cpufreq_lock_free(DVFS_LOCK_ID_PM);
 		/* In case of using performance governor,
 		 * max level should be used after sleep and wakeup */
 		if (exynos_cpufreq_lock_disable) {
-			mutex_lock(&set_freq_lock);
+			exynos_cpufreq_begin();
 
 			cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
 
 			/* get the voltage value */
 			safe_arm_volt = exynos_get_safe_armvolt(exynos_info->pm_lock_idx, exynos_info->max_support_idx);
 			if (safe_arm_volt)
-				regulator_set_voltage(arm_regulator, safe_arm_volt,
-					safe_arm_volt + 25000);
+				exynos_cpufreq_set_volt(safe_arm_volt);
 
 			arm_volt = volt_table[exynos_info->max_support_idx];
-			regulator_set_voltage(arm_regulator, arm_volt,
-				arm_volt + 25000);
+			exynos_cpufreq_set_volt(arm_volt);
 
-			exynos_info->set_freq(exynos_info->pm_lock_idx, exynos_info->max_support_idx);
+			exynos_cpufreq_set_level(exynos_info->max_support_idx);
 
 			cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
 
-			mutex_unlock(&set_freq_lock);
+			exynos_cpufreq_end();
 		}
 		exynos_cpufreq_disable = false;
 
@@ -639,6 +1062,7 @@ static struct cpufreq_driver exynos_driver = {
 	.flags		= CPUFREQ_STICKY,
 	.verify		= exynos_verify_speed,
 	.target		= exynos_target,
+	.fast_switch	= exynos_cpufreq_fast_switch,
 	.get		= exynos_getspeed,
 	.init		= exynos_cpufreq_cpu_init,
 	.name		= "exynos_cpufreq",
@@ -651,6 +1075,7 @@ static struct cpufreq_driver exynos_driver = {
 static int __init exynos_cpufreq_init(void)
 {
 	int ret = -EINVAL;
+	unsigned int rate;
 	int i;
 
 	exynos_info = kzalloc(sizeof(struct exynos_dvfs_info), GFP_KERNEL);
@@ -681,6 +1106,24 @@ static int __init exynos_cpufreq_init(void)
 		goto err_vdd_arm;
 	}
 
+	cur_index = exynos_info->max_support_idx;
+	rate = exynos_getspeed(0);
+	for (i = 0; exynos_info->freq_table[i].frequency != CPUFREQ_TABLE_END;
+			i++) {
+		if (exynos_info->freq_table[i].frequency == rate) {
+			cur_index = i;
+			break;
+		}
+	}
+	notified_index = cur_index;
+
+	for_each_possible_cpu(i) {
+		struct hrtimer *timer = &per_cpu(exynos_cpufreq_notify_kick, i);
+
+		hrtimer_init(timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		timer->function = exynos_cpufreq_notify_kick_fn;
+	}
+
 	exynos_cpufreq_disable = false;
 
 	register_pm_notifier(&exynos_cpufreq_notifier);
@@ -690,14 +1133,11 @@ static int __init exynos_cpufreq_init(void)
 
 	exynos_cpufreq_init_done = true;
 
-	for (i = 0; i < DVFS_LOCK_ID_END; i++) {
-		g_cpufreq_lock_val[i] = exynos_info->min_support_idx;
-		g_cpufreq_limit_val[i] = exynos_info->max_support_idx;
-	}
-
 	g_cpufreq_lock_level = exynos_info->min_support_idx;
 	g_cpufreq_limit_level = exynos_info->max_support_idx;
 
+	exynos_cpufreq_debugfs_init();
+
 	if (cpufreq_register_driver(&exynos_driver)) {
 		pr_err("failed to register cpufreq driver\n");
 		goto err_cpufreq;
@@ -15,10 +15,21 @@
 #include <linux/suspend.h>
 #include <linux/platform_device.h>
 #include <linux/gpio.h>
+#include <linux/ktime.h>
+#include <linux/tick.h>
+#include <linux/moduleparam.h>
+#include <linux/smp.h>
+#include <linux/cpumask.h>
+#include <linux/spinlock.h>
+#include <linux/clockchips.h>
+#include <linux/irq.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/proc-fns.h>
 #include <asm/tlbflush.h>
 #include <asm/cacheflush.h>
+#include <asm/hardware/gic.h>
 
 #include <mach/regs-clock.h>
 #include <mach/regs-pmu.h>
@@ -47,6 +58,7 @@
 #endif
 
 extern unsigned long sys_pwr_conf_addr;
+extern unsigned int gic_bank_offset;
 extern unsigned int l2x0_save[3];
 
 enum hc_type {
@@ -363,15 +375,309 @@ static void vfp_enable(void *unused)
 	set_copro_access(access | CPACC_FULL(10) | CPACC_FULL(11));
 }
 
+enum exynos4_idle_state {
+	EXYNOS4_IDLE_WFI,
+	EXYNOS4_IDLE_AFTR,
+	EXYNOS4_IDLE_LPA,
+};
+
+/*
+ * The exit latency of every state is measured on CPU0 over its first
+ * calib_samples timer wakeups and replaces the default of
+ * exynos4_cpuidle_set, so the menu governor and the cpuidle sysfs see the
+ * measured value. The latency is the time spent until WFI plus how late
+ * the CPU is back after the timer it slept for. The target residency is
+ * only raised, to residency_ratio times the latency: the defaults are the
+ * energy break-even points of AFTR and LPA, which the latency says
+ * nothing about.
+ */
+static bool calibrate = true;
+module_param(calibrate, bool, 0444);
+MODULE_PARM_DESC(calibrate, "measure exit latency");
+
+static unsigned int calib_samples = 32;
+module_param(calib_samples, uint, 0444);
+MODULE_PARM_DESC(calib_samples, "timer wakeups measured per state");
+
+static unsigned int residency_ratio = 3;
+module_param(residency_ratio, uint, 0444);
+MODULE_PARM_DESC(residency_ratio, "min target residency as a multiple of latency");
+
+/* a wakeup later than this after the timer was caused by something else */
+#define EXYNOS4_TIMER_WAKE_NS	(2 * NSEC_PER_MSEC)
+
+struct exynos4_idle_time {
+	ktime_t start;
+	ktime_t entered;		/* about to execute WFI */
+	ktime_t expected;		/* next timer event */
+};
+
+struct exynos4_idle_calib {
+	unsigned int samples;
+	bool done;
+	s64 entry_ns;
+	s64 exit_ns;
+};
+
+static struct exynos4_idle_calib exynos4_idle_calib[CPUIDLE_STATE_MAX];
+
+static inline void exynos4_idle_begin(struct exynos4_idle_time *t)
+{
+	t->start = ktime_get();
+	t->entered = t->start;
+	t->expected = ktime_add(t->start, tick_nohz_get_sleep_length());
+}
+
+static void exynos4_idle_calibrate(struct cpuidle_state *state,
+				   struct exynos4_idle_calib *c,
+				   struct exynos4_idle_time *t, ktime_t end)
+{
+	s64 late = ktime_to_ns(ktime_sub(end, t->expected));
+	unsigned int latency;
+
+	c->entry_ns = max(c->entry_ns,
+			  ktime_to_ns(ktime_sub(t->entered, t->start)));
+
+	if (late < 0 || late >= EXYNOS4_TIMER_WAKE_NS)
+		return;
+
+	c->exit_ns = max(c->exit_ns, late);
+	if (++c->samples < calib_samples)
+		return;
+
+	latency = DIV_ROUND_UP((unsigned int)(c->entry_ns + c->exit_ns),
+			       NSEC_PER_USEC);
+	state->exit_latency = max(latency, 1U);
+	state->target_residency = max(state->target_residency,
+				      state->exit_latency * residency_ratio);
+	c->done = true;
+}
+
+/*
+ * Every idle period is accounted per CPU and state in a histogram of its
+ * residency, and the interrupt pending at the GIC when the CPU is back
+ * is counted as what woke it. Both are in debugfs exynos4_idle.
+ */
+#define EXYNOS4_IDLE_HIST	12	/* buckets from <16us up to >=16ms */
+#define EXYNOS4_IDLE_HIST_SHIFT	4
+#define EXYNOS4_WAKE_IRQS	256	/* GIC interrupt IDs */
+#define EXYNOS4_GIC_SPURIOUS	1023
+
+struct exynos4_idle_stats {
+	unsigned int hist[CPUIDLE_STATE_MAX][EXYNOS4_IDLE_HIST];
+	u64 time_us[CPUIDLE_STATE_MAX];
+	unsigned int wake[EXYNOS4_WAKE_IRQS];
+	unsigned int wake_none;		/* nothing pending any more */
+};
+
+static DEFINE_PER_CPU(struct exynos4_idle_stats, exynos4_idle_stats);
+
+static inline unsigned int exynos4_idle_bucket(unsigned int us)
+{
+	return min_t(unsigned int, fls(us >> EXYNOS4_IDLE_HIST_SHIFT),
+		     EXYNOS4_IDLE_HIST - 1);
+}
+
+static void exynos4_idle_account(unsigned int cpu, unsigned int idx,
+				 unsigned int us)
+{
+	struct exynos4_idle_stats *st = &per_cpu(exynos4_idle_stats, cpu);
+	unsigned int hwirq;
+
+	st->hist[idx][exynos4_idle_bucket(us)]++;
+	st->time_us[idx] += us;
+
+	/* peek at the highest priority pending interrupt without acking it */
+	hwirq = __raw_readl(S5P_VA_GIC_CPU + gic_bank_offset * cpu +
+			    GIC_CPU_HIGHPRI) & 0x3ff;
+	if (hwirq < EXYNOS4_WAKE_IRQS)
+		st->wake[hwirq]++;
+	else
+		st->wake_none++;
+}
+
+/* Called with IRQs disabled, returns the time spent idle in us */
+static int exynos4_idle_end(struct cpuidle_device *dev,
+			    struct cpuidle_state *state,
+			    struct exynos4_idle_time *t)
+{
+	unsigned int idx = state - dev->states;
+	struct exynos4_idle_calib *c = &exynos4_idle_calib[idx];
+	ktime_t end = ktime_get();
+	int us = (int)ktime_to_us(ktime_sub(end, t->start));
+
+	if (calibrate && dev->cpu == 0 && !c->done)
+		exynos4_idle_calibrate(state, c, t, end);
+
+	exynos4_idle_account(dev->cpu, idx, us);
+
+	local_irq_enable();
+
+	return us;
+}
+
+#ifdef CONFIG_SMP
+/*
+ * Coupled AFTR: CPU1-3 stay online and take part in AFTR and LPA. A
+ * secondary which selects AFTR joins the waiting mask and sits in WFI.
+ * Once every other online CPU is waiting, CPU0 is offered AFTR and LPA;
+ * when it enters one it sets go and pokes the secondaries, which hand
+ * their tick to the broadcast timer and power their core down. CPU0 enters
+ * the state once all of them are off and powers them back up on wakeup,
+ * then waits for them to resume before any of them leaves.
+ *
+ * A secondary woken by an interrupt of its own before go leaves the
+ * waiting mask and has spent its time in WFI. After go, an early wakeup
+ * or a pending reschedule aborts the whole round.
+ */
+static bool coupled = true;
+module_param(coupled, bool, 0644);
+MODULE_PARM_DESC(coupled, "enter AFTR and LPA with CPU1-3 online");
+
+static unsigned int coupled_timeout_us = 200;
+module_param(coupled_timeout_us, uint, 0644);
+MODULE_PARM_DESC(coupled_timeout_us, "max time for CPU1-3 to power down");
+
+struct exynos4_coupled {
+	spinlock_t lock;
+	struct cpumask waiting;		/* secondaries in the coupled state */
+	struct cpumask cpus;		/* secondaries of the current round */
+	struct cpumask resumed;		/* ... which are back */
+	bool go;
+	atomic_t aborted;
+};
+
+static struct exynos4_coupled exynos4_coupled = {
+	.lock		= __SPIN_LOCK_UNLOCKED(exynos4_coupled.lock),
+	.aborted	= ATOMIC_INIT(0),
+};
+
+static inline bool exynos4_core_off(unsigned int cpu)
+{
+	return !(__raw_readl(S5P_ARM_CORE_STATUS(cpu)) & S5P_CORE_LOCAL_PWR_EN);
+}
+
+/* every other online CPU waits in the coupled state */
+static bool exynos4_coupled_ready(void)
+{
+	return coupled &&
+	       cpumask_weight(&exynos4_coupled.waiting) == num_online_cpus() - 1;
+}
+
+/* power up a core which is or is about to be off, or wake it from WFI */
+static void exynos4_coupled_kick(unsigned int cpu)
+{
+	if (exynos4_core_off(cpu) ||
+	    !__raw_readl(S5P_ARM_CORE_CONFIGURATION(cpu)))
+		exynos_power_up_cpu_at(cpu, virt_to_phys(exynos4_core_resume));
+	else
+		smp_send_reschedule(cpu);
+}
+
+/*
+ * Called by CPU0 with IRQs disabled on its way out of AFTR or LPA, or of
+ * an aborted round. Brings the secondaries of the round back up and waits
+ * for them.
+ */
+static void exynos4_coupled_wake(void)
+{
+	struct exynos4_coupled *cp = &exynos4_coupled;
+	unsigned int cpu;
+	ktime_t kick;
+
+	if (!cp->go)
+		return;
+
+	for_each_cpu(cpu, &cp->cpus)
+		exynos4_coupled_kick(cpu);
+
+	/*
+	 * Kick again the cores which are not back yet: one may have powered
+	 * down after the first kick, or missed the IPI in the boot ROM.
+	 */
+	kick = ktime_get();
+	while (!cpumask_equal(&cp->resumed, &cp->cpus)) {
+		cpu_relax();
+		if (ktime_us_delta(ktime_get(), kick) < 10)
+			continue;
+
+		for_each_cpu(cpu, &cp->cpus)
+			if (!cpumask_test_cpu(cpu, &cp->resumed))
+				exynos4_coupled_kick(cpu);
+		kick = ktime_get();
+	}
+
+	spin_lock(&cp->lock);
+	cpumask_clear(&cp->cpus);
+	cpumask_clear(&cp->resumed);
+	atomic_set(&cp->aborted, 0);
+	cp->go = false;
+	spin_unlock(&cp->lock);
+}
+
+/*
+ * Called by CPU0 with IRQs disabled. Returns true once every other CPU is
+ * powered down, false if the round was aborted and CPU0 should only WFI.
+ */
+static bool exynos4_coupled_begin(void)
+{
+	struct exynos4_coupled *cp = &exynos4_coupled;
+	unsigned int cpu;
+	ktime_t start;
+	bool down;
+
+	spin_lock(&cp->lock);
+	if (!exynos4_coupled_ready()) {
+		spin_unlock(&cp->lock);
+		return false;
+	}
+	cpumask_copy(&cp->cpus, &cp->waiting);
+	cp->go = true;
+	spin_unlock(&cp->lock);
+
+	for_each_cpu(cpu, &cp->cpus)
+		smp_send_reschedule(cpu);
+
+	start = ktime_get();
+	do {
+		if (atomic_read(&cp->aborted) ||
+		    ktime_us_delta(ktime_get(), start) > coupled_timeout_us) {
+			exynos4_coupled_wake();
+			return false;
+		}
+
+		cpu_relax();
+		down = true;
+		for_each_cpu(cpu, &cp->cpus)
+			down &= exynos4_core_off(cpu);
+	} while (!down);
+
+	return true;
+}
+#else
+static inline bool exynos4_coupled_ready(void)
+{
+	return false;
+}
+
+static inline void exynos4_coupled_wake(void)
+{
+}
+
+static inline bool exynos4_coupled_begin(void)
+{
+	return false;
+}
+#endif
+
 static int exynos4_enter_core0_aftr(struct cpuidle_device *dev,
 				    struct cpuidle_state *state)
 {
-	struct timeval before, after;
-	int idle_time;
+	struct exynos4_idle_time t;
 	unsigned long tmp, abb_val;
 
 	local_irq_disable();
-	do_gettimeofday(&before);
+	exynos4_idle_begin(&t);
 
 	exynos4_set_wakeupmask();
 
@@ -388,6 +694,8 @@ static int exynos4_enter_core0_aftr(struct cpuidle_device *dev,
 		abb_val = exynos4x12_get_abb_member(ABB_ARM);
 		exynos4x12_set_abb_member(ABB_ARM, ABB_MODE_085V);
 	}
+
+	t.entered = ktime_get();
 	if (exynos4_enter_lp(0, PLAT_PHYS_OFFSET - PAGE_OFFSET) == 0) {
 
 		/*
@@ -416,20 +724,15 @@ early_wakeup:
 	/* Clear wakeup state register */
 	__raw_writel(0x0, S5P_WAKEUP_STAT);
 
-	do_gettimeofday(&after);
-
-	local_irq_enable();
-	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-		    (after.tv_usec - before.tv_usec);
+	exynos4_coupled_wake();
 
-	return idle_time;
+	return exynos4_idle_end(dev, state, &t);
 }
 
 static int exynos4_enter_core0_lpa(struct cpuidle_device *dev,
 				   struct cpuidle_state *state)
 {
-	struct timeval before, after;
-	int idle_time;
+	struct exynos4_idle_time t;
 	unsigned long tmp, abb_val;
 
 	s3c_pm_do_save(exynos4_lpa_save, ARRAY_SIZE(exynos4_lpa_save));
@@ -444,8 +747,7 @@ static int exynos4_enter_core0_lpa(struct cpuidle_device *dev,
 		s3c_pm_do_restore_core(exynos4210_set_clksrc, ARRAY_SIZE(exynos4210_set_clksrc));
 
 	local_irq_disable();
-
-	do_gettimeofday(&before);
+	exynos4_idle_begin(&t);
 
 	/*
 	 * Unmasking all wakeup source.
@@ -475,6 +777,7 @@ static int exynos4_enter_core0_lpa(struct cpuidle_device *dev,
 		exynos4x12_set_abb_member(ABB_ARM, ABB_MODE_085V);
 	}
 
+	t.entered = ktime_get();
 	if (exynos4_enter_lp(0, PLAT_PHYS_OFFSET - PAGE_OFFSET) == 0) {
 
 		/*
@@ -516,39 +819,52 @@ early_wakeup:
 
 	__raw_writel(0x0, S5P_WAKEUP_MASK);
 
-	do_gettimeofday(&after);
+	exynos4_coupled_wake();
 
-	local_irq_enable();
-	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-		    (after.tv_usec - before.tv_usec);
-
-	return idle_time;
+	return exynos4_idle_end(dev, state, &t);
 }
 
 static int exynos4_enter_idle(struct cpuidle_device *dev,
 			      struct cpuidle_state *state);
 
-static int exynos4_enter_lowpower(struct cpuidle_device *dev,
-				  struct cpuidle_state *state);
+static int exynos4_enter_aftr(struct cpuidle_device *dev,
+			      struct cpuidle_state *state);
 
+static int exynos4_enter_lpa(struct cpuidle_device *dev,
+			     struct cpuidle_state *state);
+
+/*
+ * Default latencies and residencies, until measured. LPA is offered on
+ * CPU0 only; AFTR on CPU1-3 is their part of a coupled round, see
+ * exynos4_coupled. LPA falls back to AFTR while a device which needs the
+ * bus clocks is busy.
+ */
 static struct cpuidle_state exynos4_cpuidle_set[] = {
-	[0] = {
+	[EXYNOS4_IDLE_WFI] = {
 		.enter			= exynos4_enter_idle,
 		.exit_latency		= 1,
-		.target_residency	= 10000,
+		.target_residency	= 1,
 		.flags			= CPUIDLE_FLAG_TIME_VALID,
 		.name			= "IDLE",
 		.desc			= "ARM clock gating(WFI)",
 	},
 #ifdef CONFIG_EXYNOS4_LOWPWR_IDLE
-	[1] = {
-		.enter			= exynos4_enter_lowpower,
+	[EXYNOS4_IDLE_AFTR] = {
+		.enter			= exynos4_enter_aftr,
 		.exit_latency		= 300,
 		.target_residency	= 10000,
 		.flags			= CPUIDLE_FLAG_TIME_VALID,
-		.name			= "LOW_POWER",
+		.name			= "AFTR",
 		.desc			= "ARM power down",
 	},
+	[EXYNOS4_IDLE_LPA] = {
+		.enter			= exynos4_enter_lpa,
+		.exit_latency		= 400,
+		.target_residency	= 15000,
+		.flags			= CPUIDLE_FLAG_TIME_VALID,
+		.name			= "LPA",
+		.desc			= "ARM and top block power down",
+	},
 #endif
 };
 
@@ -559,109 +875,247 @@ static struct cpuidle_driver exynos4_idle_driver = {
 	.owner		= THIS_MODULE,
 };
 
-static unsigned int cpu_core;
-static unsigned int old_div;
-static DEFINE_SPINLOCK(idle_lock);
+/*
+ * SW clock down: the ARM clock of the cluster is divided while every
+ * online CPU of it is in WFI. The last CPU to enter divides it and the
+ * first one out restores it; only these two take the lock.
+ */
+struct exynos4_idle_cluster {
+	atomic_t idle_cpus;
+	bool clk_down;
+	unsigned int old_div;
+	spinlock_t lock;
+};
+
+static struct exynos4_idle_cluster exynos4_cluster = {
+	.idle_cpus	= ATOMIC_INIT(0),
+	.lock		= __SPIN_LOCK_UNLOCKED(exynos4_cluster.lock),
+};
+
+static void exynos4_cluster_set_div(unsigned int div)
+{
+	__raw_writel(div, EXYNOS4_CLKDIV_CPU);
+
+	while (__raw_readl(EXYNOS4_CLKDIV_STATCPU) & 0x10000001)
+		;
+}
+
+static void exynos4_cluster_idle_enter(struct exynos4_idle_cluster *cl)
+{
+	if (atomic_inc_return(&cl->idle_cpus) != num_online_cpus())
+		return;
+
+	spin_lock(&cl->lock);
+	if (!cl->clk_down) {
+		cl->old_div = __raw_readl(EXYNOS4_CLKDIV_CPU);
+		exynos4_cluster_set_div(cl->old_div | (0x7 << 28) | (0x7 << 0));
+		cl->clk_down = true;
+		smp_mb();
+
+		/* a CPU woke up meanwhile and may have missed clk_down */
+		if (atomic_read(&cl->idle_cpus) != num_online_cpus()) {
+			exynos4_cluster_set_div(cl->old_div);
+			cl->clk_down = false;
+		}
+	}
+	spin_unlock(&cl->lock);
+}
+
+static void exynos4_cluster_idle_exit(struct exynos4_idle_cluster *cl)
+{
+	atomic_dec(&cl->idle_cpus);
+	smp_mb__after_atomic_dec();
+
+	if (!cl->clk_down)
+		return;
+
+	spin_lock(&cl->lock);
+	if (cl->clk_down) {
+		exynos4_cluster_set_div(cl->old_div);
+		cl->clk_down = false;
+	}
+	spin_unlock(&cl->lock);
+}
 
 static int exynos4_enter_idle(struct cpuidle_device *dev,
 			      struct cpuidle_state *state)
 {
-	struct timeval before, after;
-	int idle_time;
-	int cpu;
-	unsigned int tmp;
+	struct exynos4_idle_time t;
 
 	local_irq_disable();
-	do_gettimeofday(&before);
+	exynos4_idle_begin(&t);
 
 	if (use_clock_down == SW_CLK_DWN) {
-		/* USE SW Clock Down */
-		cpu = get_cpu();
+		exynos4_cluster_idle_enter(&exynos4_cluster);
+		t.entered = ktime_get();
+		cpu_do_idle();
+		exynos4_cluster_idle_exit(&exynos4_cluster);
+	} else {
+		cpu_do_idle();
+	}
 
-		spin_lock(&idle_lock);
-		cpu_core |= (1 << cpu);
+	return exynos4_idle_end(dev, state, &t);
+}
 
-		if ((cpu_core == 0x3) || (cpu_online(1) == 0)) {
-			old_div = __raw_readl(EXYNOS4_CLKDIV_CPU);
-			tmp = old_div;
-			tmp |= ((0x7 << 28) | (0x7 << 0));
-			__raw_writel(tmp, EXYNOS4_CLKDIV_CPU);
+/*
+ * AFTR and LPA are only offered to CPU0 while it is the only CPU online,
+ * or every other one waits in the coupled state.
+ */
+static int exynos4_cpuidle_prepare(struct cpuidle_device *dev)
+{
+	bool deep = num_online_cpus() == 1 || exynos4_coupled_ready();
+	int i;
 
-			do {
-				tmp = __raw_readl(EXYNOS4_CLKDIV_STATCPU);
-			} while (tmp & 0x10000001);
+	for (i = EXYNOS4_IDLE_AFTR; i < dev->state_count; i++) {
+		if (deep)
+			dev->states[i].flags &= ~CPUIDLE_FLAG_IGNORE;
+		else
+			dev->states[i].flags |= CPUIDLE_FLAG_IGNORE;
+	}
 
-		}
+	return 0;
+}
 
-		spin_unlock(&idle_lock);
+static void exynos4_lowpower_prepare(void)
+{
+	if (!soc_is_exynos4210())
+		__raw_writel(S5P_USE_STANDBY_WFI0 | S5P_USE_STANDBY_WFE0,
+			     S5P_CENTRAL_SEQ_OPTION);
+}
 
-		cpu_do_idle();
+#ifdef CONFIG_SMP
+/* AFTR on CPU1-3: power the core down for a coupled round of CPU0 */
+static int exynos4_enter_coupled(struct cpuidle_device *dev,
+				 struct cpuidle_state *state)
+{
+	struct exynos4_coupled *cp = &exynos4_coupled;
+	struct exynos4_idle_time t;
+	unsigned int cpu = dev->cpu;
+	bool last, go;
+	int ret = 0;
 
-		spin_lock(&idle_lock);
+	local_irq_disable();
+	exynos4_idle_begin(&t);
 
-		if ((cpu_core == 0x3) || (cpu_online(1) == 0)) {
-			__raw_writel(old_div, EXYNOS4_CLKDIV_CPU);
+	spin_lock(&cp->lock);
+	cpumask_set_cpu(cpu, &cp->waiting);
+	last = cpumask_weight(&cp->waiting) == num_online_cpus() - 1;
+	spin_unlock(&cp->lock);
 
-			do {
-				tmp = __raw_readl(EXYNOS4_CLKDIV_STATCPU);
-			} while (tmp & 0x10000001);
+	/* CPU0 may be in WFI already, let it select AFTR again */
+	if (last)
+		smp_send_reschedule(0);
 
-		}
+	t.entered = ktime_get();
+	cpu_do_idle();
 
-		cpu_core &= ~(1 << cpu);
-		spin_unlock(&idle_lock);
+	spin_lock(&cp->lock);
+	go = cp->go;
+	if (!go)
+		cpumask_clear_cpu(cpu, &cp->waiting);
+	spin_unlock(&cp->lock);
 
-		put_cpu();
-	} else
-		cpu_do_idle();
+	if (!go) {
+		dev->last_state = dev->safe_state;
+		return exynos4_idle_end(dev, dev->safe_state, &t);
+	}
 
-	do_gettimeofday(&after);
+	/* take the poke from CPU0 and anything which came along */
 	local_irq_enable();
-	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-		    (after.tv_usec - before.tv_usec);
+	local_irq_disable();
+
+	if (need_resched() || atomic_read(&cp->aborted)) {
+		atomic_inc(&cp->aborted);
+		goto resumed;
+	}
+
+	clockevents_notify(CLOCK_EVT_NOTIFY_BROADCAST_ENTER, &cpu);
+
+	ret = exynos4_enter_core_lp(S5P_ARM_CORE_CONFIGURATION(cpu),
+				    PLAT_PHYS_OFFSET - PAGE_OFFSET);
+	if (ret) {
+		flush_tlb_all();
+
+		cpu_init();
+
+		vfp_enable(NULL);
+	} else {
+		/* early wakeup, do not power off at the next WFI */
+		__raw_writel(S5P_CORE_LOCAL_PWR_EN,
+			     S5P_ARM_CORE_CONFIGURATION(cpu));
+		atomic_inc(&cp->aborted);
+	}
+
+	clockevents_notify(CLOCK_EVT_NOTIFY_BROADCAST_EXIT, &cpu);
+
+resumed:
+	spin_lock(&cp->lock);
+	cpumask_clear_cpu(cpu, &cp->waiting);
+	spin_unlock(&cp->lock);
+
+	cpumask_set_cpu(cpu, &cp->resumed);
+	while (ACCESS_ONCE(cp->go))
+		cpu_relax();
 
-	return idle_time;
+	if (!ret) {
+		dev->last_state = dev->safe_state;
+		state = dev->safe_state;
+	}
+
+	return exynos4_idle_end(dev, state, &t);
 }
+#else
+static inline int exynos4_enter_coupled(struct cpuidle_device *dev,
+					struct cpuidle_state *state)
+{
+	return exynos4_enter_idle(dev, dev->safe_state);
+}
+#endif
 
-static int exynos4_check_entermode(void)
+static int exynos4_enter_aftr(struct cpuidle_device *dev,
+			      struct cpuidle_state *state)
 {
-	unsigned int ret;
+	if (dev->cpu)
+		return exynos4_enter_coupled(dev, state);
 
-	if (exynos4_check_operation())
-		ret = S5P_CHECK_DIDLE;
-	else
-		ret = S5P_CHECK_LPA;
+	/*
+	 * A CPU came online or left the coupled state since AFTR was
+	 * selected, or the round was aborted.
+	 */
+	local_irq_disable();
+	if (num_online_cpus() != 1 && !exynos4_coupled_begin()) {
+		dev->last_state = dev->safe_state;
+		return exynos4_enter_idle(dev, dev->safe_state);
+	}
 
-	return ret;
+	exynos4_lowpower_prepare();
+
+	return exynos4_enter_core0_aftr(dev, state);
 }
 
-static int exynos4_enter_lowpower(struct cpuidle_device *dev,
-				  struct cpuidle_state *state)
+static int exynos4_enter_lpa(struct cpuidle_device *dev,
+			     struct cpuidle_state *state)
 {
-	struct cpuidle_state *new_state = state;
-	unsigned int enter_mode;
-	unsigned int tmp;
+	struct cpuidle_state *aftr = &dev->states[EXYNOS4_IDLE_AFTR];
 
-	/* This mode only can be entered when only Core0 is online */
-	if (num_online_cpus() != 1) {
-		BUG_ON(!dev->safe_state);
-		new_state = dev->safe_state;
+	/*
+	 * The device check is only paid when the governor expects a sleep
+	 * long enough for LPA.
+	 */
+	if (exynos4_check_operation()) {
+		dev->last_state = aftr;
+		return exynos4_enter_aftr(dev, aftr);
 	}
-	dev->last_state = new_state;
 
-	if (!soc_is_exynos4210()) {
-		tmp = S5P_USE_STANDBY_WFI0 | S5P_USE_STANDBY_WFE0;
-		__raw_writel(tmp, S5P_CENTRAL_SEQ_OPTION);
+	local_irq_disable();
+	if (num_online_cpus() != 1 && !exynos4_coupled_begin()) {
+		dev->last_state = dev->safe_state;
+		return exynos4_enter_idle(dev, dev->safe_state);
 	}
 
-	if (new_state == &dev->states[0])
-		return exynos4_enter_idle(dev, new_state);
+	exynos4_lowpower_prepare();
 
-	enter_mode = exynos4_check_entermode();
-	if (enter_mode == S5P_CHECK_DIDLE) {
-		return exynos4_enter_core0_aftr(dev, new_state);
-	} else
-		return exynos4_enter_core0_lpa(dev, new_state);
+	return exynos4_enter_core0_lpa(dev, state);
 }
 
 static int exynos4_cpuidle_notifier_event(struct notifier_block *this,
@@ -746,6 +1200,143 @@ static void __init exynos4_core_down_clk(void)
 #define exynos4_core_down_clk()	do { } while (0)
 #endif
 
+#ifdef CONFIG_DEBUG_FS
+static int exynos4_idle_residency_show(struct seq_file *s, void *data)
+{
+	struct cpuidle_device *dev;
+	struct exynos4_idle_stats *st;
+	unsigned int cpu, i, b;
+	char label[16];
+
+	seq_printf(s, "%-4s %-5s %12s", "cpu", "state", "time(us)");
+	for (b = 0; b < EXYNOS4_IDLE_HIST; b++) {
+		snprintf(label, sizeof(label), "%s%u", b ? ">=" : "<",
+			 (1 << EXYNOS4_IDLE_HIST_SHIFT) << (b ? b - 1 : 0));
+		seq_printf(s, " %9s", label);
+	}
+	seq_printf(s, "\n");
+
+	for_each_possible_cpu(cpu) {
+		dev = &per_cpu(exynos4_cpuidle_device, cpu);
+		st = &per_cpu(exynos4_idle_stats, cpu);
+
+		for (i = 0; i < dev->state_count; i++) {
+			seq_printf(s, "%-4u %-5s %12llu", cpu,
+				   dev->states[i].name, st->time_us[i]);
+			for (b = 0; b < EXYNOS4_IDLE_HIST; b++)
+				seq_printf(s, " %9u", st->hist[i][b]);
+			seq_printf(s, "\n");
+		}
+	}
+
+	return 0;
+}
+
+static const char *exynos4_wake_name(unsigned int hwirq)
+{
+	struct irq_desc *desc;
+
+	if (hwirq < 16)
+		return "IPI";
+
+	desc = irq_to_desc(S5P_IRQ(hwirq));
+	if (!desc)
+		return "-";
+
+	/* combiner groups and EINT16-31 are chained */
+	return desc->action ? desc->action->name : "(chained)";
+}
+
+static int exynos4_idle_wakeup_show(struct seq_file *s, void *data)
+{
+	struct exynos4_idle_stats *st;
+	unsigned int cpu, hwirq;
+
+	seq_printf(s, "%-4s %5s %5s %10s  %s\n",
+		   "cpu", "gic", "irq", "count", "name");
+
+	for_each_possible_cpu(cpu) {
+		st = &per_cpu(exynos4_idle_stats, cpu);
+
+		for (hwirq = 0; hwirq < EXYNOS4_WAKE_IRQS; hwirq++) {
+			if (!st->wake[hwirq])
+				continue;
+
+			seq_printf(s, "%-4u %5u %5u %10u  %s\n", cpu, hwirq,
+				   S5P_IRQ(hwirq), st->wake[hwirq],
+				   exynos4_wake_name(hwirq));
+		}
+
+		if (st->wake_none)
+			seq_printf(s, "%-4u %5s %5s %10u  %s\n", cpu, "-", "-",
+				   st->wake_none, "none");
+	}
+
+	return 0;
+}
+
+static int exynos4_idle_residency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, exynos4_idle_residency_show, inode->i_private);
+}
+
+static int exynos4_idle_wakeup_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, exynos4_idle_wakeup_show, inode->i_private);
+}
+
+static ssize_t exynos4_idle_reset_write(struct file *file,
+					const char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(&per_cpu(exynos4_idle_stats, cpu), 0,
+		       sizeof(struct exynos4_idle_stats));
+
+	return count;
+}
+
+static const struct file_operations exynos4_idle_residency_fops = {
+	.open		= exynos4_idle_residency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations exynos4_idle_wakeup_fops = {
+	.open		= exynos4_idle_wakeup_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations exynos4_idle_reset_fops = {
+	.write		= exynos4_idle_reset_write,
+};
+
+static void __init exynos4_idle_debugfs_init(void)
+{
+	struct dentry *root;
+
+	root = debugfs_create_dir("exynos4_idle", NULL);
+	if (IS_ERR_OR_NULL(root))
+		return;
+
+	debugfs_create_file("residency", S_IRUGO, root, NULL,
+			    &exynos4_idle_residency_fops);
+	debugfs_create_file("wakeup", S_IRUGO, root, NULL,
+			    &exynos4_idle_wakeup_fops);
+	debugfs_create_file("reset", S_IWUSR, root, NULL,
+			    &exynos4_idle_reset_fops);
+}
+#else
+static inline void exynos4_idle_debugfs_init(void)
+{
+}
+#endif
+
 static int __init exynos4_init_cpuidle(void)
 {
 	int i, max_cpuidle_state, cpu_id, ret;
@@ -773,10 +1364,14 @@ static int __init exynos4_init_cpuidle(void)
 		device = &per_cpu(exynos4_cpuidle_device, cpu_id);
 		device->cpu = cpu_id;
 
-		if (cpu_id == 0)
+		if (cpu_id == 0) {
 			device->state_count = ARRAY_SIZE(exynos4_cpuidle_set);
-		else
-			device->state_count = 1;	/* Support IDLE only */
+			device->prepare = exynos4_cpuidle_prepare;
+		} else {
+			/* IDLE and the coupled AFTR */
+			device->state_count = min_t(int, EXYNOS4_IDLE_AFTR + 1,
+					ARRAY_SIZE(exynos4_cpuidle_set));
+		}
 
 		max_cpuidle_state = device->state_count;
 
@@ -830,6 +1425,7 @@ static int __init exynos4_init_cpuidle(void)
 	}
 #endif
 	register_pm_notifier(&exynos4_cpuidle_notifier);
+	exynos4_idle_debugfs_init();
 	sys_pwr_conf_addr = (unsigned long)S5P_CENTRAL_SEQ_CONFIGURATION;
 
 	/* Save register value for L2X0 */
@@ -49,6 +49,8 @@ int dev_add(struct device_domain *dev, struct device *device)
 
 	mutex_lock(&domains_mutex);
 	INIT_LIST_HEAD(&dev->domain_list);
+	INIT_LIST_HEAD(&dev->bw_list);
+	dev->bw_freq = 0;
 	dev->device = device;
 	list_add(&dev->node, &domains_list);
 	mutex_unlock(&domains_mutex);
@@ -159,6 +161,111 @@ void dev_unlock_fix(struct device *device, struct device *dev)
 	exynos_request_apply(1, true, true);
 }
 
+/*
+ * All ports share the memory, so the MIF has to carry the sum of every
+ * request. Each port has its own read and write channel on the internal
+ * bus, so the INT only has to carry the busiest of them. Called with
+ * domains_mutex held.
+ */
+static void dev_bw_update(struct device_domain *domain)
+{
+	struct domain_bw *bw;
+	unsigned long mif_mbps = 0, int_mbps = 0;
+
+	list_for_each_entry(bw, &domain->bw_list, node) {
+		mif_mbps += bw->rd_mbps + bw->wr_mbps;
+		int_mbps = max3(int_mbps, (unsigned long)bw->rd_mbps,
+				(unsigned long)bw->wr_mbps);
+	}
+
+	if (list_empty(&domain->bw_list))
+		domain->bw_freq = 0;
+	else
+		domain->bw_freq = exynos_busfreq_bw_to_freq(mif_mbps, int_mbps);
+}
+
+/**
+ * dev_bw_request - declare the memory bandwidth used by a device
+ * @device: bus device of the domain
+ * @dev: requesting device
+ * @port: bus port of @dev, for devices with several masters
+ * @rd_mbps: read bandwidth in MB/s
+ * @wr_mbps: write bandwidth in MB/s
+ *
+ * The bus is kept at the lowest level which carries the demand of all
+ * requests of the domain. A new request for the same @dev and @port
+ * replaces the old one; 0 for both directions drops it.
+ */
+int dev_bw_request(struct device *device, struct device *dev,
+		unsigned int port, unsigned int rd_mbps, unsigned int wr_mbps)
+{
+	struct device_domain *domain;
+	struct domain_bw *bw;
+	unsigned long freq;
+
+	domain = find_device_domain(device);
+	if (IS_ERR(domain)) {
+		dev_err(dev, "Can't find device domain.\n");
+		return -EINVAL;
+	}
+
+	mutex_lock(&domains_mutex);
+	list_for_each_entry(bw, &domain->bw_list, node)
+		if (bw->device == dev && bw->port == port)
+			goto found;
+
+	if (!rd_mbps && !wr_mbps)
+		goto out;
+
+	bw = kzalloc(sizeof(struct domain_bw), GFP_KERNEL);
+	if (!bw) {
+		mutex_unlock(&domains_mutex);
+		return -ENOMEM;
+	}
+
+	bw->device = dev;
+	bw->port = port;
+	list_add(&bw->node, &domain->bw_list);
+found:
+	if (!rd_mbps && !wr_mbps) {
+		list_del(&bw->node);
+		kfree(bw);
+	} else {
+		bw->rd_mbps = rd_mbps;
+		bw->wr_mbps = wr_mbps;
+	}
+	dev_bw_update(domain);
+out:
+	freq = domain->bw_freq;
+	mutex_unlock(&domains_mutex);
+
+	if (freq)
+		exynos_request_apply(freq, false, false);
+
+	return 0;
+}
+
+/* Drops the requests of all ports of dev */
+void dev_bw_release(struct device *device, struct device *dev)
+{
+	struct device_domain *domain;
+	struct domain_bw *bw, *tmp;
+
+	domain = find_device_domain(device);
+	if (IS_ERR(domain))
+		return;
+
+	mutex_lock(&domains_mutex);
+	list_for_each_entry_safe(bw, tmp, &domain->bw_list, node) {
+		if (bw->device == dev) {
+			list_del(&bw->node);
+			kfree(bw);
+		}
+	}
+	dev_bw_update(domain);
+	mutex_unlock(&domains_mutex);
+}
+
 unsigned long dev_max_freq(struct device *device)
 {
 	struct device_domain *domain;
@@ -176,6 +283,9 @@ unsigned long dev_max_freq(struct device *device)
 		if (lock->freq > freq)
 			freq = lock->freq;
 
+	if (domain->bw_freq > freq)
+		freq = domain->bw_freq;
+
 	mutex_unlock(&domains_mutex);
 
 	return freq;
@@ -185,6 +295,7 @@ int dev_lock_list(struct device *device, char *buf)
 {
 	struct device_domain *domain;
 	struct domain_lock *lock;
+	struct domain_bw *bw;
 	int count = 0;
 
 	domain = find_device_domain(device);
@@ -198,6 +309,16 @@ int dev_lock_list(struct device *device, char *buf)
 	list_for_each_entry(lock, &domain->domain_list, node)
 		count += sprintf(buf + count, "%s : %lu\n", dev_name(lock->device), lock->freq);
 
+	if (!list_empty(&domain->bw_list)) {
+		count += sprintf(buf + count, "Bandwidth List : %lu\n",
+				domain->bw_freq);
+		list_for_each_entry(bw, &domain->bw_list, node)
+			count += sprintf(buf + count,
+					"%s port %u : rd %u wr %u MB/s\n",
+					dev_name(bw->device), bw->port,
+					bw->rd_mbps, bw->wr_mbps);
+	}
+
 	mutex_unlock(&domains_mutex);
 
 	return count;
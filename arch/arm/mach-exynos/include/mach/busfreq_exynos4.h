@@ -46,6 +46,13 @@ struct busfreq_data {
 	unsigned long long last_time;
 	unsigned int load_history[PPMU_END][LOAD_HISTORY_SIZE];
 	int index;
+	unsigned int load;		/* of the last decision, for tracing */
+
+	/* up-scaling from PPMU overflow interrupts */
+	unsigned int burst_irq;		/* mask of requested PPMU irqs */
+	bool burst_only_up;		/* all PPMUs raise interrupts */
+	unsigned int burst_load[PPMU_END];
+	struct work_struct burst_work;
 
 	struct notifier_block exynos_buspm_notifier;
 	struct notifier_block exynos_reboot_notifier;
@@ -55,6 +62,11 @@ struct busfreq_data {
 	struct attribute_group busfreq_attr_group;
 	int (*init)	(struct device *dev, struct busfreq_data *data, bool pop);
 	struct opp *(*monitor)(struct busfreq_data *data);
+	struct opp *(*burst)(struct busfreq_data *data, int id,
+			unsigned int load);
+	unsigned int (*burst_count)(struct busfreq_data *data, int id);
+	unsigned long (*bw_to_freq)(struct busfreq_data *data,
+			unsigned long mif_mbps, unsigned long int_mbps);
 	void (*target)	(int index);
 	unsigned int (*get_int_volt) (unsigned int index);
 	unsigned int (*get_table_index) (struct opp *opp);
@@ -74,6 +86,9 @@ struct busfreq_table {
 };
 
 void exynos_request_apply(unsigned long freq, bool fix, bool disable);
+void exynos_busfreq_limit(unsigned long freq);
+unsigned long exynos_busfreq_bw_to_freq(unsigned long mif_mbps,
+		unsigned long int_mbps);
 struct opp *step_down(struct busfreq_data *data, int step);
 
 int exynos4x12_init(struct device *dev, struct busfreq_data *data, bool pop);
@@ -81,6 +96,11 @@ void exynos4x12_target(int index);
 unsigned int exynos4x12_get_int_volt(unsigned int index);
 unsigned int exynos4x12_get_table_index(struct opp *opp);
 struct opp *exynos4x12_monitor(struct busfreq_data *data);
+struct opp *exynos4x12_burst(struct busfreq_data *data, int id,
+			unsigned int load);
+unsigned int exynos4x12_burst_count(struct busfreq_data *data, int id);
+unsigned long exynos4x12_bw_to_freq(struct busfreq_data *data,
+			unsigned long mif_mbps, unsigned long int_mbps);
 void exynos4x12_prepare(unsigned int index);
 void exynos4x12_post(unsigned int index);
 void exynos4x12_suspend(void);
@@ -80,6 +80,8 @@ struct busfreq_table {
 };
 
 void exynos_request_apply(unsigned long freq, bool fix, bool disable);
+unsigned long exynos_busfreq_bw_to_freq(unsigned long mif_mbps,
+		unsigned long int_mbps);
 unsigned long step_down(struct busfreq_data *data, enum ppmu_type type, int step);
 
 int exynos5250_init(struct device *dev, struct busfreq_data *data);
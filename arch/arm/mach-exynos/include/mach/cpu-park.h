@@ -0,0 +1,44 @@
+/* linux/arch/arm/mach-exynos/include/mach/cpu-park.h
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * EXYNOS - CPU parking and hotplug latency statistics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef __ASM_ARCH_CPU_PARK_H
+#define __ASM_ARCH_CPU_PARK_H __FILE__
+
+/* Points of a cpu_up()/cpu_down() which are time stamped */
+enum exynos_hotplug_mark {
+	HOTPLUG_UP_START,	/* first CPU_UP_PREPARE notifier */
+	HOTPLUG_UP_PREPARED,	/* last CPU_UP_PREPARE notifier */
+	HOTPLUG_UP_POWERED,	/* core power domain on */
+	HOTPLUG_UP_RELEASED,	/* core out of the holding pen */
+	HOTPLUG_UP_ONLINE,	/* first CPU_ONLINE notifier */
+	HOTPLUG_UP_DONE,	/* last CPU_ONLINE notifier */
+	HOTPLUG_DOWN_START,	/* first CPU_DOWN_PREPARE notifier */
+	HOTPLUG_DOWN_PREPARED,	/* last CPU_DOWN_PREPARE notifier */
+	HOTPLUG_DOWN_DEAD,	/* first CPU_DEAD notifier */
+	HOTPLUG_DOWN_DONE,	/* last CPU_DEAD notifier */
+	HOTPLUG_MARK_END,
+};
+
+#ifdef CONFIG_HOTPLUG_CPU
+extern void exynos_hotplug_mark(unsigned int cpu,
+				enum exynos_hotplug_mark mark);
+extern int exynos_cpu_park(unsigned int cpu, bool park);
+#else
+static inline void exynos_hotplug_mark(unsigned int cpu,
+				       enum exynos_hotplug_mark mark) { }
+static inline int exynos_cpu_park(unsigned int cpu, bool park)
+{
+	return -EINVAL;
+}
+#endif
+
+#endif /* __ASM_ARCH_CPU_PARK_H */
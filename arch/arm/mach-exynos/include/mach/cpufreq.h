@@ -10,6 +10,9 @@
  * published by the Free Software Foundation.
 */
 
+#include <linux/plist.h>
+#include <linux/workqueue.h>
+
 /* CPU frequency level index for using cpufreq lock API
  * This should be same with cpufreq_frequency_table
 */
@@ -46,6 +49,8 @@ enum cpufreq_lock_ID {
 
 int exynos_cpufreq_get_level(unsigned int freq,
 			unsigned int *level);
+int exynos_cpufreq_get_level_info(unsigned int level,
+			unsigned int *freq, unsigned int *volt);
 int exynos_find_cpufreq_level_by_volt(unsigned int arm_volt,
 			unsigned int *level);
 int exynos_cpufreq_lock(unsigned int nId,
@@ -60,6 +65,34 @@ int exynos_cpufreq_upper_limit(unsigned int nId,
 			enum cpufreq_level_index cpufreq_level);
 void exynos_cpufreq_upper_limit_free(unsigned int nId);
 
+enum exynos_cpufreq_req_type {
+	EXYNOS_CPUFREQ_REQ_MIN,		/* at least as fast as the level */
+	EXYNOS_CPUFREQ_REQ_MAX,		/* at most as fast as the level */
+};
+
+/* Must be zeroed before exynos_cpufreq_add_request() */
+struct exynos_cpufreq_req {
+	struct plist_node		node;	/* prio is the level */
+	enum exynos_cpufreq_req_type	type;
+	const char			*name;
+	unsigned long			expires;	/* jiffies, 0 if none */
+	struct delayed_work		work;
+};
+
+int exynos_cpufreq_add_request(struct exynos_cpufreq_req *req,
+			enum exynos_cpufreq_req_type type,
+			const char *name, unsigned int level);
+int exynos_cpufreq_update_request(struct exynos_cpufreq_req *req,
+			unsigned int level);
+int exynos_cpufreq_update_request_timeout(struct exynos_cpufreq_req *req,
+			unsigned int level, unsigned long timeout_us);
+void exynos_cpufreq_remove_request(struct exynos_cpufreq_req *req);
+
+static inline int exynos_cpufreq_request_active(struct exynos_cpufreq_req *req)
+{
+	return req->name != NULL;
+}
+
 /*
  * This level fix API set highset priority level lock.
  * Please use this carefully, with other lock API
@@ -68,6 +101,10 @@ int exynos_cpufreq_level_fix(unsigned int freq);
 void exynos_cpufreq_level_unfix(void);
 int exynos_cpufreq_is_fixed(void);
 
+struct cpufreq_policy;
+int exynos_cpufreq_fast_switch(struct cpufreq_policy *policy,
+			unsigned int target_freq, unsigned int relation);
+
 #define MAX_INDEX	10
 
 struct exynos_dvfs_info {
@@ -23,11 +23,23 @@ struct domain_lock {
 	unsigned long freq;
 };
 
+/* Bandwidth needed by one port of a device, in MB/s */
+struct domain_bw {
+	struct list_head node;
+
+	struct device *device;
+	unsigned int port;
+	unsigned int rd_mbps;
+	unsigned int wr_mbps;
+};
+
 struct device_domain {
 	struct list_head node;
 
 	struct device *device;
 	struct list_head domain_list;
+	struct list_head bw_list;
+	unsigned long bw_freq;		/* level meeting all of bw_list */
 };
 
 int dev_add(struct device_domain *domain, struct device *device);
@@ -37,6 +49,9 @@ int dev_lock(struct device *device, struct device *dev, unsigned long freq);
 int dev_lock_fix(struct device *device, struct device *dev, unsigned long freq);
 int dev_unlock(struct device *device, struct device *dev);
 void dev_unlock_fix(struct device *device, struct device *dev);
+int dev_bw_request(struct device *device, struct device *dev,
+		unsigned int port, unsigned int rd_mbps, unsigned int wr_mbps);
+void dev_bw_release(struct device *device, struct device *dev);
 unsigned long dev_max_freq(struct device *device);
 int dev_lock_list(struct device *dev, char *buf);
 
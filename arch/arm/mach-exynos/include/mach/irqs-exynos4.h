@@ -141,6 +141,10 @@
 #define COMBINER_GROUP(x)	((x) * MAX_IRQ_IN_COMBINER + IRQ_SPI(128))
 #define COMBINER_IRQ(x, y)	(COMBINER_GROUP(x) + y)
 
+#define IRQ_PPMU_CPU		COMBINER_IRQ(1, 5)
+#define IRQ_PPMU_DMC0		COMBINER_IRQ(1, 6)
+#define IRQ_PPMU_DMC1		COMBINER_IRQ(1, 7)
+
 #define IRQ_PMU_CPU0		COMBINER_IRQ(2, 2)
 #define IRQ_PMU			IRQ_PMU_CPU0
 #define IRQ_TMU			COMBINER_IRQ(2, 4)
@@ -0,0 +1,65 @@
+/* linux/arch/arm/mach-exynos/include/mach/mct-user.h
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * EXYNOS - User mapped MCT clock
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef __ASM_ARCH_MCT_USER_H
+#define __ASM_ARCH_MCT_USER_H __FILE__
+
+#include <linux/types.h>
+
+/*
+ * /dev/mct_clock maps read only, at page offset
+ *	MCT_USER_DATA_PGOFF	struct mct_user_data
+ *	MCT_USER_REGS_PGOFF	the MCT registers, the counter is at
+ *				MCT_USER_CNT_L and MCT_USER_CNT_U
+ *
+ * A reader loops until it sees the same even seq before and after:
+ *
+ *	do {
+ *		seq = data->seq;
+ *		rmb();
+ *		if (!data->valid)
+ *			return syscall(...);
+ *		do {
+ *			hi = regs[MCT_USER_CNT_U];
+ *			lo = regs[MCT_USER_CNT_L];
+ *		} while (hi != regs[MCT_USER_CNT_U]);
+ *		ns = ((((u64)hi << 32 | lo) - data->cycle_last) & data->mask)
+ *			* data->mult >> data->shift;
+ *		sec = data->mono_sec;
+ *		ns += data->mono_nsec;
+ *		rmb();
+ *	} while ((seq & 1) || seq != data->seq);
+ *
+ * and normalizes sec/ns. CLOCK_REALTIME uses wall_sec/wall_nsec.
+ */
+#define MCT_USER_DATA_PGOFF	0
+#define MCT_USER_REGS_PGOFF	1
+
+#define MCT_USER_CNT_L		(0x100 / 4)
+#define MCT_USER_CNT_U		(0x104 / 4)
+
+struct mct_user_data {
+	__u32	seq;		/* odd while being updated */
+	__u32	valid;		/* the MCT is the current clocksource */
+	__u64	cycle_last;	/* counter at the last update */
+	__u64	mask;
+	__u32	mult;
+	__u32	shift;
+	__u32	wall_sec;	/* CLOCK_REALTIME at cycle_last */
+	__u32	wall_nsec;
+	__u32	mono_sec;	/* CLOCK_MONOTONIC at cycle_last */
+	__u32	mono_nsec;
+	__s32	tz_minuteswest;
+	__s32	tz_dsttime;
+};
+
+#endif /* __ASM_ARCH_MCT_USER_H */
@@ -64,6 +64,9 @@ struct exynos4_c2c_pmu_conf {
 extern void exynos4_sys_powerdown_conf(enum sys_powerdown mode);
 extern int exynos4_enter_lp(unsigned long *saveblk, long);
 extern void exynos4_idle_resume(void);
+extern int exynos4_enter_core_lp(void __iomem *core_conf, long);
+extern void exynos4_core_resume(void);
+extern void exynos_power_up_cpu_at(unsigned int cpu, unsigned long entry);
 extern void exynos4_c2c_request_pwr_mode(enum c2c_pwr_mode mode);
 
 /* external function for exynos5 series */
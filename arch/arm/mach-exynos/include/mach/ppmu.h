@@ -94,6 +94,14 @@ struct exynos4_ppmu_hw {
 	int id;
 	struct device *dev;
 	unsigned int count[NUMBER_OF_COUNTER];
+	int irq;			/* overflow interrupt, 0 if none */
+	unsigned int ovf_count;		/* events per overflow interrupt */
+	unsigned long long preload;	/* counter value at period start */
+	unsigned long long ovf_total;	/* events counted by past overflows */
+	unsigned int ovf_ccnt;		/* cycle count at the last overflow */
+	/* called before the counters are cleared by exynos4_ppmu_reset() */
+	void (*reset_notify)(struct exynos4_ppmu_hw *ppmu);
+	void *perf;			/* owned by the perf PMU, if any */
 };
 
 void exynos4_ppc_reset(struct exynos4_ppmu_hw *ppmu);
@@ -109,6 +117,9 @@ void exynos4_ppmu_stop(struct exynos4_ppmu_hw *ppmu);
 void exynos4_ppmu_setevent(struct exynos4_ppmu_hw *ppmu,
 				   unsigned int evt_num);
 unsigned long long exynos4_ppmu_update(struct exynos4_ppmu_hw *ppmu, int ch);
+void exynos4_ppmu_set_overflow(struct exynos4_ppmu_hw *ppmu, int ch,
+				unsigned int count);
+int exynos4_ppmu_overflow(struct exynos4_ppmu_hw *ppmu, int ch);
 
 void ppmu_init(struct exynos4_ppmu_hw *ppmu, struct device *dev);
 void ppmu_start(struct device *dev);
@@ -13,6 +13,8 @@
 #ifndef _S5P_THERMAL_H
 #define _S5P_THERMAL_H
 
+#include <linux/cpumask.h>
+
 #define MUX_ADDR_VALUE 6
 #define TMU_SAVE_NUM 10
 #define TMU_DC_VALUE 25
@@ -106,14 +108,54 @@ struct tmu_info {
 	unsigned int busfreq_tc;
 	unsigned int g3dlevel_tc;
 
+	struct thermal_zone_device *tz;
+
 	struct delayed_work polling;
 	struct delayed_work monitor;
 	unsigned int reg_save[TMU_SAVE_NUM];
-#if defined(CONFIG_BUSFREQ_OPP) && defined(CONFIG_TC_VOLTAGE)
+#ifdef CONFIG_BUSFREQ_OPP
 	struct device *bus_dev;
 #endif
 };
 
+/* Cooling devices of tmu-cooling.c */
+enum tmu_cooling_id {
+	TMU_COOLING_CPUFREQ,
+	TMU_COOLING_BUSFREQ,
+	TMU_COOLING_HOTPLUG,
+	TMU_COOLING_END,
+};
+
+struct thermal_zone_device;
+struct thermal_cooling_device;
+struct dentry;
+
+int tmu_cooling_init(struct tmu_info *info);
+void tmu_cooling_exit(void);
+int tmu_cooling_set(enum tmu_cooling_id id, unsigned int state);
+unsigned int tmu_cooling_get(enum tmu_cooling_id id);
+unsigned int tmu_cooling_nr_states(enum tmu_cooling_id id);
+int tmu_cooling_get_state_info(enum tmu_cooling_id id, unsigned int state,
+			unsigned long *freq, unsigned int *volt);
+unsigned int tmu_cooling_cpufreq_state(unsigned int level);
+int tmu_cooling_bind(struct thermal_zone_device *tz, int trip,
+			struct thermal_cooling_device *cdev, bool bind);
+#if defined(CONFIG_EXYNOS_THERMAL) && defined(CONFIG_HOTPLUG_CPU)
+const struct cpumask *tmu_cooling_held_cpus(void);
+#else
+static inline const struct cpumask *tmu_cooling_held_cpus(void)
+{
+	return cpu_none_mask;
+}
+#endif
+#ifdef CONFIG_DEBUG_FS
+void tmu_cooling_debugfs_init(struct dentry *dir);
+#else
+static inline void tmu_cooling_debugfs_init(struct dentry *dir)
+{
+}
+#endif
+
 void exynos_tmu_set_platdata(struct tmu_data *pd);
 struct tmu_info *exynos_tmu_get_platdata(void);
 int exynos_tmu_get_irqno(int num);
@@ -0,0 +1,174 @@
+/* linux/arch/arm/mach-exynos/mct-user.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * EXYNOS - User mapped MCT clock
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+/*
+ * ARM has no vDSO in this kernel. Instead the timekeeping data is kept in
+ * a page updated from update_vsyscall(), and /dev/mct_clock maps it along
+ * with the MCT registers read only, so userspace computes clock_gettime()
+ * from the free running counter without a system call. The layout and the
+ * read sequence are in <mach/mct-user.h>.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/gfp.h>
+#include <linux/time.h>
+#include <linux/clocksource.h>
+#include <linux/miscdevice.h>
+#include <linux/spinlock.h>
+
+#include <mach/map.h>
+#include <mach/mct-user.h>
+
+#ifdef CONFIG_ARCH_EXYNOS4
+#define MCT_USER_PA_SYSTIMER	EXYNOS4_PA_SYSTIMER
+#else
+#define MCT_USER_PA_SYSTIMER	EXYNOS5_PA_SYSTIMER
+#endif
+
+extern struct clocksource mct_frc;
+
+static struct mct_user_data *mct_user_data;
+
+/* update_vsyscall_tz() is not called under xtime_lock */
+static DEFINE_SPINLOCK(mct_user_lock);
+
+static inline void mct_user_write_begin(struct mct_user_data *data,
+					unsigned long *flags)
+{
+	spin_lock_irqsave(&mct_user_lock, *flags);
+	data->seq++;
+	smp_wmb();
+}
+
+static inline void mct_user_write_end(struct mct_user_data *data,
+				      unsigned long *flags)
+{
+	smp_wmb();
+	data->seq++;
+	spin_unlock_irqrestore(&mct_user_lock, *flags);
+}
+
+/* Called with xtime_lock held for writing */
+void update_vsyscall(struct timespec *ts, struct timespec *wtm,
+		     struct clocksource *c, u32 mult)
+{
+	struct mct_user_data *data = mct_user_data;
+	struct timespec mono;
+	unsigned long flags;
+
+	if (!data)
+		return;
+
+	set_normalized_timespec(&mono, ts->tv_sec + wtm->tv_sec,
+				ts->tv_nsec + wtm->tv_nsec);
+
+	mct_user_write_begin(data, &flags);
+	data->valid = c == &mct_frc;
+	data->cycle_last = c->cycle_last;
+	data->mask = c->mask;
+	data->mult = mult;
+	data->shift = c->shift;
+	data->wall_sec = ts->tv_sec;
+	data->wall_nsec = ts->tv_nsec;
+	data->mono_sec = mono.tv_sec;
+	data->mono_nsec = mono.tv_nsec;
+	mct_user_write_end(data, &flags);
+}
+
+void update_vsyscall_tz(void)
+{
+	struct mct_user_data *data = mct_user_data;
+	unsigned long flags;
+
+	if (!data)
+		return;
+
+	mct_user_write_begin(data, &flags);
+	data->tz_minuteswest = sys_tz.tz_minuteswest;
+	data->tz_dsttime = sys_tz.tz_dsttime;
+	mct_user_write_end(data, &flags);
+}
+
+static int mct_user_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long addr = vma->vm_start;
+	unsigned long pgoff = vma->vm_pgoff;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (pgoff > MCT_USER_REGS_PGOFF ||
+	    size > (MCT_USER_REGS_PGOFF + 1 - pgoff) << PAGE_SHIFT)
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_IO | VM_RESERVED;
+
+	if (pgoff == MCT_USER_DATA_PGOFF) {
+		if (remap_pfn_range(vma, addr,
+				    virt_to_phys(mct_user_data) >> PAGE_SHIFT,
+				    PAGE_SIZE, vma->vm_page_prot))
+			return -EAGAIN;
+
+		addr += PAGE_SIZE;
+		if (addr == vma->vm_end)
+			return 0;
+	}
+
+	if (io_remap_pfn_range(vma, addr, MCT_USER_PA_SYSTIMER >> PAGE_SHIFT,
+			       PAGE_SIZE, pgprot_noncached(vma->vm_page_prot)))
+		return -EAGAIN;
+
+	return 0;
+}
+
+static const struct file_operations mct_user_fops = {
+	.owner		= THIS_MODULE,
+	.mmap		= mct_user_mmap,
+};
+
+static struct miscdevice mct_user_dev = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= "mct_clock",
+	.fops		= &mct_user_fops,
+};
+
+static int __init mct_user_init(void)
+{
+	struct mct_user_data *data;
+	int ret;
+
+	data = (struct mct_user_data *)get_zeroed_page(GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	SetPageReserved(virt_to_page(data));
+
+	/* filled in at the next timekeeping update */
+	mct_user_data = data;
+	update_vsyscall_tz();
+
+	ret = misc_register(&mct_user_dev);
+	if (ret) {
+		pr_err("%s: failed to register mct_clock\n", __func__);
+		mct_user_data = NULL;
+		ClearPageReserved(virt_to_page(data));
+		free_page((unsigned long)data);
+	}
+
+	return ret;
+}
+device_initcall(mct_user_init);
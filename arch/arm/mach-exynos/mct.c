@@ -19,6 +19,9 @@
 #include <linux/platform_device.h>
 #include <linux/delay.h>
 #include <linux/percpu.h>
+#include <linux/moduleparam.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <plat/cpu.h>
 
@@ -26,6 +29,7 @@
 #include <mach/regs-mct.h>
 
 #include <asm/mach/time.h>
+#include <asm/sched_clock.h>
 #include <asm/hardware/gic.h>
 
 #define TICK_BASE_CNT 1
@@ -39,19 +43,61 @@ static unsigned long clk_cnt_per_tick;
 static unsigned long clk_rate;
 static unsigned int mct_int_type;
 
+/*
+ * Statistics of a local timer, all updated by its own CPU. wait_cycles
+ * are in FRC cycles.
+ */
+struct mct_tick_stats {
+	unsigned long ticks;		/* interrupts */
+	unsigned long programs;		/* set_next_event calls */
+	unsigned long coalesced;	/* events moved onto the grid */
+	unsigned long writes;
+	unsigned long waits;		/* writes waited for */
+	u64 wait_cycles;
+	u32 wait_max;
+	unsigned long since;		/* jiffies at reset */
+};
+
 struct mct_clock_event_device {
 	struct clock_event_device *evt;
 	void __iomem *base;
 	char name[10];
+	u32 tcon;			/* last value written to L_TCON */
+	u32 wstat_pending;		/* L_WSTAT bits of posted writes */
+	struct mct_tick_stats stats;
 };
 
 struct mct_clock_event_device mct_tick[NR_CPUS];
 
+/*
+ * Wakeups of idle CPUs are aligned to a grid of coalesce_us on the global
+ * counter, so idle CPUs wake up together and the cluster stays idle in
+ * between. An event is delayed by less than coalesce_us, like a timer
+ * with that much slack.
+ */
+static unsigned int coalesce_us = 50;
+module_param(coalesce_us, uint, 0644);
+MODULE_PARM_DESC(coalesce_us, "grid for idle CPU wakeups, 0 is off");
+
+static void exynos4_mct_wait(void __iomem *stat_addr, u32 mask,
+			     unsigned int value, void *addr)
+{
+	u32 i;
+
+	/* Wait until written values are applied */
+	for (i = 0; i < 0x1000; i++)
+		if ((__raw_readl(stat_addr) & mask) == mask) {
+			__raw_writel(mask, stat_addr);
+			return;
+		}
+
+	panic("MCT hangs after writing %d (addr:0x%08x)\n", value, (u32)addr);
+}
+
 static void exynos4_mct_write(unsigned int value, void *addr)
 {
 	void __iomem *stat_addr;
 	u32 mask;
-	u32 i;
 
 	__raw_writel(value, addr);
 
@@ -104,14 +150,7 @@ static void exynos4_mct_write(unsigned int value, void *addr)
 		}
 	}
 
-	/* Wait until written values are applied */
-	for (i = 0; i < 0x1000; i++)
-		if (__raw_readl(stat_addr) & mask) {
-			__raw_writel(mask, stat_addr);
-			return;
-		}
-
-	panic("MCT hangs after writing %d (addr:0x%08x)\n", value, (u32)addr);
+	exynos4_mct_wait(stat_addr, mask, value, addr);
 }
 
 /* Clocksource handling */
@@ -158,16 +197,35 @@ struct clocksource mct_frc = {
 	.rating		= 400,
 	.read		= exynos4_frc_read,
 	.mask		= CLOCKSOURCE_MASK(64),
-	.flags		= CLOCK_SOURCE_IS_CONTINUOUS |
-			  CLOCK_SOURCE_SCHED_CLOCK,
+	.flags		= CLOCK_SOURCE_IS_CONTINUOUS,
 	.suspend	= exynos4_frc_suspend,
 	.resume		= exynos4_frc_resume,
 };
 
+/*
+ * sched_clock runs off the low word of the FRC from timer init on, one
+ * register read instead of the hi/lo/hi loop of the clocksource. The
+ * FRC is restored on resume, so it does not go backwards.
+ */
+static DEFINE_CLOCK_DATA(cd);
+
+unsigned long long notrace sched_clock(void)
+{
+	return cyc_to_sched_clock(&cd, __raw_readl(EXYNOS4_MCT_G_CNT_L),
+				  (u32)~0);
+}
+
+static void notrace exynos4_update_sched_clock(void)
+{
+	update_sched_clock(&cd, __raw_readl(EXYNOS4_MCT_G_CNT_L), (u32)~0);
+}
+
 static void __init exynos4_clocksource_init(void)
 {
 	exynos4_mct_frc_start(0, 0);
 
+	init_sched_clock(&cd, exynos4_update_sched_clock, 32, clk_rate);
+
 	if (clocksource_register_hz(&mct_frc, clk_rate))
 		panic("%s: can't register clocksource\n", mct_frc.name);
 }
@@ -274,18 +332,77 @@ static void exynos4_clockevent_init(void)
 }
 
 #ifdef CONFIG_LOCAL_TIMERS
+/*
+ * Local timer writes are posted: the write status of a register is only
+ * waited for right before a write which depends on it, which is mostly
+ * long done by then. ICNTB must be applied before the interrupt counter
+ * is started, and L_TCON before ICNTB is reloaded.
+ */
+static u32 exynos4_mct_l_wstat(unsigned long offset)
+{
+	switch (offset) {
+	case MCT_L_TCON_OFFSET:
+		return 1 << 3;		/* L_TCON write status */
+	case MCT_L_ICNTB_OFFSET:
+		return 1 << 1;		/* L_ICNTB write status */
+	case MCT_L_TCNTB_OFFSET:
+		return 1 << 0;		/* L_TCNTB write status */
+	}
+
+	return 0;
+}
+
+static void exynos4_mct_l_sync(struct mct_clock_event_device *mevt,
+			       unsigned long offset)
+{
+	u32 mask = exynos4_mct_l_wstat(offset) & mevt->wstat_pending;
+	u32 start, wait;
+
+	if (!mask)
+		return;
+
+	start = (u32)exynos4_frc_read(&mct_frc);
+	exynos4_mct_wait(mevt->base + MCT_L_WSTAT_OFFSET, mask, 0,
+			 mevt->base + offset);
+	wait = (u32)exynos4_frc_read(&mct_frc) - start;
+
+	mevt->wstat_pending &= ~mask;
+	mevt->stats.waits++;
+	mevt->stats.wait_cycles += wait;
+	if (wait > mevt->stats.wait_max)
+		mevt->stats.wait_max = wait;
+}
+
+static void exynos4_mct_l_write(struct mct_clock_event_device *mevt,
+				unsigned int value, unsigned long offset)
+{
+	/* a register is not written again before the last write landed */
+	exynos4_mct_l_sync(mevt, offset);
+
+	__raw_writel(value, mevt->base + offset);
+	mevt->wstat_pending |= exynos4_mct_l_wstat(offset);
+	mevt->stats.writes++;
+
+	if (offset == MCT_L_TCON_OFFSET)
+		mevt->tcon = value;
+}
+
+/* forget the posted writes and the cached L_TCON, after a reset */
+static void exynos4_mct_l_reset(struct mct_clock_event_device *mevt)
+{
+	__raw_writel(__raw_readl(mevt->base + MCT_L_WSTAT_OFFSET),
+		     mevt->base + MCT_L_WSTAT_OFFSET);
+	mevt->wstat_pending = 0;
+	mevt->tcon = __raw_readl(mevt->base + MCT_L_TCON_OFFSET);
+}
+
 /* Clock event handling */
 static void exynos4_mct_tick_stop(struct mct_clock_event_device *mevt)
 {
-	unsigned long tmp;
 	unsigned long mask = MCT_L_TCON_INT_START | MCT_L_TCON_TIMER_START;
-	void __iomem *addr = mevt->base + MCT_L_TCON_OFFSET;
 
-	tmp = __raw_readl(addr);
-	if (tmp & mask) {
-		tmp &= ~mask;
-		exynos4_mct_write(tmp, addr);
-	}
+	if (mevt->tcon & mask)
+		exynos4_mct_l_write(mevt, mevt->tcon & ~mask, MCT_L_TCON_OFFSET);
 }
 
 static void exynos4_mct_tick_start(unsigned long cycles,
@@ -293,20 +410,49 @@ static void exynos4_mct_tick_start(unsigned long cycles,
 {
 	unsigned long tmp;
 
-	exynos4_mct_tick_stop(mevt);
+	/* the timer keeps running, only the interrupt counter is reloaded */
+	if (mevt->tcon & MCT_L_TCON_INT_START)
+		exynos4_mct_l_write(mevt, mevt->tcon & ~MCT_L_TCON_INT_START,
+				    MCT_L_TCON_OFFSET);
 
 	tmp = (1 << 31) | cycles;	/* MCT_L_UPDATE_ICNTB */
 
 	/* update interrupt count buffer */
-	exynos4_mct_write(tmp, mevt->base + MCT_L_ICNTB_OFFSET);
+	exynos4_mct_l_sync(mevt, MCT_L_TCON_OFFSET);
+	exynos4_mct_l_write(mevt, tmp, MCT_L_ICNTB_OFFSET);
+
+	exynos4_mct_l_sync(mevt, MCT_L_ICNTB_OFFSET);
+	exynos4_mct_l_write(mevt, mevt->tcon | MCT_L_TCON_INT_START |
+			    MCT_L_TCON_TIMER_START | MCT_L_TCON_INTERVAL_MODE,
+			    MCT_L_TCON_OFFSET);
+}
+
+static unsigned long exynos4_mct_coalesce(struct mct_clock_event_device *mevt,
+					  unsigned long cycles)
+{
+	u32 grid, late;
+	u64 expires;
 
-	/* enable MCT tick interrupt */
-	exynos4_mct_write(0x1, mevt->base + MCT_L_INT_ENB_OFFSET);
+	if (!coalesce_us || !idle_cpu(smp_processor_id()))
+		return cycles;
 
-	tmp = __raw_readl(mevt->base + MCT_L_TCON_OFFSET);
-	tmp |= MCT_L_TCON_INT_START | MCT_L_TCON_TIMER_START |
-	       MCT_L_TCON_INTERVAL_MODE;
-	exynos4_mct_write(tmp, mevt->base + MCT_L_TCON_OFFSET);
+	/* in local timer cycles, which run at 1/(TICK_BASE_CNT + 1) */
+	grid = coalesce_us * (clk_rate / (TICK_BASE_CNT + 1) / USEC_PER_SEC);
+	if (!grid)
+		return cycles;
+
+	expires = exynos4_frc_read(&mct_frc) / (TICK_BASE_CNT + 1) + cycles;
+	late = do_div(expires, grid);
+	if (!late)
+		return cycles;
+
+	late = grid - late;
+	if (cycles + late > 0x7fffffff)
+		return cycles;
+
+	mevt->stats.coalesced++;
+
+	return cycles + late;
 }
 
 static int exynos4_tick_set_next_event(unsigned long cycles,
@@ -314,8 +460,11 @@ static int exynos4_tick_set_next_event(unsigned long cycles,
 {
 	struct mct_clock_event_device *mevt = &mct_tick[smp_processor_id()];
 
+	mevt->stats.programs++;
+
 	if (cpu_online(smp_processor_id()))
-		exynos4_mct_tick_start(cycles, mevt);
+		exynos4_mct_tick_start(exynos4_mct_coalesce(mevt, cycles),
+				       mevt);
 
 	return 0;
 }
@@ -325,6 +474,9 @@ static inline void exynos4_tick_set_mode(enum clock_event_mode mode,
 {
 	struct mct_clock_event_device *mevt = &mct_tick[smp_processor_id()];
 
+	if (mode == CLOCK_EVT_MODE_RESUME)
+		exynos4_mct_l_reset(mevt);
+
 	exynos4_mct_tick_stop(mevt);
 
 	switch (mode) {
@@ -339,7 +491,8 @@ static inline void exynos4_tick_set_mode(enum clock_event_mode mode,
 		break;
 
 	case CLOCK_EVT_MODE_RESUME:
-		exynos4_mct_write(TICK_BASE_CNT, mevt->base + MCT_L_TCNTB_OFFSET);
+		exynos4_mct_l_write(mevt, TICK_BASE_CNT, MCT_L_TCNTB_OFFSET);
+		exynos4_mct_l_write(mevt, 0x1, MCT_L_INT_ENB_OFFSET);
 		break;
 	}
 }
@@ -353,8 +506,10 @@ static inline int exynos4_mct_tick_clear(struct mct_clock_event_device *mevt)
 	 * Mct would generate interrupt periodically
 	 * without explicit stopping.
 	 */
-	if (evt->mode != CLOCK_EVT_MODE_PERIODIC)
-		exynos4_mct_tick_stop(mevt);
+	if (evt->mode != CLOCK_EVT_MODE_PERIODIC &&
+	    (mevt->tcon & MCT_L_TCON_INT_START))
+		exynos4_mct_l_write(mevt, mevt->tcon & ~MCT_L_TCON_INT_START,
+				    MCT_L_TCON_OFFSET);
 
 	/*
 	 * Clear the MCT tick interrupt.
@@ -362,8 +517,9 @@ static inline int exynos4_mct_tick_clear(struct mct_clock_event_device *mevt)
 	 * it should be cleared twice.
 	 */
 	if (__raw_readl(mevt->base + MCT_L_INT_CSTAT_OFFSET) & 1) {
-		exynos4_mct_write(0x1, mevt->base + MCT_L_INT_CSTAT_OFFSET);
-		exynos4_mct_write(0x1, mevt->base + MCT_L_INT_CSTAT_OFFSET);
+		exynos4_mct_l_write(mevt, 0x1, MCT_L_INT_CSTAT_OFFSET);
+		exynos4_mct_l_write(mevt, 0x1, MCT_L_INT_CSTAT_OFFSET);
+		mevt->stats.ticks++;
 		return 1;
 	} else {
 		return 0;
@@ -403,11 +559,24 @@ static void exynos4_mct_tick_init(struct clock_event_device *evt)
 	mct_tick[cpu].base = EXYNOS4_MCT_L_BASE(cpu);
 	sprintf(mct_tick[cpu].name, "mct_tick%d", cpu);
 
+	exynos4_mct_l_reset(&mct_tick[cpu]);
+	memset(&mct_tick[cpu].stats, 0, sizeof(mct_tick[cpu].stats));
+	mct_tick[cpu].stats.since = jiffies;
+
+	exynos4_mct_l_write(&mct_tick[cpu], TICK_BASE_CNT, MCT_L_TCNTB_OFFSET);
+	exynos4_mct_l_write(&mct_tick[cpu], 0x1, MCT_L_INT_ENB_OFFSET);
+
 	evt->name = mct_tick[cpu].name;
 	evt->cpumask = cpumask_of(cpu);
 	evt->set_next_event = exynos4_tick_set_next_event;
 	evt->set_mode = exynos4_tick_set_mode;
-	evt->features = CLOCK_EVT_FEAT_PERIODIC | CLOCK_EVT_FEAT_ONESHOT;
+	/*
+	 * A core powered off by coupled AFTR does not take its tick
+	 * interrupt. mct-comp, replaced on CPU0 by this device, becomes
+	 * the broadcast device and wakes it instead.
+	 */
+	evt->features = CLOCK_EVT_FEAT_PERIODIC | CLOCK_EVT_FEAT_ONESHOT |
+			CLOCK_EVT_FEAT_C3STOP;
 	evt->rating = 450;
 
 	clockevents_calc_mult_shift(evt, clk_rate / (TICK_BASE_CNT + 1), 5);
@@ -418,8 +587,6 @@ static void exynos4_mct_tick_init(struct clock_event_device *evt)
 
 	clockevents_register_device(evt);
 
-	exynos4_mct_write(TICK_BASE_CNT, mct_tick[cpu].base + MCT_L_TCNTB_OFFSET);
-
 	if (mct_int_type == MCT_INT_SPI) {
 		if (cpu == 0) {
 			mct_tick0_event_irq.dev_id = &mct_tick[cpu];
@@ -450,6 +617,87 @@ int local_timer_ack(void)
 	return exynos4_mct_tick_clear(mevt);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static u64 exynos4_mct_cycles_to_ns(u64 cycles)
+{
+	return div_u64(cycles * NSEC_PER_USEC, clk_rate / USEC_PER_SEC);
+}
+
+static int exynos4_mct_stats_show(struct seq_file *s, void *data)
+{
+	struct mct_tick_stats *st;
+	unsigned long secs;
+	unsigned int cpu;
+
+	seq_printf(s, "%-4s %10s %8s %10s %10s %10s %10s %9s %9s\n",
+		   "cpu", "ticks", "ticks/s", "programs", "coalesced",
+		   "writes", "waits", "avg(ns)", "max(ns)");
+
+	for_each_possible_cpu(cpu) {
+		st = &mct_tick[cpu].stats;
+		if (!mct_tick[cpu].base)
+			continue;
+
+		secs = max(1UL, (jiffies - st->since) / HZ);
+
+		seq_printf(s, "%-4u %10lu %8lu %10lu %10lu %10lu %10lu %9llu %9llu\n",
+			   cpu, st->ticks, st->ticks / secs, st->programs,
+			   st->coalesced, st->writes, st->waits,
+			   exynos4_mct_cycles_to_ns(st->waits ?
+				div_u64(st->wait_cycles, st->waits) : 0),
+			   exynos4_mct_cycles_to_ns(st->wait_max));
+	}
+
+	return 0;
+}
+
+static int exynos4_mct_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, exynos4_mct_stats_show, inode->i_private);
+}
+
+/* any write restarts the statistics, each CPU clears its own */
+static void exynos4_mct_stats_reset(void *unused)
+{
+	struct mct_tick_stats *st = &mct_tick[smp_processor_id()].stats;
+
+	memset(st, 0, sizeof(*st));
+	st->since = jiffies;
+}
+
+static ssize_t exynos4_mct_stats_write(struct file *file,
+				       const char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	on_each_cpu(exynos4_mct_stats_reset, NULL, 1);
+
+	return count;
+}
+
+static const struct file_operations exynos4_mct_stats_fops = {
+	.open		= exynos4_mct_stats_open,
+	.read		= seq_read,
+	.write		= exynos4_mct_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init exynos4_mct_debugfs_init(void)
+{
+	struct dentry *root;
+
+	root = debugfs_create_dir("exynos_mct", NULL);
+	if (IS_ERR_OR_NULL(root))
+		return 0;
+
+	debugfs_create_file("stats", S_IRUGO | S_IWUSR, root, NULL,
+			    &exynos4_mct_stats_fops);
+
+	return 0;
+}
+late_initcall(exynos4_mct_debugfs_init);
+#endif
+
 #endif /* CONFIG_LOCAL_TIMERS */
 
 static void __init exynos4_timer_resources(void)
@@ -26,6 +26,7 @@
 #include <asm/smp_scu.h>
 #include <asm/unified.h>
 
+#include <mach/cpu-park.h>
 #include <mach/hardware.h>
 #include <mach/regs-clock.h>
 #include <mach/regs-pmu.h>
@@ -131,6 +132,25 @@ static int exynos_power_up_cpu(unsigned int cpu)
 	return 0;
 }
 
+/*
+ * Power @cpu up into @entry, a physical address, instead of the holding
+ * pen. cpuidle uses it to bring back a core it powered down, so it does
+ * not wait for the core to come up.
+ */
+void exynos_power_up_cpu_at(unsigned int cpu, unsigned long entry)
+{
+	__raw_writel(BSYM(entry), cpu_boot_info[cpu].boot_base);
+	__raw_writel(S5P_CORE_LOCAL_PWR_EN, cpu_boot_info[cpu].power_base);
+
+#ifdef CONFIG_ARM_TRUSTZONE
+	if (soc_is_exynos4412())
+		exynos_smc(SMC_CMD_CPU1BOOT, cpu, 0, 0);
+	else
+		exynos_smc(SMC_CMD_CPU1BOOT, 0, 0, 0);
+#endif
+	smp_send_reschedule(cpu);
+}
+
 #ifdef CONFIG_CACHE_L2X0
 static void enable_foz(void)
 {
@@ -166,6 +186,8 @@ int __cpuinit boot_secondary(unsigned int cpu, struct task_struct *idle)
 		return ret;
 	}
 
+	exynos_hotplug_mark(cpu, HOTPLUG_UP_POWERED);
+
 	/*
 	* Enable write full line for zeros mode
 	*/
@@ -212,6 +234,9 @@ int __cpuinit boot_secondary(unsigned int cpu, struct task_struct *idle)
 		udelay(10);
 	}
 
+	if (pen_release == -1)
+		exynos_hotplug_mark(cpu, HOTPLUG_UP_RELEASED);
+
 	/*
 	 * now the secondary core is starting up let it run its
 	 * calibrations, then wait for it to finish
@@ -16,15 +16,20 @@
 #include <linux/io.h>
 #include <linux/list.h>
 #include <linux/math64.h>
+#include <linux/spinlock.h>
 
 #include <plat/cpu.h>
 
 #include <mach/map.h>
 #include <mach/regs-clock.h>
+#include <mach/irqs.h>
 #include <mach/ppmu.h>
 
 static LIST_HEAD(ppmu_list);
 
+/* Serializes the sampling path against the overflow interrupt */
+static DEFINE_SPINLOCK(ppmu_lock);
+
 unsigned long long ppmu_load[PPMU_END];
 
 void exynos4_ppmu_reset(struct exynos4_ppmu_hw *ppmu)
@@ -32,9 +37,16 @@ void exynos4_ppmu_reset(struct exynos4_ppmu_hw *ppmu)
 	void __iomem *ppmu_base = ppmu->hw_base;
 	int i;
 
+	if (ppmu->reset_notify)
+		ppmu->reset_notify(ppmu);
+
 	__raw_writel(0x3 << 1, ppmu_base);
 	__raw_writel(0x8000000f, ppmu_base + PPMU_CNTENS);
 
+	ppmu->preload = 0;
+	ppmu->ovf_total = 0;
+	ppmu->ovf_ccnt = 0;
+
 	if (soc_is_exynos4210())
 		for (i = 0; i < NUMBER_OF_COUNTER; i++) {
 			__raw_writel(0x0, ppmu_base + DEVT0_ID + (i * DEVT_ID_OFFSET));
@@ -61,6 +73,109 @@ void exynos4_ppmu_stop(struct exynos4_ppmu_hw *ppmu)
 	__raw_writel(0x0, ppmu_base);
 }
 
+/* Counter 3 is 40 bits wide, split over PMCNT3 and PMCNT4, on EXYNOS4X12 */
+static inline bool exynos4_ppmu_wide(int ch)
+{
+	return ch == 3 && !soc_is_exynos4210();
+}
+
+static u64 exynos4_ppmu_read_count(struct exynos4_ppmu_hw *ppmu, int ch)
+{
+	void __iomem *ppmu_base = ppmu->hw_base;
+
+	if (exynos4_ppmu_wide(ch))
+		return ((u64)__raw_readl(ppmu_base + PMCNT_OFFSET(ch)) << 8) |
+			__raw_readl(ppmu_base + PMCNT_OFFSET(ch + 1));
+
+	return __raw_readl(ppmu_base + PMCNT_OFFSET(ch));
+}
+
+static void exynos4_ppmu_write_count(struct exynos4_ppmu_hw *ppmu, int ch,
+				     u64 val)
+{
+	void __iomem *ppmu_base = ppmu->hw_base;
+
+	if (exynos4_ppmu_wide(ch)) {
+		__raw_writel(val >> 8, ppmu_base + PMCNT_OFFSET(ch));
+		__raw_writel(val & 0xff, ppmu_base + PMCNT_OFFSET(ch + 1));
+	} else {
+		__raw_writel(val, ppmu_base + PMCNT_OFFSET(ch));
+	}
+}
+
+static inline u64 exynos4_ppmu_count_mask(int ch)
+{
+	return exynos4_ppmu_wide(ch) ? (1ULL << 40) - 1 : 0xffffffffULL;
+}
+
+/*
+ * Arms counter ch to raise its overflow interrupt after count more
+ * events, and again every count events after that. count 0 disarms.
+ */
+void exynos4_ppmu_set_overflow(struct exynos4_ppmu_hw *ppmu, int ch,
+			       unsigned int count)
+{
+	void __iomem *ppmu_base = ppmu->hw_base;
+	u64 mask = exynos4_ppmu_count_mask(ch);
+	u64 val;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ppmu_lock, flags);
+
+	__raw_writel(1 << ch, ppmu_base + PPMU_INTENC);
+	__raw_writel(1 << ch, ppmu_base + PPMU_FLAG);
+
+	/* keep the events counted so far in the sampling period */
+	val = (exynos4_ppmu_read_count(ppmu, ch) - ppmu->preload) & mask;
+	ppmu->ovf_count = count;
+	ppmu->preload = count ? (mask + 1 - count) & mask : 0;
+	ppmu->ovf_ccnt = __raw_readl(ppmu_base + PPMU_CCNT);
+	exynos4_ppmu_write_count(ppmu, ch, (ppmu->preload + val) & mask);
+
+	if (count)
+		__raw_writel(1 << ch, ppmu_base + PPMU_INTENS);
+
+	spin_unlock_irqrestore(&ppmu_lock, flags);
+}
+
+/*
+ * Handles the overflow interrupt of counter ch. Returns the load in
+ * percent of the last count events, or -ENODATA if the counter did not
+ * overflow.
+ */
+int exynos4_ppmu_overflow(struct exynos4_ppmu_hw *ppmu, int ch)
+{
+	void __iomem *ppmu_base = ppmu->hw_base;
+	u64 mask = exynos4_ppmu_count_mask(ch);
+	unsigned int ccnt, cycles;
+	unsigned long flags;
+	u64 val;
+
+	spin_lock_irqsave(&ppmu_lock, flags);
+
+	if (!(__raw_readl(ppmu_base + PPMU_FLAG) & (1 << ch)) ||
+	    !ppmu->ovf_count) {
+		spin_unlock_irqrestore(&ppmu_lock, flags);
+		return -ENODATA;
+	}
+
+	__raw_writel(1 << ch, ppmu_base + PPMU_FLAG);
+
+	ccnt = __raw_readl(ppmu_base + PPMU_CCNT);
+	cycles = ccnt - ppmu->ovf_ccnt;
+	ppmu->ovf_ccnt = ccnt;
+
+	/* rearm, keeping what was counted since the wrap */
+	ppmu->ovf_total += ppmu->ovf_count;
+	val = exynos4_ppmu_read_count(ppmu, ch);
+	exynos4_ppmu_write_count(ppmu, ch, (ppmu->preload + val) & mask);
+
+	spin_unlock_irqrestore(&ppmu_lock, flags);
+
+	return div64_u64((u64)ppmu->ovf_count * ppmu->weight * 100,
+			 cycles ? cycles : 1);
+}
+
 unsigned long long exynos4_ppmu_update(struct exynos4_ppmu_hw *ppmu, int ch)
 {
 	void __iomem *ppmu_base = ppmu->hw_base;
@@ -74,11 +189,9 @@ unsigned long long exynos4_ppmu_update(struct exynos4_ppmu_hw *ppmu, int ch)
 	if (ch >= NUMBER_OF_COUNTER || ppmu->event[ch] == 0)
 		return 0;
 
-	if (ch == 3 && !soc_is_exynos4210())
-		total = (((u64)__raw_readl(ppmu_base + PMCNT_OFFSET(ch)) << 8) |
-				__raw_readl(ppmu_base + PMCNT_OFFSET(ch + 1)));
-	else
-		total = __raw_readl(ppmu_base + PMCNT_OFFSET(ch));
+	total = (exynos4_ppmu_read_count(ppmu, ch) - ppmu->preload) &
+			exynos4_ppmu_count_mask(ch);
+	total += ppmu->ovf_total;
 
 	if (total > ppmu->ccnt)
 		total = ppmu->ccnt;
@@ -89,29 +202,37 @@ unsigned long long exynos4_ppmu_update(struct exynos4_ppmu_hw *ppmu, int ch)
 void ppmu_start(struct device *dev)
 {
 	struct exynos4_ppmu_hw *ppmu;
+	unsigned long flags;
 
+	spin_lock_irqsave(&ppmu_lock, flags);
 	list_for_each_entry(ppmu, &ppmu_list, node)
 		if (ppmu->dev == dev)
 			exynos4_ppmu_start(ppmu);
+	spin_unlock_irqrestore(&ppmu_lock, flags);
 }
 
 void ppmu_update(struct device *dev, int ch)
 {
 	struct exynos4_ppmu_hw *ppmu;
+	unsigned long flags;
 
+	spin_lock_irqsave(&ppmu_lock, flags);
 	list_for_each_entry(ppmu, &ppmu_list, node)
 		if (ppmu->dev == dev) {
 			exynos4_ppmu_stop(ppmu);
 			ppmu_load[ppmu->id] = exynos4_ppmu_update(ppmu, ch);
 			exynos4_ppmu_reset(ppmu);
 		}
+	spin_unlock_irqrestore(&ppmu_lock, flags);
 }
 
 void ppmu_reset(struct device *dev)
 {
 	struct exynos4_ppmu_hw *ppmu;
+	unsigned long flags;
 	int i;
 
+	spin_lock_irqsave(&ppmu_lock, flags);
 	list_for_each_entry(ppmu, &ppmu_list, node) {
 		if (ppmu->dev == dev) {
 			exynos4_ppmu_stop(ppmu);
@@ -121,6 +242,7 @@ void ppmu_reset(struct device *dev)
 			exynos4_ppmu_reset(ppmu);
 		}
 	}
+	spin_unlock_irqrestore(&ppmu_lock, flags);
 }
 
 void ppmu_init(struct exynos4_ppmu_hw *ppmu, struct device *dev)
@@ -148,18 +270,27 @@ struct exynos4_ppmu_hw exynos_ppmu[] = {
 		.hw_base = S5P_VA_PPMU_DMC0,
 		.event[3] = RDWR_DATA_COUNT,
 		.weight = DEFAULT_WEIGHT,
+#ifdef CONFIG_ARCH_EXYNOS4
+		.irq = IRQ_PPMU_DMC0,
+#endif
 	},
 	[PPMU_DMC1] = {
 		.id = PPMU_DMC1,
 		.hw_base = S5P_VA_PPMU_DMC1,
 		.event[3] = RDWR_DATA_COUNT,
 		.weight = DEFAULT_WEIGHT,
+#ifdef CONFIG_ARCH_EXYNOS4
+		.irq = IRQ_PPMU_DMC1,
+#endif
 	},
 	[PPMU_CPU] = {
 		.id = PPMU_CPU,
 		.hw_base = S5P_VA_PPMU_CPU,
 		.event[3] = RDWR_DATA_COUNT,
 		.weight = DEFAULT_WEIGHT,
+#ifdef CONFIG_ARCH_EXYNOS4
+		.irq = IRQ_PPMU_CPU,
+#endif
 	},
 #ifdef CONFIG_ARCH_EXYNOS5
 	[PPMU_DDR_C] = {
@@ -0,0 +1,578 @@
+/* linux/arch/arm/mach-exynos/ppmu_perf.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * EXYNOS - PPMU counters as perf_events PMUs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * Every PPMU block is registered as an uncore PMU named after the port it
+ * watches, e.g.
+ *
+ *	perf stat -a -e ppmu_dmc0/read_bytes/,ppmu_dmc1/write_bytes/ sleep 1
+ *
+ * config[7:0] selects the BEVTSEL event, or 0xff for the cycle counter.
+ * config[8] scales data beats to bytes by the width of the port.
+ *
+ * Counters 0-2 belong to perf. Counter 3 and the cycle counter are also
+ * used by busfreq, which clears them every sampling period, so the
+ * counts are folded in from exynos4_ppmu_reset() through reset_notify.
+ * The counters are 32 bits wide and are folded from a timer as well, well
+ * before they can wrap.
+ *
+ * fake=1 replaces the registers by a memory backend whose counters run
+ * from ktime at fake_mhz and count fake_load percent of the cycles, so
+ * the counter handling can be exercised without the hardware.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/io.h>
+#include <linux/device.h>
+#include <linux/hrtimer.h>
+#include <linux/spinlock.h>
+#include <linux/perf_event.h>
+
+#include <mach/ppmu.h>
+
+#define PPMU_PERF_COUNTERS	3	/* event counters used by perf */
+#define PPMU_PERF_CCNT		PPMU_PERF_COUNTERS
+#define PPMU_PERF_SLOTS		(PPMU_PERF_COUNTERS + 1)
+
+#define PPMU_PERF_EVENT_MASK	0xff
+#define PPMU_PERF_EVENT_MAX	0x3f
+#define PPMU_PERF_CYCLES	0xff
+#define PPMU_PERF_BYTES		(1 << 8)
+
+#define PPMU_PERF_POLL_NS	(1 * NSEC_PER_SEC)
+#define PPMU_PERF_BUS_BYTES	16	/* bytes per beat of a 128-bit port */
+
+#define PPMU_FAKE_SIZE		(PPMU_CNT_RESET + 4)
+
+static bool fake;
+module_param(fake, bool, 0444);
+MODULE_PARM_DESC(fake, "use a memory backend instead of the PPMU registers");
+
+static unsigned int fake_mhz = 400;
+module_param(fake_mhz, uint, 0644);
+MODULE_PARM_DESC(fake_mhz, "cycle rate of the fake backend");
+
+static unsigned int fake_load = 25;
+module_param(fake_load, uint, 0644);
+MODULE_PARM_DESC(fake_load, "percentage of fake cycles counted as events");
+
+struct ppmu_pmu;
+
+struct ppmu_perf_io {
+	u32 (*read)(struct ppmu_pmu *pp, unsigned int off);
+	void (*write)(struct ppmu_pmu *pp, unsigned int off, u32 val);
+};
+
+struct ppmu_pmu {
+	struct pmu pmu;
+	char name[16];
+	struct exynos4_ppmu_hw *hw;
+	const struct ppmu_perf_io *io;
+	unsigned int bus_bytes;
+
+	spinlock_t lock;
+	struct perf_event *events[PPMU_PERF_SLOTS];
+	int active;
+	struct hrtimer timer;
+
+	u32 *regs;			/* fake backend */
+	ktime_t stamp;
+};
+
+static inline struct ppmu_pmu *to_ppmu_pmu(struct pmu *pmu)
+{
+	return container_of(pmu, struct ppmu_pmu, pmu);
+}
+
+static u32 ppmu_mmio_read(struct ppmu_pmu *pp, unsigned int off)
+{
+	return __raw_readl(pp->hw->hw_base + off);
+}
+
+static void ppmu_mmio_write(struct ppmu_pmu *pp, unsigned int off, u32 val)
+{
+	__raw_writel(val, pp->hw->hw_base + off);
+}
+
+static const struct ppmu_perf_io ppmu_mmio_io = {
+	.read	= ppmu_mmio_read,
+	.write	= ppmu_mmio_write,
+};
+
+#define FAKE_REG(pp, off)	((pp)->regs[(off) / 4])
+
+/* Advance the fake counters by the time passed since the last access */
+static void ppmu_fake_advance(struct ppmu_pmu *pp)
+{
+	ktime_t now = ktime_get();
+	u64 cycles, events;
+	u32 enabled;
+	int i;
+
+	cycles = ktime_to_ns(ktime_sub(now, pp->stamp)) * fake_mhz;
+	do_div(cycles, NSEC_PER_USEC);
+	pp->stamp = now;
+
+	if (!(FAKE_REG(pp, 0) & 0x1))
+		return;
+
+	enabled = FAKE_REG(pp, PPMU_CNTENS);
+	if (enabled & (1 << 31))
+		FAKE_REG(pp, PPMU_CCNT) += (u32)cycles;
+
+	events = cycles * fake_load;
+	do_div(events, 100);
+
+	for (i = 0; i < NUMBER_OF_COUNTER; i++)
+		if (enabled & (1 << i))
+			FAKE_REG(pp, PMCNT_OFFSET(i)) += (u32)events;
+}
+
+static u32 ppmu_fake_read(struct ppmu_pmu *pp, unsigned int off)
+{
+	ppmu_fake_advance(pp);
+	return FAKE_REG(pp, off);
+}
+
+static void ppmu_fake_write(struct ppmu_pmu *pp, unsigned int off, u32 val)
+{
+	int i;
+
+	ppmu_fake_advance(pp);
+
+	switch (off) {
+	case 0:
+		if (val & (1 << 1))
+			for (i = 0; i < NUMBER_OF_COUNTER; i++)
+				FAKE_REG(pp, PMCNT_OFFSET(i)) = 0;
+		if (val & (1 << 2))
+			FAKE_REG(pp, PPMU_CCNT) = 0;
+		FAKE_REG(pp, 0) = val & 0x1;
+		break;
+	case PPMU_CNTENS:
+		FAKE_REG(pp, PPMU_CNTENS) |= val;
+		break;
+	case PPMU_CNTENC:
+		FAKE_REG(pp, PPMU_CNTENS) &= ~val;
+		break;
+	default:
+		FAKE_REG(pp, off) = val;
+		break;
+	}
+}
+
+static const struct ppmu_perf_io ppmu_fake_io = {
+	.read	= ppmu_fake_read,
+	.write	= ppmu_fake_write,
+};
+
+static inline unsigned int ppmu_perf_count_reg(int idx)
+{
+	return idx == PPMU_PERF_CCNT ? PPMU_CCNT : PMCNT_OFFSET(idx);
+}
+
+/* Fold the counter into the event, pp->lock held */
+static void ppmu_perf_event_update(struct ppmu_pmu *pp,
+				   struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	u32 now, delta;
+	u64 count;
+
+	now = pp->io->read(pp, ppmu_perf_count_reg(hwc->idx));
+	delta = now - (u32)local64_read(&hwc->prev_count);
+	local64_set(&hwc->prev_count, now);
+
+	count = delta;
+	if (hwc->config & PPMU_PERF_BYTES)
+		count *= pp->bus_bytes;
+
+	local64_add(count, &event->count);
+}
+
+static enum hrtimer_restart ppmu_perf_poll(struct hrtimer *timer)
+{
+	struct ppmu_pmu *pp = container_of(timer, struct ppmu_pmu, timer);
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&pp->lock, flags);
+	if (!pp->active) {
+		spin_unlock_irqrestore(&pp->lock, flags);
+		return HRTIMER_NORESTART;
+	}
+
+	for (i = 0; i < PPMU_PERF_SLOTS; i++) {
+		struct perf_event *event = pp->events[i];
+
+		if (event && !(event->hw.state & PERF_HES_STOPPED))
+			ppmu_perf_event_update(pp, event);
+	}
+	spin_unlock_irqrestore(&pp->lock, flags);
+
+	hrtimer_forward_now(timer, ns_to_ktime(PPMU_PERF_POLL_NS));
+	return HRTIMER_RESTART;
+}
+
+/*
+ * busfreq is about to clear the counters: take what they hold and
+ * restart the events from zero.
+ */
+static void ppmu_perf_reset_notify(struct exynos4_ppmu_hw *hw)
+{
+	struct ppmu_pmu *pp = hw->perf;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&pp->lock, flags);
+	for (i = 0; i < PPMU_PERF_SLOTS; i++) {
+		struct perf_event *event = pp->events[i];
+
+		if (event && !(event->hw.state & PERF_HES_STOPPED)) {
+			ppmu_perf_event_update(pp, event);
+			local64_set(&event->hw.prev_count, 0);
+		}
+	}
+	spin_unlock_irqrestore(&pp->lock, flags);
+}
+
+static int ppmu_perf_event_init(struct perf_event *event)
+{
+	u64 config = event->attr.config;
+	unsigned int evt = config & PPMU_PERF_EVENT_MASK;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* uncore counters: no sampling, no per-task or per-mode counting */
+	if (is_sampling_event(event) || event->cpu < 0)
+		return -EOPNOTSUPP;
+
+	if (event->attr.exclude_user || event->attr.exclude_kernel ||
+	    event->attr.exclude_hv || event->attr.exclude_idle)
+		return -EINVAL;
+
+	if (event->cpu != 0)
+		return -EINVAL;
+
+	if (config & ~(u64)(PPMU_PERF_EVENT_MASK | PPMU_PERF_BYTES))
+		return -EINVAL;
+
+	if (evt == PPMU_PERF_CYCLES) {
+		if (config & PPMU_PERF_BYTES)
+			return -EINVAL;
+	} else if (evt > PPMU_PERF_EVENT_MAX) {
+		return -EINVAL;
+	}
+
+	event->hw.config = config;
+	event->hw.idx = -1;
+
+	return 0;
+}
+
+static void ppmu_perf_start(struct perf_event *event, int flags)
+{
+	struct ppmu_pmu *pp = to_ppmu_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned int evt = hwc->config & PPMU_PERF_EVENT_MASK;
+	unsigned long irqflags;
+	bool first;
+
+	if (!(hwc->state & PERF_HES_STOPPED))
+		return;
+
+	spin_lock_irqsave(&pp->lock, irqflags);
+
+	if (hwc->idx != PPMU_PERF_CCNT) {
+		pp->io->write(pp, PPMU_BEVT0SEL +
+			      hwc->idx * PPMU_BEVTSEL_OFFSET, evt);
+		pp->io->write(pp, PPMU_CNTENS, 1 << hwc->idx);
+	} else {
+		pp->io->write(pp, PPMU_CNTENS, 1 << 31);
+	}
+
+	if (!(pp->io->read(pp, 0) & 0x1))
+		pp->io->write(pp, 0, 0x1);
+
+	local64_set(&hwc->prev_count,
+		    pp->io->read(pp, ppmu_perf_count_reg(hwc->idx)));
+	hwc->state = 0;
+
+	first = !pp->active++;
+	spin_unlock_irqrestore(&pp->lock, irqflags);
+
+	if (first)
+		hrtimer_start(&pp->timer, ns_to_ktime(PPMU_PERF_POLL_NS),
+			      HRTIMER_MODE_REL);
+}
+
+static void ppmu_perf_stop(struct perf_event *event, int flags)
+{
+	struct ppmu_pmu *pp = to_ppmu_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	spin_lock_irqsave(&pp->lock, irqflags);
+
+	/* the cycle counter keeps running for busfreq */
+	if (hwc->idx != PPMU_PERF_CCNT)
+		pp->io->write(pp, PPMU_CNTENC, 1 << hwc->idx);
+
+	ppmu_perf_event_update(pp, event);
+	hwc->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	pp->active--;
+
+	spin_unlock_irqrestore(&pp->lock, irqflags);
+}
+
+static int ppmu_perf_add(struct perf_event *event, int flags)
+{
+	struct ppmu_pmu *pp = to_ppmu_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+	int idx;
+
+	spin_lock_irqsave(&pp->lock, irqflags);
+	if ((hwc->config & PPMU_PERF_EVENT_MASK) == PPMU_PERF_CYCLES) {
+		idx = pp->events[PPMU_PERF_CCNT] ? -1 : PPMU_PERF_CCNT;
+	} else {
+		for (idx = 0; idx < PPMU_PERF_COUNTERS; idx++)
+			if (!pp->events[idx])
+				break;
+		if (idx == PPMU_PERF_COUNTERS)
+			idx = -1;
+	}
+
+	if (idx < 0) {
+		spin_unlock_irqrestore(&pp->lock, irqflags);
+		return -EAGAIN;
+	}
+
+	pp->events[idx] = event;
+	hwc->idx = idx;
+	hwc->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	spin_unlock_irqrestore(&pp->lock, irqflags);
+
+	if (flags & PERF_EF_START)
+		ppmu_perf_start(event, PERF_EF_RELOAD);
+
+	return 0;
+}
+
+static void ppmu_perf_del(struct perf_event *event, int flags)
+{
+	struct ppmu_pmu *pp = to_ppmu_pmu(event->pmu);
+	unsigned long irqflags;
+
+	ppmu_perf_stop(event, PERF_EF_UPDATE);
+
+	spin_lock_irqsave(&pp->lock, irqflags);
+	pp->events[event->hw.idx] = NULL;
+	event->hw.idx = -1;
+	spin_unlock_irqrestore(&pp->lock, irqflags);
+}
+
+static void ppmu_perf_read(struct perf_event *event)
+{
+	struct ppmu_pmu *pp = to_ppmu_pmu(event->pmu);
+	unsigned long flags;
+
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
+	spin_lock_irqsave(&pp->lock, flags);
+	ppmu_perf_event_update(pp, event);
+	spin_unlock_irqrestore(&pp->lock, flags);
+}
+
+/*
+ * The perf core of this kernel does not export formats and event aliases
+ * itself, so the files perf tools look for are added to the PMU device.
+ */
+struct ppmu_perf_attr {
+	struct device_attribute attr;
+	const char *str;
+};
+
+static ssize_t ppmu_perf_attr_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct ppmu_perf_attr *pattr =
+		container_of(attr, struct ppmu_perf_attr, attr);
+
+	return sprintf(buf, "%s\n", pattr->str);
+}
+
+#define PPMU_PERF_ATTR(_var, _name, _str)				\
+	static struct ppmu_perf_attr ppmu_perf_attr_##_var = {		\
+		.attr = __ATTR(_name, 0444, ppmu_perf_attr_show, NULL),	\
+		.str = _str,						\
+	}
+
+PPMU_PERF_ATTR(fmt_event, event, "config:0-7");
+PPMU_PERF_ATTR(fmt_bytes, bytes, "config:8");
+
+static struct attribute *ppmu_perf_format_attrs[] = {
+	&ppmu_perf_attr_fmt_event.attr.attr,
+	&ppmu_perf_attr_fmt_bytes.attr.attr,
+	NULL,
+};
+
+static struct attribute_group ppmu_perf_format_group = {
+	.name	= "format",
+	.attrs	= ppmu_perf_format_attrs,
+};
+
+PPMU_PERF_ATTR(read_beats, read_beats, "event=0x5");
+PPMU_PERF_ATTR(write_beats, write_beats, "event=0x6");
+PPMU_PERF_ATTR(beats, beats, "event=0x7");
+PPMU_PERF_ATTR(read_bytes, read_bytes, "event=0x5,bytes=1");
+PPMU_PERF_ATTR(write_bytes, write_bytes, "event=0x6,bytes=1");
+PPMU_PERF_ATTR(bytes, bytes, "event=0x7,bytes=1");
+PPMU_PERF_ATTR(cycles, cycles, "event=0xff");
+
+static struct attribute *ppmu_perf_events_attrs[] = {
+	&ppmu_perf_attr_read_beats.attr.attr,
+	&ppmu_perf_attr_write_beats.attr.attr,
+	&ppmu_perf_attr_beats.attr.attr,
+	&ppmu_perf_attr_read_bytes.attr.attr,
+	&ppmu_perf_attr_write_bytes.attr.attr,
+	&ppmu_perf_attr_bytes.attr.attr,
+	&ppmu_perf_attr_cycles.attr.attr,
+	NULL,
+};
+
+static struct attribute_group ppmu_perf_events_group = {
+	.name	= "events",
+	.attrs	= ppmu_perf_events_attrs,
+};
+
+/* all counting is done from cpu0 */
+PPMU_PERF_ATTR(cpumask, cpumask, "0");
+
+static struct attribute *ppmu_perf_cpumask_attrs[] = {
+	&ppmu_perf_attr_cpumask.attr.attr,
+	NULL,
+};
+
+static struct attribute_group ppmu_perf_cpumask_group = {
+	.attrs	= ppmu_perf_cpumask_attrs,
+};
+
+static const struct attribute_group *ppmu_perf_groups[] = {
+	&ppmu_perf_format_group,
+	&ppmu_perf_events_group,
+	&ppmu_perf_cpumask_group,
+	NULL,
+};
+
+static const char *ppmu_perf_names[PPMU_END] = {
+	[PPMU_DMC0]		= "ppmu_dmc0",
+	[PPMU_DMC1]		= "ppmu_dmc1",
+	[PPMU_CPU]		= "ppmu_cpu",
+#ifdef CONFIG_ARCH_EXYNOS5
+	[PPMU_DDR_C]		= "ppmu_ddr_c",
+	[PPMU_DDR_R1]		= "ppmu_ddr_r1",
+	[PPMU_DDR_L]		= "ppmu_ddr_l",
+	[PPMU_RIGHT0_BUS]	= "ppmu_right0_bus",
+#endif
+};
+
+static int __init ppmu_perf_register(struct exynos4_ppmu_hw *hw)
+{
+	struct ppmu_pmu *pp;
+	int i, ret;
+
+	pp = kzalloc(sizeof(*pp), GFP_KERNEL);
+	if (!pp)
+		return -ENOMEM;
+
+	strlcpy(pp->name, ppmu_perf_names[hw->id], sizeof(pp->name));
+	pp->hw = hw;
+	pp->bus_bytes = PPMU_PERF_BUS_BYTES;
+	spin_lock_init(&pp->lock);
+	hrtimer_init(&pp->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pp->timer.function = ppmu_perf_poll;
+
+	if (fake) {
+		pp->regs = kzalloc(PPMU_FAKE_SIZE, GFP_KERNEL);
+		if (!pp->regs) {
+			ret = -ENOMEM;
+			goto err_free;
+		}
+		pp->stamp = ktime_get();
+		pp->io = &ppmu_fake_io;
+	} else {
+		pp->io = &ppmu_mmio_io;
+	}
+
+	pp->pmu = (struct pmu) {
+		.task_ctx_nr	= perf_invalid_context,
+		.event_init	= ppmu_perf_event_init,
+		.add		= ppmu_perf_add,
+		.del		= ppmu_perf_del,
+		.start		= ppmu_perf_start,
+		.stop		= ppmu_perf_stop,
+		.read		= ppmu_perf_read,
+	};
+
+	ret = perf_pmu_register(&pp->pmu, pp->name, -1);
+	if (ret)
+		goto err_regs;
+
+	for (i = 0; pp->pmu.dev && ppmu_perf_groups[i]; i++) {
+		ret = sysfs_create_group(&pp->pmu.dev->kobj,
+					 ppmu_perf_groups[i]);
+		if (ret)
+			pr_warn("%s: failed to add sysfs attributes\n",
+				pp->name);
+	}
+
+	/* busfreq clears the real counters, not the fake ones */
+	if (!fake) {
+		hw->perf = pp;
+		hw->reset_notify = ppmu_perf_reset_notify;
+	}
+
+	return 0;
+
+err_regs:
+	kfree(pp->regs);
+err_free:
+	kfree(pp);
+	return ret;
+}
+
+static int __init ppmu_perf_init(void)
+{
+	int i, ret;
+
+	for (i = 0; i < PPMU_END; i++) {
+		if (!exynos_ppmu[i].hw_base || !ppmu_perf_names[i])
+			continue;
+
+		ret = ppmu_perf_register(&exynos_ppmu[i]);
+		if (ret)
+			pr_err("%s: failed to register PMU (%d)\n",
+			       ppmu_perf_names[i], ret);
+	}
+
+	return 0;
+}
+late_initcall(ppmu_perf_init);
@@ -0,0 +1,606 @@
+/* linux/arch/arm/mach-exynos/tmu-cooling.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * EXYNOS - TMU cooling devices and throttling statistics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+/*
+ * The limits the TMU applies are thermal cooling devices, bound to the
+ * throttle trip of the exynos-tmu thermal zone:
+ *
+ *	tmu-cpufreq	state n caps the CPUs at the n-th fastest level
+ *	tmu-busfreq	state n caps the bus at the n-th fastest level
+ *	tmu-hotplug	state n keeps the n highest CPUs offline, or
+ *			parked if the park parameter is set
+ *
+ * State 0 is no limit. The TMU governor sets them; a cur_state written
+ * from userspace holds until its next decision.
+ *
+ * The time in each state is accounted. Together with the capacity left in
+ * a state, e.g. its frequency against the fastest one, it gives the share
+ * of throughput lost to each cooling device. This is shown, along with the
+ * time spent with any of them limiting, in debugfs exynos_tmu/cooling.
+ * Writing to the file resets the statistics.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/cpumask.h>
+#include <linux/notifier.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/suspend.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/thermal.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#ifdef CONFIG_BUSFREQ_OPP
+#include <linux/opp.h>
+#endif
+
+#include <mach/cpufreq.h>
+#include <mach/cpu-park.h>
+#include <mach/tmu.h>
+#ifdef CONFIG_BUSFREQ_OPP
+#include <mach/busfreq_exynos4.h>
+#endif
+
+#define TMU_COOLING_MAX_STATES	24
+
+struct tmu_cooling {
+	char *type;
+	struct thermal_cooling_device *cdev;
+	unsigned int nr_states;		/* 0 when not available */
+	unsigned int state;
+	unsigned int level[TMU_COOLING_MAX_STATES];	/* cpufreq level */
+	unsigned long freq[TMU_COOLING_MAX_STATES];	/* kHz */
+	unsigned int volt[TMU_COOLING_MAX_STATES];	/* uV */
+	void (*set)(struct tmu_cooling *c, unsigned int state);
+
+	/* statistics */
+	u64 time[TMU_COOLING_MAX_STATES];		/* jiffies */
+	unsigned int transitions;
+	u64 last;
+};
+
+static DEFINE_MUTEX(cooling_lock);
+
+static u64 throttle_time;	/* jiffies with any device limiting */
+static u64 throttle_start;	/* 0 while nothing limits */
+static unsigned int throttle_count;
+static u64 stats_start;
+
+static struct exynos_cpufreq_req tmu_cpufreq_req;
+
+static void tmu_cpufreq_set(struct tmu_cooling *c, unsigned int state)
+{
+	if (!state)
+		exynos_cpufreq_remove_request(&tmu_cpufreq_req);
+	else if (!exynos_cpufreq_request_active(&tmu_cpufreq_req))
+		exynos_cpufreq_add_request(&tmu_cpufreq_req,
+					   EXYNOS_CPUFREQ_REQ_MAX, "tmu",
+					   c->level[state]);
+	else
+		exynos_cpufreq_update_request(&tmu_cpufreq_req,
+					      c->level[state]);
+}
+
+#ifdef CONFIG_BUSFREQ_OPP
+static void tmu_busfreq_set(struct tmu_cooling *c, unsigned int state)
+{
+	exynos_busfreq_limit(state ? c->freq[state] : 0);
+}
+#endif
+
+#ifdef CONFIG_HOTPLUG_CPU
+static bool park;
+module_param(park, bool, 0644);
+MODULE_PARM_DESC(park, "park held CPUs instead of taking them offline");
+
+/* CPUs the hotplug cooling device keeps offline or parked */
+static struct cpumask tmu_hotplug_held;
+
+/*
+ * Hotplug policies must not try to bring these back; a cpu_up() of one
+ * is refused by tmu_hotplug_notify().
+ */
+const struct cpumask *tmu_cooling_held_cpus(void)
+{
+	return &tmu_hotplug_held;
+}
+
+/* Called with cooling_lock held */
+static void tmu_hotplug_apply(void)
+{
+	unsigned int cpu;
+
+	for_each_cpu(cpu, &tmu_hotplug_held) {
+		if (!cpu_online(cpu) || sched_cpu_parked(cpu))
+			continue;
+		if (park && !exynos_cpu_park(cpu, true))
+			continue;
+		cpu_down(cpu);
+	}
+}
+
+static void tmu_hotplug_set(struct tmu_cooling *c, unsigned int state)
+{
+	struct cpumask held;
+	unsigned int cpu;
+
+	cpumask_clear(&held);
+	for (cpu = nr_cpu_ids - 1; cpu > 0 && state; cpu--) {
+		if (!cpu_possible(cpu))
+			continue;
+		cpumask_set_cpu(cpu, &held);
+		state--;
+	}
+	cpumask_copy(&tmu_hotplug_held, &held);
+
+	/* released CPUs are left to the hotplug policy to bring back */
+	tmu_hotplug_apply();
+}
+
+/* Refuses a cpu_up() of a held CPU which does not come from a policy */
+static int __cpuinit tmu_hotplug_notify(struct notifier_block *nb,
+					unsigned long action, void *hcpu)
+{
+	if (action == CPU_UP_PREPARE &&
+	    cpumask_test_cpu((unsigned long)hcpu, &tmu_hotplug_held))
+		return NOTIFY_BAD;
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __cpuinitdata tmu_hotplug_nb = {
+	.notifier_call = tmu_hotplug_notify,
+};
+
+/*
+ * Resume brings all CPUs back up with CPU_UP_PREPARE_FROZEN, which is not
+ * refused; take the held ones down again once it is done.
+ */
+static int tmu_hotplug_pm_notify(struct notifier_block *nb,
+				 unsigned long action, void *data)
+{
+	switch (action) {
+	case PM_POST_HIBERNATION:
+	case PM_POST_RESTORE:
+	case PM_POST_SUSPEND:
+		mutex_lock(&cooling_lock);
+		tmu_hotplug_apply();
+		mutex_unlock(&cooling_lock);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block tmu_hotplug_pm_nb = {
+	.notifier_call = tmu_hotplug_pm_notify,
+};
+#endif
+
+static struct tmu_cooling tmu_cooling[TMU_COOLING_END] = {
+	[TMU_COOLING_CPUFREQ] = {
+		.type	= "tmu-cpufreq",
+		.set	= tmu_cpufreq_set,
+	},
+#ifdef CONFIG_BUSFREQ_OPP
+	[TMU_COOLING_BUSFREQ] = {
+		.type	= "tmu-busfreq",
+		.set	= tmu_busfreq_set,
+	},
+#endif
+#ifdef CONFIG_HOTPLUG_CPU
+	[TMU_COOLING_HOTPLUG] = {
+		.type	= "tmu-hotplug",
+		.set	= tmu_hotplug_set,
+	},
+#endif
+};
+
+/* Capacity left in a state, in permille */
+static unsigned int tmu_cooling_capacity(struct tmu_cooling *c,
+					 unsigned int state)
+{
+	if (c == &tmu_cooling[TMU_COOLING_HOTPLUG])
+		return (c->nr_states - state) * 1000 / c->nr_states;
+
+	return c->freq[0] ? c->freq[state] * 1000 / c->freq[0] : 1000;
+}
+
+/* Called with cooling_lock held */
+static void tmu_cooling_account(struct tmu_cooling *c, u64 now)
+{
+	c->time[c->state] += now - c->last;
+	c->last = now;
+}
+
+/* Called with cooling_lock held */
+static void tmu_throttle_account(u64 now)
+{
+	bool limiting = false;
+	int i;
+
+	for (i = 0; i < TMU_COOLING_END; i++)
+		if (tmu_cooling[i].state)
+			limiting = true;
+
+	if (limiting && !throttle_start) {
+		throttle_start = now;
+		throttle_count++;
+	} else if (!limiting && throttle_start) {
+		throttle_time += now - throttle_start;
+		throttle_start = 0;
+	}
+}
+
+static int __tmu_cooling_set(struct tmu_cooling *c, unsigned int state)
+{
+	u64 now;
+
+	if (!c->nr_states || state >= c->nr_states)
+		return -EINVAL;
+
+	if (state == c->state)
+		return 0;
+
+	now = get_jiffies_64();
+	tmu_cooling_account(c, now);
+	c->set(c, state);
+	c->state = state;
+	c->transitions++;
+	tmu_throttle_account(now);
+
+	return 0;
+}
+
+int tmu_cooling_set(enum tmu_cooling_id id, unsigned int state)
+{
+	int ret;
+
+	mutex_lock(&cooling_lock);
+	ret = __tmu_cooling_set(&tmu_cooling[id], state);
+	mutex_unlock(&cooling_lock);
+
+	return ret;
+}
+
+unsigned int tmu_cooling_get(enum tmu_cooling_id id)
+{
+	return tmu_cooling[id].state;
+}
+
+unsigned int tmu_cooling_nr_states(enum tmu_cooling_id id)
+{
+	return tmu_cooling[id].nr_states;
+}
+
+/* Frequency and voltage of a cpufreq or busfreq state */
+int tmu_cooling_get_state_info(enum tmu_cooling_id id, unsigned int state,
+			       unsigned long *freq, unsigned int *volt)
+{
+	struct tmu_cooling *c = &tmu_cooling[id];
+
+	if (id == TMU_COOLING_HOTPLUG || state >= c->nr_states)
+		return -EINVAL;
+
+	*freq = c->freq[state];
+	*volt = c->volt[state];
+
+	return 0;
+}
+
+/* First cpufreq state at least as slow as @level */
+unsigned int tmu_cooling_cpufreq_state(unsigned int level)
+{
+	struct tmu_cooling *c = &tmu_cooling[TMU_COOLING_CPUFREQ];
+	unsigned int state;
+
+	for (state = 0; state + 1 < c->nr_states; state++)
+		if (c->level[state] >= level)
+			break;
+
+	return state;
+}
+
+/* Binds or unbinds @cdev to @trip if it is one of the TMU devices */
+int tmu_cooling_bind(struct thermal_zone_device *tz, int trip,
+		     struct thermal_cooling_device *cdev, bool bind)
+{
+	int i;
+
+	for (i = 0; i < TMU_COOLING_END; i++) {
+		if (!tmu_cooling[i].cdev || tmu_cooling[i].cdev != cdev)
+			continue;
+
+		if (bind)
+			return thermal_zone_bind_cooling_device(tz, trip, cdev);
+		return thermal_zone_unbind_cooling_device(tz, trip, cdev);
+	}
+
+	return 0;
+}
+
+static int tmu_cooling_get_max_state(struct thermal_cooling_device *cdev,
+				     unsigned long *state)
+{
+	struct tmu_cooling *c = cdev->devdata;
+
+	*state = c->nr_states - 1;
+	return 0;
+}
+
+static int tmu_cooling_get_cur_state(struct thermal_cooling_device *cdev,
+				     unsigned long *state)
+{
+	struct tmu_cooling *c = cdev->devdata;
+
+	*state = c->state;
+	return 0;
+}
+
+static int tmu_cooling_set_cur_state(struct thermal_cooling_device *cdev,
+				     unsigned long state)
+{
+	struct tmu_cooling *c = cdev->devdata;
+	int ret;
+
+	mutex_lock(&cooling_lock);
+	ret = __tmu_cooling_set(c, state);
+	mutex_unlock(&cooling_lock);
+
+	return ret;
+}
+
+static const struct thermal_cooling_device_ops tmu_cooling_ops = {
+	.get_max_state	= tmu_cooling_get_max_state,
+	.get_cur_state	= tmu_cooling_get_cur_state,
+	.set_cur_state	= tmu_cooling_set_cur_state,
+};
+
+static void tmu_cooling_init_cpufreq(struct tmu_cooling *c)
+{
+	struct cpufreq_frequency_table *table = cpufreq_frequency_get_table(0);
+	unsigned int level, freq, volt;
+
+	for (level = 0; table && table[level].frequency != CPUFREQ_TABLE_END &&
+	     c->nr_states < TMU_COOLING_MAX_STATES; level++) {
+		if (exynos_cpufreq_get_level_info(level, &freq, &volt))
+			continue;
+
+		c->level[c->nr_states] = level;
+		c->freq[c->nr_states] = freq;
+		c->volt[c->nr_states] = volt;
+		c->nr_states++;
+	}
+}
+
+#ifdef CONFIG_BUSFREQ_OPP
+static void tmu_cooling_init_busfreq(struct tmu_cooling *c,
+				     struct tmu_info *info)
+{
+	unsigned long freq = ULONG_MAX;
+	struct opp *opp;
+
+	if (IS_ERR_OR_NULL(info->bus_dev))
+		return;
+
+	rcu_read_lock();
+	while (freq && c->nr_states < TMU_COOLING_MAX_STATES) {
+		opp = opp_find_freq_floor(info->bus_dev, &freq);
+		if (IS_ERR(opp))
+			break;
+
+		c->freq[c->nr_states] = freq;
+		c->volt[c->nr_states] = opp_get_voltage(opp);
+		c->nr_states++;
+		freq--;
+	}
+	rcu_read_unlock();
+}
+#endif
+
+/*
+ * Fails if the CPUs can not be throttled, or one of the devices can not be
+ * registered. No device is usable then, tmu_cooling_set() returns -EINVAL
+ * for all of them.
+ */
+int tmu_cooling_init(struct tmu_info *info)
+{
+	struct tmu_cooling *c;
+	u64 now = get_jiffies_64();
+	int i, ret;
+
+	tmu_cooling_init_cpufreq(&tmu_cooling[TMU_COOLING_CPUFREQ]);
+#ifdef CONFIG_BUSFREQ_OPP
+	tmu_cooling_init_busfreq(&tmu_cooling[TMU_COOLING_BUSFREQ], info);
+#endif
+#ifdef CONFIG_HOTPLUG_CPU
+	tmu_cooling[TMU_COOLING_HOTPLUG].nr_states = num_possible_cpus();
+#endif
+
+	if (tmu_cooling[TMU_COOLING_CPUFREQ].nr_states < 2) {
+		pr_err("%s: no cpufreq levels to throttle to\n", __func__);
+		ret = -ENODEV;
+		goto err_states;
+	}
+
+	stats_start = now;
+
+	for (i = 0; i < TMU_COOLING_END; i++) {
+		c = &tmu_cooling[i];
+		c->last = now;
+
+		/* a single state can not limit anything */
+		if (c->nr_states < 2) {
+			c->nr_states = 0;
+			continue;
+		}
+
+		c->cdev = thermal_cooling_device_register(c->type, c,
+							  &tmu_cooling_ops);
+		if (IS_ERR(c->cdev)) {
+			pr_err("%s: failed to register %s\n", __func__,
+			       c->type);
+			ret = PTR_ERR(c->cdev);
+			c->cdev = NULL;
+			goto err;
+		}
+	}
+
+#ifdef CONFIG_HOTPLUG_CPU
+	register_hotcpu_notifier(&tmu_hotplug_nb);
+	register_pm_notifier(&tmu_hotplug_pm_nb);
+#endif
+
+	return 0;
+
+err:
+	while (--i >= 0) {
+		if (tmu_cooling[i].cdev)
+			thermal_cooling_device_unregister(tmu_cooling[i].cdev);
+		tmu_cooling[i].cdev = NULL;
+	}
+err_states:
+	for (i = 0; i < TMU_COOLING_END; i++)
+		tmu_cooling[i].nr_states = 0;
+
+	return ret;
+}
+
+void tmu_cooling_exit(void)
+{
+	int i;
+
+	mutex_lock(&cooling_lock);
+	for (i = 0; i < TMU_COOLING_END; i++) {
+		__tmu_cooling_set(&tmu_cooling[i], 0);
+
+		if (tmu_cooling[i].cdev)
+			thermal_cooling_device_unregister(tmu_cooling[i].cdev);
+		tmu_cooling[i].cdev = NULL;
+	}
+	mutex_unlock(&cooling_lock);
+
+#ifdef CONFIG_HOTPLUG_CPU
+	unregister_pm_notifier(&tmu_hotplug_pm_nb);
+	unregister_hotcpu_notifier(&tmu_hotplug_nb);
+#endif
+}
+
+#ifdef CONFIG_DEBUG_FS
+static unsigned int tmu_jiffies_to_ms(u64 j)
+{
+	return div_u64(j * MSEC_PER_SEC, HZ);
+}
+
+static void tmu_cooling_show_one(struct seq_file *s, struct tmu_cooling *c,
+				 u64 now)
+{
+	u64 total = 0, used = 0;
+	unsigned int state, lost = 0;
+
+	tmu_cooling_account(c, now);
+
+	for (state = 0; state < c->nr_states; state++) {
+		total += c->time[state];
+		used += c->time[state] * tmu_cooling_capacity(c, state);
+	}
+	if (total)
+		lost = 1000 - div64_u64(used, total);
+
+	seq_printf(s, "\n%s: state %u, %u transitions, %u.%u%% capacity lost\n",
+		   c->type, c->state, c->transitions, lost / 10, lost % 10);
+	seq_printf(s, "%6s %12s %12s\n", "state",
+		   c == &tmu_cooling[TMU_COOLING_HOTPLUG] ? "offline" : "limit(kHz)",
+		   "time(ms)");
+
+	for (state = 0; state < c->nr_states; state++)
+		seq_printf(s, "%6u %12lu %12u\n", state,
+			   c == &tmu_cooling[TMU_COOLING_HOTPLUG] ?
+			   state : c->freq[state],
+			   tmu_jiffies_to_ms(c->time[state]));
+}
+
+static int tmu_cooling_show(struct seq_file *s, void *unused)
+{
+	u64 now, limited;
+	int i;
+
+	mutex_lock(&cooling_lock);
+	now = get_jiffies_64();
+
+	limited = throttle_time;
+	if (throttle_start)
+		limited += now - throttle_start;
+
+	seq_printf(s, "throttled: %u ms in %u episodes, of %u ms\n",
+		   tmu_jiffies_to_ms(limited), throttle_count,
+		   tmu_jiffies_to_ms(now - stats_start));
+
+	for (i = 0; i < TMU_COOLING_END; i++)
+		if (tmu_cooling[i].nr_states)
+			tmu_cooling_show_one(s, &tmu_cooling[i], now);
+	mutex_unlock(&cooling_lock);
+
+	return 0;
+}
+
+static int tmu_cooling_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tmu_cooling_show, inode->i_private);
+}
+
+static ssize_t tmu_cooling_reset(struct file *file, const char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct tmu_cooling *c;
+	u64 now;
+	int i;
+
+	mutex_lock(&cooling_lock);
+	now = get_jiffies_64();
+
+	for (i = 0; i < TMU_COOLING_END; i++) {
+		c = &tmu_cooling[i];
+		memset(c->time, 0, sizeof(c->time));
+		c->transitions = 0;
+		c->last = now;
+	}
+
+	throttle_time = 0;
+	throttle_count = throttle_start ? 1 : 0;
+	if (throttle_start)
+		throttle_start = now;
+	stats_start = now;
+	mutex_unlock(&cooling_lock);
+
+	return count;
+}
+
+static const struct file_operations tmu_cooling_fops = {
+	.open		= tmu_cooling_open,
+	.read		= seq_read,
+	.write		= tmu_cooling_reset,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void tmu_cooling_debugfs_init(struct dentry *dir)
+{
+	debugfs_create_file("cooling", S_IRUGO | S_IWUSR, dir, NULL,
+			    &tmu_cooling_fops);
+}
+#endif
@@ -24,6 +24,12 @@
 #include <linux/io.h>
 #include <linux/irq.h>
 #include <linux/slab.h>
+#include <linux/cpufreq.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/thermal.h>
 
 #include <mach/regs-tmu.h>
 #include <mach/cpufreq.h>
@@ -43,6 +49,72 @@ unsigned int already_limit;
 unsigned int auto_refresh_changed;
 static struct workqueue_struct  *tmu_monitor_wq;
 
+/*
+ * Thermal governor. Once the throttle temperature is reached, a PID loop
+ * turns the distance to pid_target and the temperature slope into a power
+ * budget: a rising temperature cuts the budget before the target is
+ * reached, instead of stepping down to a fixed level at each threshold.
+ * bus_share percent of the budget goes to the bus and the rest to the
+ * CPUs, each getting the fastest level whose estimated power, cap * f *
+ * V^2, fits. When not all CPUs fit at the slowest level, CPUs are taken
+ * offline down to one. The limits go through the cooling devices of
+ * tmu-cooling.c. They are released below stop_throttle once the budget is
+ * back at its maximum. Tripping is handled as before.
+ */
+static bool pid = true;
+module_param(pid, bool, 0444);
+MODULE_PARM_DESC(pid, "power budget PID instead of throttle/warning steps");
+
+static unsigned int pid_target;
+module_param(pid_target, uint, 0644);
+MODULE_PARM_DESC(pid_target, "controlled temperature in C, 0 for stop_warning");
+
+static unsigned int pid_sustainable_mw = 2500;
+module_param(pid_sustainable_mw, uint, 0644);
+MODULE_PARM_DESC(pid_sustainable_mw, "budget at the target temperature");
+
+static unsigned int pid_kp = 300;
+module_param(pid_kp, uint, 0644);
+MODULE_PARM_DESC(pid_kp, "mW per C below the target");
+
+static unsigned int pid_ki = 30;
+module_param(pid_ki, uint, 0644);
+MODULE_PARM_DESC(pid_ki, "mW per C*s below the target");
+
+static unsigned int pid_kd = 500;
+module_param(pid_kd, uint, 0644);
+MODULE_PARM_DESC(pid_kd, "mW per C/s of temperature rise");
+
+static unsigned int cpu_cap_uw = 420;
+module_param(cpu_cap_uw, uint, 0644);
+MODULE_PARM_DESC(cpu_cap_uw, "CPU power per core in uW per MHz*V^2");
+
+static unsigned int bus_cap_uw = 800;
+module_param(bus_cap_uw, uint, 0644);
+MODULE_PARM_DESC(bus_cap_uw, "bus and memory power in uW per MHz*V^2");
+
+static unsigned int bus_share = 20;
+module_param(bus_share, uint, 0644);
+MODULE_PARM_DESC(bus_share, "percentage of the budget given to the bus");
+
+struct tmu_pid {
+	int temp;		/* last sample, mC */
+	int slope;		/* filtered, mC/s */
+	int integral;		/* mW */
+	int budget;		/* mW */
+	unsigned long last;	/* jiffies of the last sample */
+};
+
+/* Cooling states applied from a budget */
+struct tmu_pid_limit {
+	unsigned int state[TMU_COOLING_END];
+	int max_mw;		/* with nothing limited */
+	int min_mw;		/* at the slowest levels */
+};
+
+static struct tmu_pid tmu_pid;
+static struct tmu_pid_limit tmu_pid_limit;
+
 static void tmu_tripped_cb(void)
 {
 }
@@ -520,6 +592,498 @@ err_unlock:
 }
 #endif
 
+static int tmu_pid_target(struct tmu_data *data)
+{
+	return (pid_target ? pid_target : data->ts.stop_warning) * 1000;
+}
+
+static void tmu_pid_reset(struct tmu_pid *s, int temp, int budget)
+{
+	s->temp = temp;
+	s->slope = 0;
+	s->integral = 0;
+	s->budget = budget;
+	s->last = jiffies;
+}
+
+/*
+ * One step of the controller, temperatures in mC. It does not touch the
+ * hardware, so it can be run over a recorded trace through pid_sim.
+ */
+static int tmu_pid_update(struct tmu_pid *s, int target, int temp,
+			  unsigned int dt_ms, int min_mw, int max_mw)
+{
+	int err = target - temp;
+	int integral = s->integral;
+	int out;
+
+	if (dt_ms) {
+		s->slope += ((temp - s->temp) * 1000 / (int)dt_ms - s->slope) >> 2;
+		integral += div_s64((s64)pid_ki * err * dt_ms, 1000000);
+		integral = clamp(integral, -max_mw, max_mw);
+	}
+	s->temp = temp;
+
+	out = (int)pid_sustainable_mw + (int)pid_kp * err / 1000 -
+		(int)pid_kd * s->slope / 1000;
+
+	/* no integration further into saturation */
+	if ((out + integral > max_mw && integral > s->integral) ||
+	    (out + integral < min_mw && integral < s->integral))
+		integral = s->integral;
+	s->integral = integral;
+
+	s->budget = clamp(out + integral, min_mw, max_mw);
+	return s->budget;
+}
+
+/* mW at cap uW per MHz*V^2, freq in kHz and volt in uV */
+static int tmu_power(unsigned int cap, unsigned long freq, unsigned int volt)
+{
+	unsigned int mv = volt / 1000;
+
+	return div_u64((u64)cap * (freq / 1000) * mv * mv, 1000000000);
+}
+
+/* mW of a cpufreq or busfreq cooling state */
+static int tmu_state_power(enum tmu_cooling_id id, unsigned int cap,
+			   unsigned int state)
+{
+	unsigned long freq;
+	unsigned int volt;
+
+	if (tmu_cooling_get_state_info(id, state, &freq, &volt))
+		return 0;
+
+	return tmu_power(cap, freq, volt);
+}
+
+/*
+ * Fastest bus level within bus_share of @budget, then the fastest CPU
+ * level within what is left, then as many CPUs as fit at that level, at
+ * least one. Also sets the budget bounds.
+ */
+static void tmu_pid_distribute(int budget, struct tmu_pid_limit *lim)
+{
+	unsigned int nr, state, cpus, n;
+	int core, left = budget;
+
+	memset(lim, 0, sizeof(*lim));
+
+	nr = tmu_cooling_nr_states(TMU_COOLING_BUSFREQ);
+	if (nr) {
+		for (state = 0; state + 1 < nr; state++)
+			if (tmu_state_power(TMU_COOLING_BUSFREQ, bus_cap_uw,
+					    state) <= budget * (int)bus_share / 100)
+				break;
+
+		lim->state[TMU_COOLING_BUSFREQ] = state;
+		left -= tmu_state_power(TMU_COOLING_BUSFREQ, bus_cap_uw, state);
+		lim->max_mw = tmu_state_power(TMU_COOLING_BUSFREQ,
+					      bus_cap_uw, 0);
+		lim->min_mw = tmu_state_power(TMU_COOLING_BUSFREQ,
+					      bus_cap_uw, nr - 1);
+	}
+
+	nr = tmu_cooling_nr_states(TMU_COOLING_CPUFREQ);
+	if (!nr)
+		return;
+
+	/* CPUs held offline by the governor count as available */
+	cpus = min(num_online_cpus() + tmu_cooling_get(TMU_COOLING_HOTPLUG),
+		   num_possible_cpus());
+
+	for (state = 0; state + 1 < nr; state++)
+		if (tmu_state_power(TMU_COOLING_CPUFREQ, cpu_cap_uw, state) *
+		    (int)cpus <= left)
+			break;
+	lim->state[TMU_COOLING_CPUFREQ] = state;
+	core = tmu_state_power(TMU_COOLING_CPUFREQ, cpu_cap_uw, state);
+
+	n = cpus;
+	if (tmu_cooling_nr_states(TMU_COOLING_HOTPLUG)) {
+		while (n > 1 && core * (int)n > left)
+			n--;
+		if (n < cpus)
+			lim->state[TMU_COOLING_HOTPLUG] =
+				num_possible_cpus() - n;
+	}
+
+	lim->max_mw += tmu_state_power(TMU_COOLING_CPUFREQ, cpu_cap_uw, 0) *
+		       (int)cpus;
+	lim->min_mw += tmu_state_power(TMU_COOLING_CPUFREQ, cpu_cap_uw,
+				       nr - 1) * (int)n;
+}
+
+/* Called with tmu_lock held */
+static void tmu_pid_apply(struct tmu_pid_limit *lim)
+{
+	int i;
+
+	for (i = 0; i < TMU_COOLING_END; i++)
+		if (tmu_cooling_nr_states(i))
+			tmu_cooling_set(i, lim->state[i]);
+
+	tmu_pid_limit = *lim;
+}
+
+static void tmu_pid_release(void)
+{
+	struct tmu_pid_limit lim;
+
+	memset(&lim, 0, sizeof(lim));
+	tmu_pid_apply(&lim);
+}
+
+/* Throttled and warning states with the governor, tmu_lock held */
+static void tmu_pid_monitor(struct tmu_info *info, int cur_temp)
+{
+	struct tmu_data *data = info->dev->platform_data;
+	struct tmu_pid_limit lim;
+	unsigned int dt_ms = 0;
+	int budget;
+
+	if (cur_temp >= data->ts.start_tripping) {
+		info->tmu_state = TMU_STATUS_TRIPPED;
+		return;
+	}
+
+	tmu_pid_distribute(0, &lim);
+
+	if (!already_limit) {
+		tmu_pid_reset(&tmu_pid, cur_temp * 1000, lim.max_mw);
+		already_limit = 1;
+	} else {
+		dt_ms = jiffies_to_msecs(jiffies - tmu_pid.last);
+		tmu_pid.last = jiffies;
+	}
+
+	budget = tmu_pid_update(&tmu_pid, tmu_pid_target(data),
+				cur_temp * 1000, dt_ms,
+				lim.min_mw, lim.max_mw);
+
+	if (cur_temp <= data->ts.stop_throttle && budget >= lim.max_mw) {
+		tmu_pid_release();
+		info->tmu_state = TMU_STATUS_NORMAL;
+		already_limit = 0;
+		pr_info("Freq limit is released!!\n");
+		return;
+	}
+
+	tmu_pid_distribute(budget, &lim);
+	tmu_pid_apply(&lim);
+
+	info->tmu_state = cur_temp >= data->ts.start_warning ?
+			  TMU_STATUS_WARNING : TMU_STATUS_THROTTLED;
+}
+
+/*
+ * Thermal zone exynos-tmu. It is not polled and has no passive
+ * coefficients: the governor above moves the cooling devices, and the
+ * zone makes the temperature, the trips and the bound cooling devices
+ * visible under /sys/class/thermal.
+ */
+enum {
+	TMU_TRIP_THROTTLE,
+	TMU_TRIP_WARNING,
+	TMU_TRIP_TRIPPING,
+	TMU_TRIP_END,
+};
+
+static int tmu_zone_get_temp(struct thermal_zone_device *tz,
+			     unsigned long *temp)
+{
+	struct tmu_info *info = tz->devdata;
+
+	*temp = max(get_cur_temp(info), 0) * 1000;
+	return 0;
+}
+
+static int tmu_zone_get_trip_type(struct thermal_zone_device *tz, int trip,
+				  enum thermal_trip_type *type)
+{
+	switch (trip) {
+	case TMU_TRIP_THROTTLE:
+		*type = THERMAL_TRIP_PASSIVE;
+		break;
+	case TMU_TRIP_WARNING:
+		*type = THERMAL_TRIP_HOT;
+		break;
+	case TMU_TRIP_TRIPPING:
+		*type = THERMAL_TRIP_CRITICAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int tmu_zone_get_trip_temp(struct thermal_zone_device *tz, int trip,
+				  unsigned long *temp)
+{
+	struct tmu_info *info = tz->devdata;
+	struct tmu_data *data = info->dev->platform_data;
+
+	switch (trip) {
+	case TMU_TRIP_THROTTLE:
+		*temp = data->ts.start_throttle * 1000;
+		break;
+	case TMU_TRIP_WARNING:
+		*temp = data->ts.start_warning * 1000;
+		break;
+	case TMU_TRIP_TRIPPING:
+		*temp = data->ts.start_tripping * 1000;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int tmu_zone_get_crit_temp(struct thermal_zone_device *tz,
+				  unsigned long *temp)
+{
+	return tmu_zone_get_trip_temp(tz, TMU_TRIP_TRIPPING, temp);
+}
+
+static int tmu_zone_bind(struct thermal_zone_device *tz,
+			 struct thermal_cooling_device *cdev)
+{
+	return tmu_cooling_bind(tz, TMU_TRIP_THROTTLE, cdev, true);
+}
+
+static int tmu_zone_unbind(struct thermal_zone_device *tz,
+			   struct thermal_cooling_device *cdev)
+{
+	return tmu_cooling_bind(tz, TMU_TRIP_THROTTLE, cdev, false);
+}
+
+/* Tripping is left to the TMU interrupt rather than a poweroff from here */
+static int tmu_zone_notify(struct thermal_zone_device *tz, int trip,
+			   enum thermal_trip_type type)
+{
+	return type == THERMAL_TRIP_CRITICAL;
+}
+
+static const struct thermal_zone_device_ops tmu_zone_ops = {
+	.bind		= tmu_zone_bind,
+	.unbind		= tmu_zone_unbind,
+	.get_temp	= tmu_zone_get_temp,
+	.get_trip_type	= tmu_zone_get_trip_type,
+	.get_trip_temp	= tmu_zone_get_trip_temp,
+	.get_crit_temp	= tmu_zone_get_crit_temp,
+	.notify		= tmu_zone_notify,
+};
+
+static void tmu_zone_register(struct tmu_info *info)
+{
+	info->tz = thermal_zone_device_register("exynos-tmu", TMU_TRIP_END,
+						info, &tmu_zone_ops, 0, 0, 0, 0);
+	if (IS_ERR(info->tz)) {
+		dev_err(info->dev, "failed to register thermal zone\n");
+		info->tz = NULL;
+	}
+}
+
+static void tmu_zone_unregister(struct tmu_info *info)
+{
+	if (info->tz)
+		thermal_zone_device_unregister(info->tz);
+	info->tz = NULL;
+}
+
+#ifdef CONFIG_DEBUG_FS
+#define TMU_PID_SIM_MAX		256
+
+struct tmu_pid_sim {
+	int temp;		/* C */
+	int slope;		/* mC/s */
+	int budget;		/* mW */
+	unsigned int state[TMU_COOLING_END];
+};
+
+static struct dentry *tmu_debugfs;
+static struct tmu_pid_sim tmu_pid_sim[TMU_PID_SIM_MAX];
+static unsigned int tmu_pid_sim_len;
+
+/* Frequency of a cooling state, 0 when the device is not there */
+static unsigned long tmu_pid_state_freq(enum tmu_cooling_id id,
+					unsigned int state)
+{
+	unsigned long freq;
+	unsigned int volt;
+
+	return tmu_cooling_get_state_info(id, state, &freq, &volt) ? 0 : freq;
+}
+
+static int tmu_pid_show(struct seq_file *s, void *unused)
+{
+	struct tmu_info *info = s->private;
+
+	mutex_lock(&tmu_lock);
+	seq_printf(s, "target:   %d mC\n",
+		   tmu_pid_target(info->dev->platform_data));
+	if (already_limit && pid) {
+		seq_printf(s, "temp:     %d mC\n", tmu_pid.temp);
+		seq_printf(s, "slope:    %d mC/s\n", tmu_pid.slope);
+		seq_printf(s, "integral: %d mW\n", tmu_pid.integral);
+		seq_printf(s, "budget:   %d mW (%d..%d)\n", tmu_pid.budget,
+			   tmu_pid_limit.min_mw, tmu_pid_limit.max_mw);
+		seq_printf(s, "cpu:      %lu kHz\n",
+			   tmu_pid_state_freq(TMU_COOLING_CPUFREQ,
+				tmu_pid_limit.state[TMU_COOLING_CPUFREQ]));
+		seq_printf(s, "bus:      %lu kHz\n",
+			   tmu_pid_state_freq(TMU_COOLING_BUSFREQ,
+				tmu_pid_limit.state[TMU_COOLING_BUSFREQ]));
+		seq_printf(s, "offline:  %u\n",
+			   tmu_pid_limit.state[TMU_COOLING_HOTPLUG]);
+	} else {
+		seq_printf(s, "not limiting\n");
+	}
+	mutex_unlock(&tmu_lock);
+
+	return 0;
+}
+
+static int tmu_pid_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tmu_pid_show, inode->i_private);
+}
+
+static const struct file_operations tmu_pid_fops = {
+	.open		= tmu_pid_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int tmu_pid_sim_show(struct seq_file *s, void *unused)
+{
+	struct tmu_pid_sim *p;
+	unsigned int i;
+
+	mutex_lock(&tmu_lock);
+	seq_printf(s, "%4s %6s %8s %8s %8s %8s %8s\n", "step", "temp",
+		   "slope", "budget", "cpu", "bus", "offline");
+	for (i = 0; i < tmu_pid_sim_len; i++) {
+		p = &tmu_pid_sim[i];
+		seq_printf(s, "%4u %6d %8d %8d %8lu %8lu %8u\n", i, p->temp,
+			   p->slope, p->budget,
+			   tmu_pid_state_freq(TMU_COOLING_CPUFREQ,
+				p->state[TMU_COOLING_CPUFREQ]),
+			   tmu_pid_state_freq(TMU_COOLING_BUSFREQ,
+				p->state[TMU_COOLING_BUSFREQ]),
+			   p->state[TMU_COOLING_HOTPLUG]);
+	}
+	mutex_unlock(&tmu_lock);
+
+	return 0;
+}
+
+static int tmu_pid_sim_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tmu_pid_sim_show, inode->i_private);
+}
+
+/*
+ * Runs the controller on a scratch state over the temperatures written,
+ * in C, one per sampling period, and keeps the budget and the levels it
+ * would have picked at each step. The live state is not touched.
+ */
+static ssize_t tmu_pid_sim_write(struct file *file, const char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct tmu_info *info = ((struct seq_file *)file->private_data)->private;
+	unsigned int dt_ms = jiffies_to_msecs(info->sampling_rate);
+	struct tmu_pid_limit lim, step;
+	struct tmu_pid s;
+	char *buf, *p, *end;
+	long temp;
+	unsigned int n = 0;
+	ssize_t ret = count;
+
+	if (count >= PAGE_SIZE)
+		return -EINVAL;
+
+	buf = kmalloc(count + 1, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	if (copy_from_user(buf, ubuf, count)) {
+		kfree(buf);
+		return -EFAULT;
+	}
+	buf[count] = '\0';
+
+	mutex_lock(&tmu_lock);
+	tmu_pid_distribute(0, &lim);
+
+	for (p = skip_spaces(buf); *p && n < TMU_PID_SIM_MAX;
+	     p = skip_spaces(end)) {
+		temp = simple_strtol(p, &end, 10);
+		if (end == p) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (!n)
+			tmu_pid_reset(&s, temp * 1000, lim.max_mw);
+
+		tmu_pid_update(&s, tmu_pid_target(info->dev->platform_data),
+			       temp * 1000, n ? dt_ms : 0,
+			       lim.min_mw, lim.max_mw);
+		tmu_pid_distribute(s.budget, &step);
+
+		tmu_pid_sim[n].temp = temp;
+		tmu_pid_sim[n].slope = s.slope;
+		tmu_pid_sim[n].budget = s.budget;
+		memcpy(tmu_pid_sim[n].state, step.state, sizeof(step.state));
+		n++;
+	}
+	tmu_pid_sim_len = n;
+	mutex_unlock(&tmu_lock);
+
+	kfree(buf);
+	return ret;
+}
+
+static const struct file_operations tmu_pid_sim_fops = {
+	.open		= tmu_pid_sim_open,
+	.read		= seq_read,
+	.write		= tmu_pid_sim_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void tmu_debugfs_init(struct tmu_info *info)
+{
+	tmu_debugfs = debugfs_create_dir("exynos_tmu", NULL);
+	if (IS_ERR_OR_NULL(tmu_debugfs))
+		return;
+
+	debugfs_create_file("pid", S_IRUGO, tmu_debugfs, info,
+			    &tmu_pid_fops);
+	debugfs_create_file("pid_sim", S_IRUGO | S_IWUSR, tmu_debugfs, info,
+			    &tmu_pid_sim_fops);
+	tmu_cooling_debugfs_init(tmu_debugfs);
+}
+
+static void tmu_debugfs_exit(void)
+{
+	debugfs_remove_recursive(tmu_debugfs);
+}
+#else
+static inline void tmu_debugfs_init(struct tmu_info *info)
+{
+}
+
+static inline void tmu_debugfs_exit(void)
+{
+}
+#endif
+
 static void tmu_monitor(struct work_struct *work)
 {
 	struct delayed_work *delayed_work = to_delayed_work(work);
@@ -563,37 +1127,45 @@ static void tmu_monitor(struct work_struct *work)
 		return;
 
 	case TMU_STATUS_THROTTLED:
+		if (pid) {
+			tmu_pid_monitor(info, cur_temp);
+			break;
+		}
 		if (cur_temp >= data->ts.start_warning) {
 			info->tmu_state = TMU_STATUS_WARNING;
-			exynos_cpufreq_upper_limit_free(DVFS_LOCK_ID_TMU);
+			tmu_cooling_set(TMU_COOLING_CPUFREQ, 0);
 			already_limit = 0;
 		} else if (cur_temp > data->ts.stop_throttle &&
 				cur_temp < data->ts.start_warning &&
 							!already_limit) {
-			exynos_cpufreq_upper_limit(DVFS_LOCK_ID_TMU,
-				info->throttle_freq);
+			tmu_cooling_set(TMU_COOLING_CPUFREQ,
+				tmu_cooling_cpufreq_state(info->throttle_freq));
 			already_limit = 1;
 		} else if (cur_temp <= data->ts.stop_throttle) {
 			info->tmu_state = TMU_STATUS_NORMAL;
-			exynos_cpufreq_upper_limit_free(DVFS_LOCK_ID_TMU);
+			tmu_cooling_set(TMU_COOLING_CPUFREQ, 0);
 			pr_info("Freq limit is released!!\n");
 			already_limit = 0;
 		}
 		break;
 
 	case TMU_STATUS_WARNING:
+		if (pid) {
+			tmu_pid_monitor(info, cur_temp);
+			break;
+		}
 		if (cur_temp >= data->ts.start_tripping) {
 			info->tmu_state = TMU_STATUS_TRIPPED;
 			already_limit = 0;
 		} else if (cur_temp > data->ts.stop_warning && \
 				cur_temp < data->ts.start_tripping &&
 							!already_limit) {
-			exynos_cpufreq_upper_limit(DVFS_LOCK_ID_TMU,
-							info->warning_freq);
+			tmu_cooling_set(TMU_COOLING_CPUFREQ,
+				tmu_cooling_cpufreq_state(info->warning_freq));
 			already_limit = 1;
 		} else if (cur_temp <= data->ts.stop_warning) {
 			info->tmu_state = TMU_STATUS_THROTTLED;
-			exynos_cpufreq_upper_limit_free(DVFS_LOCK_ID_TMU);
+			tmu_cooling_set(TMU_COOLING_CPUFREQ, 0);
 			already_limit = 0;
 		}
 		break;
@@ -800,8 +1372,7 @@ static int exynos_tmu_init(struct tmu_info *info)
 	}
 #ifdef CONFIG_BUSFREQ_OPP
 	/* To lock bus frequency in OPP mode */
-	info->bus_dev = dev_get("exynos-busfreq");
-	if (info->bus_dev < 0) {
+	if (IS_ERR(info->bus_dev)) {
 		pr_err("Failed to get_dev\n");
 		return -EINVAL;
 	}
@@ -1028,6 +1599,18 @@ static int __devinit tmu_probe(struct platform_device *pdev)
 	INIT_DELAYED_WORK_DEFERRABLE(&info->monitor, cur_temp_monitor);
 #endif
 
+#ifdef CONFIG_BUSFREQ_OPP
+	/* To lock or limit bus frequency in OPP mode */
+	info->bus_dev = dev_get("exynos-busfreq");
+#endif
+	/* before the first interrupt can limit anything */
+	ret = tmu_cooling_init(info);
+	if (ret) {
+		/* tripping and the TC/refresh handling work without them */
+		dev_err(&pdev->dev, "no cooling devices, not throttling: %d\n",
+			ret);
+	}
+
 	print_temperature_params(info);
 	ret = tmu_initialize(pdev);
 	if (ret < 0)
@@ -1037,10 +1620,13 @@ static int __devinit tmu_probe(struct platform_device *pdev)
 	queue_delayed_work_on(0, tmu_monitor_wq,
 			&info->monitor, info->sampling_rate);
 #endif
+	tmu_zone_register(info);
+	tmu_debugfs_init(info);
 	pr_info("Tmu Initialization is sucessful...!\n");
 	return ret;
 
 err_noinit:
+	tmu_cooling_exit();
 	destroy_workqueue(tmu_monitor_wq);
 err_wq:
 	thermal_remove_sysfs_file(&pdev->dev);
@@ -1062,7 +1648,10 @@ static int __devinit tmu_remove(struct platform_device *pdev)
 {
 	struct tmu_info *info = platform_get_drvdata(pdev);
 
-	cancel_delayed_work(&info->polling);
+	tmu_debugfs_exit();
+	cancel_delayed_work_sync(&info->polling);
+	tmu_zone_unregister(info);
+	tmu_cooling_exit();
 	destroy_workqueue(tmu_monitor_wq);
 
 	thermal_remove_sysfs_file(&pdev->dev);
@@ -0,0 +1,330 @@
+/* linux/arch/arm/mach-exynos/unified-hotplug.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * EXYNOS - load and nr_running based dynamic CPU hotplug
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+/*
+ * Every sample_ms the policy looks at nr_running averaged over a few
+ * samples and at the load of every online CPU:
+ *
+ * - a CPU is plugged in when avg nr_running reaches nr_up[online - 1] and
+ *   the online CPUs average more than up_load percent, for up_latency_ms.
+ *   When burst_nr more tasks than online CPUs are runnable and the load
+ *   is over up_load, it is plugged in at once.
+ * - the least loaded CPU is plugged out when avg nr_running drops nr_hyst
+ *   below the threshold which brought it in, or the load falls under
+ *   down_load, for down_delay_ms.
+ *
+ * With park set, CPUs are parked instead of taken offline, and a parked
+ * CPU is the first one brought back. Parked CPUs count as plugged out.
+ *
+ * CPUs held back by the TMU are neither brought back nor counted as
+ * available for min_cpus and max_cpus.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/cpu.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/notifier.h>
+#include <linux/suspend.h>
+#include <linux/reboot.h>
+
+#include <mach/cpu-park.h>
+#include <mach/tmu.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpu_hotplug.h>
+
+#define NR_UP_LEVELS	3
+
+static unsigned int sample_ms = 50;
+module_param(sample_ms, uint, 0644);
+MODULE_PARM_DESC(sample_ms, "sampling period");
+
+static unsigned int up_latency_ms = 100;
+module_param(up_latency_ms, uint, 0644);
+MODULE_PARM_DESC(up_latency_ms, "max time from sustained load to plug in");
+
+static unsigned int down_delay_ms = 1000;
+module_param(down_delay_ms, uint, 0644);
+MODULE_PARM_DESC(down_delay_ms, "time a CPU must be unneeded to plug out");
+
+static unsigned int up_load = 70;
+module_param(up_load, uint, 0644);
+MODULE_PARM_DESC(up_load, "average load percentage to plug in");
+
+static unsigned int down_load = 30;
+module_param(down_load, uint, 0644);
+MODULE_PARM_DESC(down_load, "average load percentage to plug out");
+
+static unsigned int nr_up[NR_UP_LEVELS] = { 150, 250, 350 };
+module_param_array(nr_up, uint, NULL, 0644);
+MODULE_PARM_DESC(nr_up, "avg nr_running x100 to plug in a 2nd, 3rd, 4th CPU");
+
+static unsigned int nr_hyst = 50;
+module_param(nr_hyst, uint, 0644);
+MODULE_PARM_DESC(nr_hyst, "avg nr_running x100 hysteresis to plug out");
+
+static unsigned int nr_avg_shift = 2;
+module_param(nr_avg_shift, uint, 0644);
+MODULE_PARM_DESC(nr_avg_shift, "nr_running average weight of a sample, 1/2^n");
+
+static unsigned int burst_nr = 2;
+module_param(burst_nr, uint, 0644);
+MODULE_PARM_DESC(burst_nr, "runnable tasks above online CPUs to plug in at once");
+
+static unsigned int min_cpus = 1;
+module_param(min_cpus, uint, 0644);
+MODULE_PARM_DESC(min_cpus, "CPUs kept online regardless of the load");
+
+static unsigned int max_cpus = NR_CPUS;
+module_param(max_cpus, uint, 0644);
+MODULE_PARM_DESC(max_cpus, "CPUs plugged in at most");
+
+static bool park;
+module_param(park, bool, 0644);
+MODULE_PARM_DESC(park, "park CPUs instead of taking them offline");
+
+static unsigned int user_lock;
+module_param_named(lock, user_lock, uint, 0644);
+MODULE_PARM_DESC(lock, "non-zero stops plugging CPUs in and out");
+
+struct hotplug_cpu_info {
+	u64 prev_idle;
+	u64 prev_wall;
+	unsigned int load;
+};
+
+static DEFINE_PER_CPU(struct hotplug_cpu_info, hotplug_cpu_info);
+
+static struct workqueue_struct *hotplug_wq;
+static struct delayed_work hotplug_work;
+
+/* mutex can be used since the policy runs from a workqueue */
+static DEFINE_MUTEX(hotplug_lock);
+
+static int avg_nr;			/* nr_running x100, never negative */
+static unsigned int up_ms;		/* time the plug in condition held */
+static unsigned int down_ms;		/* time the plug out condition held */
+
+static void hotplug_reset_load(unsigned int cpu)
+{
+	struct hotplug_cpu_info *info = &per_cpu(hotplug_cpu_info, cpu);
+
+	info->prev_idle = get_cpu_idle_time_us(cpu, &info->prev_wall);
+	info->load = 0;
+}
+
+static unsigned int hotplug_cpu_load(unsigned int cpu)
+{
+	struct hotplug_cpu_info *info = &per_cpu(hotplug_cpu_info, cpu);
+	u64 idle, wall;
+	unsigned int idle_time, wall_time;
+
+	idle = get_cpu_idle_time_us(cpu, &wall);
+	idle_time = (unsigned int)(idle - info->prev_idle);
+	wall_time = (unsigned int)(wall - info->prev_wall);
+	info->prev_idle = idle;
+	info->prev_wall = wall;
+
+	if (wall_time && wall_time >= idle_time)
+		info->load = 100 * (wall_time - idle_time) / wall_time;
+
+	return info->load;
+}
+
+static unsigned int hotplug_nr_up(unsigned int online)
+{
+	return nr_up[min_t(unsigned int, online, NR_UP_LEVELS) - 1];
+}
+
+static void hotplug_cpu_up(const char *reason)
+{
+	unsigned int cpu;
+
+	for_each_online_cpu(cpu) {
+		if (!sched_cpu_parked(cpu) ||
+		    cpumask_test_cpu(cpu, tmu_cooling_held_cpus()))
+			continue;
+
+		trace_cpu_hotplug_decision(cpu, true, true, reason);
+		if (!exynos_cpu_park(cpu, false)) {
+			hotplug_reset_load(cpu);
+			return;
+		}
+	}
+
+	for_each_present_cpu(cpu) {
+		if (cpu_online(cpu) ||
+		    cpumask_test_cpu(cpu, tmu_cooling_held_cpus()))
+			continue;
+
+		trace_cpu_hotplug_decision(cpu, true, false, reason);
+		if (!cpu_up(cpu))
+			hotplug_reset_load(cpu);
+		break;
+	}
+}
+
+static void hotplug_cpu_down(unsigned int cpu, const char *reason)
+{
+	trace_cpu_hotplug_decision(cpu, false, park, reason);
+	if (park)
+		exynos_cpu_park(cpu, true);
+	else
+		cpu_down(cpu);
+}
+
+static void hotplug_timer(struct work_struct *work)
+{
+	unsigned int cpu, load, online, avail, nr, total = 0;
+	unsigned int avg_load, min_load = 100, min_cpu = 0;
+	bool can_up, can_down;
+
+	mutex_lock(&hotplug_lock);
+
+	if (user_lock)
+		goto no_hotplug;
+
+	online = num_active_cpus();
+	nr = nr_running();
+	avg_nr += ((int)(nr * 100) - avg_nr) >> nr_avg_shift;
+
+	for_each_cpu(cpu, cpu_active_mask) {
+		load = hotplug_cpu_load(cpu);
+		total += load;
+
+		if (cpu && load < min_load) {
+			min_load = load;
+			min_cpu = cpu;
+		}
+	}
+	avg_load = total / online;
+
+	trace_cpu_hotplug_sample(online, nr, avg_nr, avg_load, min_load);
+
+	/* CPUs which can be brought in at all */
+	avail = num_present_cpus();
+	for_each_cpu(cpu, tmu_cooling_held_cpus())
+		if (cpu_present(cpu) && !cpu_active(cpu))
+			avail--;
+
+	can_up = online < min(max_cpus, avail);
+	can_down = online > max(min_cpus, 1U) && min_cpu;
+
+	/* limits changed from userspace are applied first */
+	if (online > max(max_cpus, 1U) && min_cpu) {
+		hotplug_cpu_down(min_cpu, "limit");
+		up_ms = down_ms = 0;
+	} else if (online < min(min_cpus, avail)) {
+		hotplug_cpu_up("limit");
+		up_ms = down_ms = 0;
+	} else if (can_up && nr >= online + burst_nr && avg_load >= up_load) {
+		hotplug_cpu_up("burst");
+		up_ms = down_ms = 0;
+	} else if (can_up && avg_nr >= hotplug_nr_up(online) &&
+		   avg_load >= up_load) {
+		down_ms = 0;
+		up_ms += sample_ms;
+		if (up_ms >= up_latency_ms) {
+			hotplug_cpu_up("load");
+			up_ms = 0;
+		}
+	} else if (can_down && (avg_load < down_load ||
+		   avg_nr + nr_hyst < hotplug_nr_up(online - 1))) {
+		up_ms = 0;
+		down_ms += sample_ms;
+		if (down_ms >= down_delay_ms) {
+			hotplug_cpu_down(min_cpu, avg_load < down_load ?
+					 "idle" : "nr_running");
+			down_ms = 0;
+		}
+	} else {
+		up_ms = down_ms = 0;
+	}
+
+ no_hotplug:
+	queue_delayed_work_on(0, hotplug_wq, &hotplug_work,
+			      msecs_to_jiffies(sample_ms));
+
+	mutex_unlock(&hotplug_lock);
+}
+
+static int hotplug_pm_notifier_event(struct notifier_block *this,
+				     unsigned long event, void *ptr)
+{
+	static unsigned user_lock_saved;
+
+	switch (event) {
+	case PM_SUSPEND_PREPARE:
+		mutex_lock(&hotplug_lock);
+		user_lock_saved = user_lock;
+		user_lock = 1;
+		mutex_unlock(&hotplug_lock);
+		return NOTIFY_OK;
+	case PM_POST_RESTORE:
+	case PM_POST_SUSPEND:
+		mutex_lock(&hotplug_lock);
+		user_lock = user_lock_saved;
+		up_ms = down_ms = 0;
+		mutex_unlock(&hotplug_lock);
+		return NOTIFY_OK;
+	}
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block hotplug_pm_notifier = {
+	.notifier_call = hotplug_pm_notifier_event,
+};
+
+static int hotplug_reboot_notifier_call(struct notifier_block *this,
+					unsigned long code, void *_cmd)
+{
+	mutex_lock(&hotplug_lock);
+	pr_err("%s: disabling pm hotplug\n", __func__);
+	user_lock = 1;
+	mutex_unlock(&hotplug_lock);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block hotplug_reboot_notifier = {
+	.notifier_call = hotplug_reboot_notifier_call,
+};
+
+static int __init exynos_unified_hotplug_init(void)
+{
+	unsigned int cpu;
+
+	hotplug_wq = create_singlethread_workqueue("dynamic hotplug");
+	if (!hotplug_wq) {
+		printk(KERN_ERR "Creation of hotplug work failed\n");
+		return -ENOMEM;
+	}
+
+	for_each_present_cpu(cpu)
+		hotplug_reset_load(cpu);
+
+	INIT_DELAYED_WORK_DEFERRABLE(&hotplug_work, hotplug_timer);
+
+	/* leave all CPUs up while booting */
+	queue_delayed_work_on(0, hotplug_wq, &hotplug_work, 60 * HZ);
+
+	register_pm_notifier(&hotplug_pm_notifier);
+	register_reboot_notifier(&hotplug_reboot_notifier);
+
+	return 0;
+}
+late_initcall(exynos_unified_hotplug_init);
@@ -12,6 +12,7 @@
 #ifndef __ASM_PLAT_FIMC_H
 #define __ASM_PLAT_FIMC_H __FILE__
 
+#include <linux/errno.h>
 #include <linux/videodev2.h>
 
 #define FIMC_SRC_MAX_W		4224
@@ -142,4 +143,31 @@ extern void s3c_fimc3_cfg_gpio(struct platform_device *pdev);
 extern int s3c_fimc_clk_on(struct platform_device *pdev, struct clk **clk);
 extern int s3c_fimc_clk_off(struct platform_device *pdev, struct clk **clk);
 
+/* one-shot scaling by fimc-m2m for other drivers, on physical buffers */
+struct fimc_scale_req {
+	dma_addr_t	src;
+	dma_addr_t	dst;
+	u32		fourcc;		/* same for src and dst */
+	u32		src_width;
+	u32		src_height;
+	u32		dst_width;
+	u32		dst_height;
+	void		*priv;		/* owned by fimc-m2m */
+};
+
+#ifdef CONFIG_VIDEO_FIMC_M2M
+extern int fimc_m2m_scale_start(struct fimc_scale_req *req);
+extern int fimc_m2m_scale_wait(struct fimc_scale_req *req);
+#else
+static inline int fimc_m2m_scale_start(struct fimc_scale_req *req)
+{
+	return -ENODEV;
+}
+
+static inline int fimc_m2m_scale_wait(struct fimc_scale_req *req)
+{
+	return -ENODEV;
+}
+#endif
+
 #endif /*__ASM_PLAT_FIMC_H */
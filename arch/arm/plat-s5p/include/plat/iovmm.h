@@ -34,22 +34,46 @@ void iovmm_deactivate(struct device *dev);
 dma_addr_t iovmm_map(struct device *dev, struct scatterlist *sg, off_t offset,
 								size_t size);
 
-/* iovmm_map() - unmaps the given IO address
+/* iovmm_unmap() - unmaps the given IO address
  * @dev: the owner of the IO address space where @iova belongs
  * @iova: IO address that needs to be unmapped and freed.
  *
+ * The mapping is removed from the IOMMU, and its TLB entries invalidated,
+ * before this function returns; the pages can be freed afterwards. @iova
+ * may also be an address given back with iovmm_unmap_cached(), as long as
+ * no iovmm_map() has returned it again.
+ *
  * The caller of this function must ensure that iovmm_cleanup() is not called
  * while this function is called.
  */
 void iovmm_unmap(struct device *dev, dma_addr_t iova);
 
+/* iovmm_unmap_cached() - gives back the given IO address, keeping the mapping
+ * @dev: the owner of the IO address space where @iova belongs
+ * @iova: IO address that is not used any more.
+ *
+ * The mapping is kept for a while afterwards, and a later iovmm_map() of
+ * the same pages then returns @iova again. The hits and misses are shown in
+ * <debugfs>/iovmm/<device name>.
+ *
+ * Until it is evicted, the kept mapping still lets @dev access the pages.
+ * Use it only for pages which stay allocated, e.g. buffers of a pool which
+ * are mapped again and again, and call iovmm_unmap() on @iova before the
+ * pages are freed.
+ *
+ * The caller of this function must ensure that iovmm_cleanup() is not called
+ * while this function is called.
+ */
+void iovmm_unmap_cached(struct device *dev, dma_addr_t iova);
+
 #else
 #define iovmm_setup(dev)	(-ENOSYS)
 #define iovmm_cleanup(dev)
 #define iovmm_activate(dev)	(-ENOSYS)
 #define iovmm_deactivate(dev)
-#define iovmm_map(dev, sg)	(0)
+#define iovmm_map(dev, sg, offset, size)	(0)
 #define iovmm_unmap(dev, iova)
+#define iovmm_unmap_cached(dev, iova)
 #endif /* CONFIG_ION */
 
 #endif /*__ASM_PLAT_IOVMM_H*/
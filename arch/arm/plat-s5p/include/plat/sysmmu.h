@@ -80,6 +80,19 @@ void s5p_sysmmu_set_tablebase_pgd(struct device *owner, unsigned long pgd);
  */
 void s5p_sysmmu_tlb_invalidate(struct device *owner);
 
+/**
+ * s5p_sysmmu_tlb_invalidate_range() - flush the TLB entries of an area
+ * @owner: The device whose System MMU.
+ * @iova: The start device (virtual) address of the area.
+ * @size: The size of the area in bytes.
+ *
+ * This function flushes only the TLB entries translating the area, so that
+ * a driver changing a few mappings keeps the rest of the TLB. Large areas
+ * are flushed with the whole TLB.
+ */
+void s5p_sysmmu_tlb_invalidate_range(struct device *owner,
+				     unsigned long iova, size_t size);
+
 /** s5p_sysmmu_set_fault_handler() - Fault handler for System MMUs
  * Called when interrupt occurred by the System MMUs
  * The device drivers of peripheral devices that has a System MMU can implement
@@ -105,6 +118,9 @@ void s5p_sysmmu_set_fault_handler(struct device *sysmmu,
  *  @size1: The last virtual address of the area of the @owner device that the
  *          prefetch buffer loads translation descriptors. This can be 0. See
  *          the description of @base1 for more information with @size1 = 0
+ *
+ *  System MMUs other than v3 have no prefetch buffers and ignore this, so it
+ *  can be called for every buffer regardless of the version.
  */
 void s5p_sysmmu_set_prefbuf(struct device *owner,
 				unsigned long base0, unsigned long size0,
@@ -114,7 +130,9 @@ void s5p_sysmmu_set_prefbuf(struct device *owner,
 #define s5p_sysmmu_disable(owner) do { } while (0)
 #define s5p_sysmmu_set_tablebase_pgd(owner, pgd) do { } while (0)
 #define s5p_sysmmu_tlb_invalidate(owner) do { } while (0)
+#define s5p_sysmmu_tlb_invalidate_range(owner, iova, size) do { } while (0)
 #define s5p_sysmmu_set_fault_handler(sysmmu, handler) do { } while (0)
-#define s5p_sysmmu_set_prefbuf(owner, base, size) do { } while (0)
+#define s5p_sysmmu_set_prefbuf(owner, base0, size0, base1, size1) \
+						do { } while (0)
 #endif
 #endif /* __ASM_PLAT_SYSMMU_H */
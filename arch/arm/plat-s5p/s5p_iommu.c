@@ -19,6 +19,9 @@
 #include <linux/iommu.h>
 #include <linux/errno.h>
 #include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/cacheflush.h>
 
@@ -74,6 +77,7 @@
 	((iova & (~S5P_SECTION_MASK)) >> S5P_SPAGE_SHIFT))
 
 struct s5p_iommu_domain {
+	struct list_head node;		/* element of s5p_iommu_domains */
 	struct device *dev;
 	unsigned long *pgtable;
 	spinlock_t lock;
@@ -82,6 +86,9 @@ struct s5p_iommu_domain {
 /* slab cache for level 2 page tables */
 static struct kmem_cache *l2table_cachep;
 
+static LIST_HEAD(s5p_iommu_domains);
+static DEFINE_MUTEX(s5p_iommu_domains_lock);
+
 static inline void pgtable_flush(void *vastart, void *vaend)
 {
 	dmac_flush_range(vastart, vaend);
@@ -109,6 +116,10 @@ static int s5p_iommu_domain_init(struct iommu_domain *domain)
 
 	spin_lock_init(&priv->lock);
 
+	mutex_lock(&s5p_iommu_domains_lock);
+	list_add(&priv->node, &s5p_iommu_domains);
+	mutex_unlock(&s5p_iommu_domains_lock);
+
 	domain->priv = priv;
 	pr_debug("%s: Allocated IOMMU domain %p with pgtable @ %#lx\n",
 			__func__, domain, __pa(priv->pgtable));
@@ -119,6 +130,10 @@ static void s5p_iommu_domain_destroy(struct iommu_domain *domain)
 {
 	struct s5p_iommu_domain *priv = domain->priv;
 
+	mutex_lock(&s5p_iommu_domains_lock);
+	list_del(&priv->node);
+	mutex_unlock(&s5p_iommu_domains_lock);
+
 	free_pages((unsigned long)priv->pgtable, S5P_LV1TABLE_ORDER);
 	kfree(domain->priv);
 	domain->priv = NULL;
@@ -277,13 +292,14 @@ static int s5p_iommu_map(struct iommu_domain *domain, unsigned long iova,
 	if (S5P_FAULT_LV1_ENTRY(*entry)) {
 		unsigned long *l2table;
 
-		l2table = kmem_cache_zalloc(l2table_cachep, GFP_KERNEL);
+		/* under s5p_domain->lock */
+		l2table = kmem_cache_zalloc(l2table_cachep, GFP_ATOMIC);
 		if (!l2table) {
 			ret = -ENOMEM;
 			goto nomem_error;
 		}
 
-		pgtable_flush(entry, entry + S5P_LV2TABLE_ENTRIES);
+		pgtable_flush(l2table, l2table + S5P_LV2TABLE_ENTRIES);
 
 		MAKE_LV2TABLE_ENTRY(*entry, virt_to_phys(l2table));
 		pgtable_flush(entry, entry + 1);
@@ -400,7 +416,8 @@ static int s5p_iommu_unmap(struct iommu_domain *domain, unsigned long iova,
 	spin_unlock_irqrestore(&s5p_domain->lock, flags);
 
 	if (s5p_domain->dev)
-		s5p_sysmmu_tlb_invalidate(s5p_domain->dev);
+		s5p_sysmmu_tlb_invalidate_range(s5p_domain->dev, iova,
+						PAGE_SIZE << gfp_order);
 
 	return 0;
 }
@@ -439,6 +456,79 @@ static int s5p_iommu_domain_has_cap(struct iommu_domain *domain,
 	return 0;
 }
 
+/* Shows how much of every domain is mapped with each page size */
+static int s5p_iommu_debugfs_show(struct seq_file *s, void *unused)
+{
+	struct s5p_iommu_domain *priv;
+	unsigned long nr_section, nr_lpage, nr_spage, nr_lv2table;
+	unsigned long *entry, *lv2entry;
+	unsigned long flags;
+	const char *name;
+	int i, j;
+
+	mutex_lock(&s5p_iommu_domains_lock);
+	list_for_each_entry(priv, &s5p_iommu_domains, node) {
+		nr_section = nr_lpage = nr_spage = nr_lv2table = 0;
+
+		spin_lock_irqsave(&priv->lock, flags);
+		name = priv->dev ? dev_name(priv->dev) : "detached";
+		spin_unlock_irqrestore(&priv->lock, flags);
+
+		/*
+		 * The lock is only held for one L1 entry at a time, which
+		 * keeps its L2 table from being freed while it is counted.
+		 */
+		for (i = 0; i < S5P_LV1TABLE_ENTRIES; i++) {
+			entry = priv->pgtable + i;
+
+			spin_lock_irqsave(&priv->lock, flags);
+			if (S5P_SECTION_LV1_ENTRY(*entry)) {
+				nr_section++;
+			} else if (S5P_PAGE_LV1_ENTRY(*entry)) {
+				nr_lv2table++;
+				lv2entry = phys_to_virt(*entry &
+							S5P_LV2TABLE_MASK);
+				for (j = 0; j < S5P_LV2TABLE_ENTRIES; j++) {
+					if (S5P_SPAGE_LV2_ENTRY(lv2entry[j]))
+						nr_spage++;
+					else if (S5P_LPAGE_LV2_ENTRY(
+								lv2entry[j]))
+						nr_lpage++;
+				}
+			}
+			spin_unlock_irqrestore(&priv->lock, flags);
+		}
+
+		/* a large page takes 16 level 2 entries */
+		nr_lpage >>= S5P_LPAGE_ORDER;
+
+		seq_printf(s, "pgtable %#lx (%s)\n", __pa(priv->pgtable), name);
+		seq_printf(s, "  1MB sections: %6lu (%lu KB)\n",
+				nr_section, nr_section * (S5P_SECTION_SIZE >> 10));
+		seq_printf(s, "  64KB pages:   %6lu (%lu KB)\n",
+				nr_lpage, nr_lpage * (S5P_LPAGE_SIZE >> 10));
+		seq_printf(s, "  4KB pages:    %6lu (%lu KB)\n",
+				nr_spage, nr_spage * (S5P_SPAGE_SIZE >> 10));
+		seq_printf(s, "  L2 tables:    %6lu (%lu KB)\n", nr_lv2table,
+				(nr_lv2table * S5P_LV2TABLE_SIZE) >> 10);
+	}
+	mutex_unlock(&s5p_iommu_domains_lock);
+
+	return 0;
+}
+
+static int s5p_iommu_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s5p_iommu_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations s5p_iommu_debugfs_fops = {
+	.open		= s5p_iommu_debugfs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct iommu_ops s5p_iommu_ops = {
 	.domain_init = &s5p_iommu_domain_init,
 	.domain_destroy = &s5p_iommu_domain_destroy,
@@ -458,6 +548,9 @@ static int __init s5p_iommu_init(void)
 		return -ENOMEM;
 
 	register_iommu(&s5p_iommu_ops);
+
+	debugfs_create_file("s5p_iommu", 0444, NULL, NULL,
+					&s5p_iommu_debugfs_fops);
 	return 0;
 }
 arch_initcall(s5p_iommu_init);
@@ -8,30 +8,70 @@
  * published by the Free Software Foundation.
  */
 
+/*
+ * The regions of an address space, mapped or cached, are kept in an rbtree
+ * sorted by address. Every region records the free space below it and the
+ * largest such gap in its subtree, so that an allocation descends only into
+ * subtrees where it fits. A zero sized region at the end of the space
+ * holds the gap above the last region.
+ *
+ * Physically contiguous entries of a scatterlist are mapped as one run, and
+ * an IO address is allocated with the same offset from a 1MB (or smaller
+ * power of 2 for small buffers) boundary as the physical address, so that
+ * the runs are mapped with 1MB sections and 64KB large pages.
+ *
+ * iovmm_unmap_cached() keeps the region and its page table entries in a
+ * small cache instead of unmapping them. iovmm_map() of the same pages, as
+ * buffers of a pool are mapped again every frame, gets the same IO address
+ * back without touching the page table or the TLB. Cached regions are
+ * released when the cache is full or the address space runs out.
+ */
+
 #include <linux/slab.h>
 #include <linux/scatterlist.h>
 #include <linux/device.h>
 #include <linux/list.h>
+#include <linux/rbtree.h>
 #include <linux/ion.h>
 #include <linux/iommu.h>
-#include <linux/genalloc.h>
 #include <linux/err.h>
 #include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <plat/iovmm.h>
 
+/* 512MB addr space from 0x80000000 */
+#define IOVA_START	0x80000000
+#define IOVA_SIZE	0x20000000
+
+/* unmapped regions kept for reuse per address space */
+#define IOVMM_CACHE_MAX	32
+
 struct s5p_vm_region {
-	struct list_head node;
+	struct rb_node rb;		/* element of s5p_iovmm.regions */
+	struct list_head lru;		/* element of s5p_iovmm.cache */
 	dma_addr_t start;
 	size_t size;
+	size_t gap;			/* free space below start */
+	size_t max_gap;			/* largest gap in the subtree */
+	phys_addr_t phys;		/* first page mapped at start */
+	size_t mapped;			/* bytes mapped from the pages */
+	off_t offset;			/* of the IO address given out */
 };
 
 struct s5p_iovmm {
 	struct list_head node;		/* element of s5p_iovmm_list */
 	struct iommu_domain *domain;
 	struct device *dev;
-	struct gen_pool *vmm_pool;
-	struct list_head regions_list;	/* list of s5p_vm_region */
+	struct rb_root regions;		/* s5p_vm_region sorted by start */
+	struct s5p_vm_region end;	/* holds the gap at the top */
+	struct list_head cache;		/* unmapped regions, latest first */
+	unsigned int nr_cached;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+	struct dentry *debugfs;
 	bool   active;
 	spinlock_t lock;
 };
@@ -39,34 +79,370 @@ struct s5p_iovmm {
 static DEFINE_RWLOCK(iovmm_list_lock);
 static LIST_HEAD(s5p_iovmm_list);
 
+static struct dentry *iovmm_debugfs_root;
+
 static struct s5p_iovmm *find_iovmm(struct device *dev)
 {
-	struct list_head *pos;
-	struct s5p_iovmm *vmm = NULL;
+	struct s5p_iovmm *vmm;
 
 	read_lock(&iovmm_list_lock);
-	list_for_each(pos, &s5p_iovmm_list) {
-		vmm = list_entry(pos, struct s5p_iovmm, node);
-		if (vmm->dev == dev)
-			break;
+	list_for_each_entry(vmm, &s5p_iovmm_list, node) {
+		if (vmm->dev == dev) {
+			read_unlock(&iovmm_list_lock);
+			return vmm;
+		}
 	}
 	read_unlock(&iovmm_list_lock);
-	return vmm;
+	return NULL;
 }
 
 static struct s5p_vm_region *find_region(struct s5p_iovmm *vmm, dma_addr_t iova)
 {
-	struct list_head *pos;
+	struct rb_node *n = vmm->regions.rb_node;
+	struct s5p_vm_region *region;
+
+	iova = round_down(iova, PAGE_SIZE);
+
+	while (n) {
+		region = rb_entry(n, struct s5p_vm_region, rb);
+		if (iova < region->start)
+			n = n->rb_left;
+		else if (iova > region->start)
+			n = n->rb_right;
+		else
+			return (region == &vmm->end) ? NULL : region;
+	}
+	return NULL;
+}
+
+static size_t region_max_gap(struct rb_node *n)
+{
+	return n ? rb_entry(n, struct s5p_vm_region, rb)->max_gap : 0;
+}
+
+static void region_update_max_gap(struct rb_node *n, void *unused)
+{
+	struct s5p_vm_region *region = rb_entry(n, struct s5p_vm_region, rb);
+
+	region->max_gap = max3(region->gap, region_max_gap(n->rb_left),
+					region_max_gap(n->rb_right));
+}
+
+static void region_propagate(struct rb_node *n)
+{
+	for (; n; n = rb_parent(n))
+		region_update_max_gap(n, NULL);
+}
+
+/*
+ * Returns the lowest address in the subtree of @n where @size fits at
+ * @color bytes past a multiple of @align.
+ */
+static dma_addr_t iova_fit(struct rb_node *n, size_t size, size_t align,
+							size_t color)
+{
+	struct s5p_vm_region *region;
+	dma_addr_t start;
+
+	if (region_max_gap(n) < size)
+		return 0;
+
+	start = iova_fit(n->rb_left, size, align, color);
+	if (start)
+		return start;
+
+	region = rb_entry(n, struct s5p_vm_region, rb);
+	start = ALIGN(region->start - region->gap - color, align) + color;
+	if (start + size <= region->start)
+		return start;
+
+	return iova_fit(n->rb_right, size, align, color);
+}
+
+/* Called with vmm->lock held */
+static int iova_alloc(struct s5p_iovmm *vmm, struct s5p_vm_region *region,
+				size_t size, size_t align, size_t color)
+{
+	struct rb_node **link = &vmm->regions.rb_node;
+	struct rb_node *parent = NULL;
+	struct s5p_vm_region *next;
+	dma_addr_t start;
+
+	start = iova_fit(vmm->regions.rb_node, size, align, color);
+	if (!start)
+		return -ENOMEM;
+
+	while (*link) {
+		parent = *link;
+		if (start < rb_entry(parent, struct s5p_vm_region, rb)->start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	region->start = start;
+	region->size = size;
+	rb_link_node(&region->rb, parent, link);
+	rb_insert_color(&region->rb, &vmm->regions);
+
+	/* never NULL thanks to vmm->end */
+	next = rb_entry(rb_next(&region->rb), struct s5p_vm_region, rb);
+	region->gap = start - (next->start - next->gap);
+	region->max_gap = region->gap;
+	next->gap = next->start - (start + size);
+
+	rb_augment_insert(&region->rb, region_update_max_gap, NULL);
+	region_propagate(&next->rb);
+
+	return 0;
+}
+
+/* Called with vmm->lock held */
+static void iova_free(struct s5p_iovmm *vmm, struct s5p_vm_region *region)
+{
+	struct s5p_vm_region *next;
+	struct rb_node *deepest;
+
+	next = rb_entry(rb_next(&region->rb), struct s5p_vm_region, rb);
+	next->gap += region->gap + region->size;
+
+	deepest = rb_augment_erase_begin(&region->rb);
+	rb_erase(&region->rb, &vmm->regions);
+	rb_augment_erase_end(deepest, region_update_max_gap, NULL);
+	region_propagate(&next->rb);
+}
+
+/*
+ * Walks the page aligned physically contiguous runs of @sg from @offset,
+ * merging adjacent entries, and passes them to @fn with the IO address they
+ * belong at from @addr, up to @size bytes. @fn returns how much of the run
+ * it handled.
+ * Returns the bytes handled, less than @size if @fn stopped early.
+ */
+static size_t iovmm_walk_sg(struct iommu_domain *domain,
+		struct scatterlist *sg, off_t offset, dma_addr_t addr,
+		size_t size, size_t (*fn)(struct iommu_domain *domain,
+				dma_addr_t addr, phys_addr_t phys, size_t len))
+{
+	size_t done = 0;
+
+	do {
+		phys_addr_t phys;
+		size_t len, ret;
+
+		phys = sg_phys(sg);
+		len = sg_dma_len(sg);
+
+		if (offset > 0) {
+			len -= offset;
+			phys += offset;
+			offset = 0;
+		}
+
+		if (offset_in_page(phys)) {
+			len += offset_in_page(phys);
+			phys = round_down(phys, PAGE_SIZE);
+		}
+
+		len = PAGE_ALIGN(len);
+
+		while ((len < (size - done)) && sg_next(sg) &&
+				(sg_phys(sg_next(sg)) == (phys + len))) {
+			sg = sg_next(sg);
+			len += PAGE_ALIGN(sg_dma_len(sg));
+		}
+
+		if (len > (size - done))
+			len = size - done;
+
+		ret = fn(domain, addr, phys, len);
+		addr += ret;
+		done += ret;
+		if (ret < len)
+			break;
+	} while ((sg = sg_next(sg)) && (done < size));
+
+	BUG_ON(done > size);
+
+	return done;
+}
+
+static size_t iovmm_map_chunk(struct iommu_domain *domain, dma_addr_t addr,
+						phys_addr_t phys, size_t len)
+{
+	size_t mapped = 0;
+
+	while (mapped < len) {
+		int order;
+
+		order = min3(__ffs(phys), __ffs(addr), __fls(len - mapped));
+
+		if (iommu_map(domain, addr, phys, order - PAGE_SHIFT, 0))
+			break;
+
+		addr += (1 << order);
+		phys += (1 << order);
+		mapped += (1 << order);
+	}
+
+	return mapped;
+}
+
+static size_t iovmm_match_chunk(struct iommu_domain *domain, dma_addr_t addr,
+						phys_addr_t phys, size_t len)
+{
+	size_t matched;
+
+	for (matched = 0; matched < len; matched += PAGE_SIZE)
+		if (iommu_iova_to_phys(domain, addr + matched) !=
+							phys + matched)
+			break;
+
+	return matched;
+}
+
+static void iovmm_unmap_range(struct iommu_domain *domain, dma_addr_t start,
+								size_t size)
+{
+	while (size != 0) {
+		int order;
+
+		order = min(__fls(size), __ffs(start));
+
+		iommu_unmap(domain, start, order - PAGE_SHIFT);
+
+		start += 1 << order;
+		size -= 1 << order;
+	}
+}
+
+/* @region must be neither cached nor given out */
+static void iovmm_free_region(struct s5p_iovmm *vmm,
+					struct s5p_vm_region *region)
+{
+	unsigned long flags;
+
+	/* the IO addresses must not be reused before they are unmapped */
+	iovmm_unmap_range(vmm->domain, region->start, region->size);
+
+	spin_lock_irqsave(&vmm->lock, flags);
+	iova_free(vmm, region);
+	spin_unlock_irqrestore(&vmm->lock, flags);
+
+	kfree(region);
+}
+
+/* Called with vmm->lock held. Takes the least recently unmapped region. */
+static struct s5p_vm_region *iovmm_cache_evict(struct s5p_iovmm *vmm)
+{
+	struct s5p_vm_region *region;
+
+	if (list_empty(&vmm->cache))
+		return NULL;
+
+	region = list_entry(vmm->cache.prev, struct s5p_vm_region, lru);
+	list_del_init(&region->lru);
+	vmm->nr_cached--;
+	vmm->evictions++;
+
+	return region;
+}
+
+static struct s5p_vm_region *iovmm_cache_get(struct s5p_iovmm *vmm,
+				phys_addr_t phys, off_t offset, size_t size)
+{
 	struct s5p_vm_region *region;
+	unsigned long flags;
 
-	list_for_each(pos, &vmm->regions_list) {
-		region = list_entry(pos, struct s5p_vm_region, node);
-		if (region->start == iova)
+	spin_lock_irqsave(&vmm->lock, flags);
+	list_for_each_entry(region, &vmm->cache, lru) {
+		if (region->phys == phys && region->offset == offset &&
+						region->mapped == size) {
+			list_del_init(&region->lru);
+			vmm->nr_cached--;
+			spin_unlock_irqrestore(&vmm->lock, flags);
 			return region;
+		}
 	}
+	spin_unlock_irqrestore(&vmm->lock, flags);
+
 	return NULL;
 }
 
+static int iovmm_alloc(struct s5p_iovmm *vmm, struct s5p_vm_region *region,
+				size_t size, size_t align, size_t color)
+{
+	struct s5p_vm_region *victim;
+	unsigned long flags;
+
+	spin_lock_irqsave(&vmm->lock, flags);
+
+	vmm->misses++;
+
+	while (iova_alloc(vmm, region, size, align, color)) {
+		victim = iovmm_cache_evict(vmm);
+		if (!victim) {
+			spin_unlock_irqrestore(&vmm->lock, flags);
+			return -ENOMEM;
+		}
+
+		spin_unlock_irqrestore(&vmm->lock, flags);
+		iovmm_free_region(vmm, victim);
+		spin_lock_irqsave(&vmm->lock, flags);
+	}
+
+	spin_unlock_irqrestore(&vmm->lock, flags);
+
+	return 0;
+}
+
+static int iovmm_debugfs_show(struct seq_file *s, void *unused)
+{
+	struct s5p_iovmm *vmm = s->private;
+	struct s5p_vm_region *region;
+	struct rb_node *n;
+	unsigned int nr_regions = 0, nr_cached;
+	unsigned long hits, misses, evictions;
+	size_t used = 0, largest;
+	unsigned long flags;
+
+	spin_lock_irqsave(&vmm->lock, flags);
+	for (n = rb_first(&vmm->regions); n; n = rb_next(n)) {
+		region = rb_entry(n, struct s5p_vm_region, rb);
+		if (region == &vmm->end)
+			continue;
+		nr_regions++;
+		used += region->size;
+	}
+	largest = region_max_gap(vmm->regions.rb_node);
+	nr_cached = vmm->nr_cached;
+	hits = vmm->hits;
+	misses = vmm->misses;
+	evictions = vmm->evictions;
+	spin_unlock_irqrestore(&vmm->lock, flags);
+
+	seq_printf(s, "regions:   %u (%u cached)\n", nr_regions, nr_cached);
+	seq_printf(s, "used:      %zu KB of %u KB, largest free %zu KB\n",
+			used >> 10, IOVA_SIZE >> 10, largest >> 10);
+	seq_printf(s, "hits:      %lu\n", hits);
+	seq_printf(s, "misses:    %lu\n", misses);
+	seq_printf(s, "evictions: %lu\n", evictions);
+
+	return 0;
+}
+
+static int iovmm_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, iovmm_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations iovmm_debugfs_fops = {
+	.open		= iovmm_debugfs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int iovmm_setup(struct device *dev)
 {
 	struct s5p_iovmm *vmm;
@@ -78,17 +454,6 @@ int iovmm_setup(struct device *dev)
 		goto err_setup_alloc;
 	}
 
-	vmm->vmm_pool = gen_pool_create(PAGE_SHIFT, -1);
-	if (!vmm->vmm_pool) {
-		ret = -ENOMEM;
-		goto err_setup_genalloc;
-	}
-
-	/* 1GB addr space from 0x80000000 */
-	ret = gen_pool_add(vmm->vmm_pool, 0x80000000, 0x20000000, -1);
-	if (ret)
-		goto err_setup_domain;
-
 	vmm->domain = iommu_domain_alloc();
 	if (!vmm->domain) {
 		ret = -ENOMEM;
@@ -100,7 +465,19 @@ int iovmm_setup(struct device *dev)
 	spin_lock_init(&vmm->lock);
 
 	INIT_LIST_HEAD(&vmm->node);
-	INIT_LIST_HEAD(&vmm->regions_list);
+	INIT_LIST_HEAD(&vmm->cache);
+
+	vmm->regions = RB_ROOT;
+	vmm->end.start = IOVA_START + IOVA_SIZE;
+	vmm->end.gap = IOVA_SIZE;
+	vmm->end.max_gap = IOVA_SIZE;
+	INIT_LIST_HEAD(&vmm->end.lru);
+	rb_link_node(&vmm->end.rb, NULL, &vmm->regions.rb_node);
+	rb_insert_color(&vmm->end.rb, &vmm->regions);
+
+	if (iovmm_debugfs_root)
+		vmm->debugfs = debugfs_create_file(dev_name(dev), 0444,
+				iovmm_debugfs_root, vmm, &iovmm_debugfs_fops);
 
 	write_lock(&iovmm_list_lock);
 	list_add(&vmm->node, &s5p_iovmm_list);
@@ -108,8 +485,6 @@ int iovmm_setup(struct device *dev)
 
 	return 0;
 err_setup_domain:
-	gen_pool_destroy(vmm->vmm_pool);
-err_setup_genalloc:
 	kfree(vmm);
 err_setup_alloc:
 	return ret;
@@ -123,32 +498,27 @@ void iovmm_cleanup(struct device *dev)
 
 	WARN_ON(!vmm);
 	if (vmm) {
-		struct list_head *pos, *tmp;
+		struct rb_node *n;
+
+		write_lock(&iovmm_list_lock);
+		list_del(&vmm->node);
+		write_unlock(&iovmm_list_lock);
+
+		debugfs_remove(vmm->debugfs);
 
 		if (vmm->active)
 			iommu_detach_device(vmm->domain, dev);
 
 		iommu_domain_free(vmm->domain);
 
-		list_for_each_safe(pos, tmp, &vmm->regions_list) {
-			struct s5p_vm_region *region;
-
-			region = list_entry(pos, struct s5p_vm_region, node);
-
-			/* No need to unmap the region because
-			 * iommu_domain_free() frees the page table */
-			gen_pool_free(vmm->vmm_pool, region->start,
-								region->size);
-
-			kfree(list_entry(pos, struct s5p_vm_region, node));
+		/* No need to unmap the regions because
+		 * iommu_domain_free() frees the page table */
+		while ((n = rb_first(&vmm->regions))) {
+			rb_erase(n, &vmm->regions);
+			if (n != &vmm->end.rb)
+				kfree(rb_entry(n, struct s5p_vm_region, rb));
 		}
 
-		gen_pool_destroy(vmm->vmm_pool);
-
-		write_lock(&iovmm_list_lock);
-		list_del(&vmm->node);
-		write_unlock(&iovmm_list_lock);
-
 		kfree(vmm);
 	}
 }
@@ -192,13 +562,13 @@ dma_addr_t iovmm_map(struct device *dev, struct scatterlist *sg, off_t offset,
 								size_t size)
 {
 	off_t start_off;
-	dma_addr_t addr, start = 0;
-	size_t mapped_size = 0;
+	phys_addr_t phys;
+	size_t iova_size, mapped, align, color;
 	struct s5p_vm_region *region;
 	struct s5p_iovmm *vmm;
-	int order;
+	unsigned long flags;
 #ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
-	size_t iova_size = 0;
+	dma_addr_t addr;
 #endif
 
 	BUG_ON(!sg);
@@ -210,114 +580,71 @@ dma_addr_t iovmm_map(struct device *dev, struct scatterlist *sg, off_t offset,
 	for (; sg_dma_len(sg) < offset; sg = sg_next(sg))
 		offset -= sg_dma_len(sg);
 
-	spin_lock(&vmm->lock);
-
-	start_off = offset_in_page(sg_phys(sg) + offset);
+	phys = sg_phys(sg) + offset;
+	start_off = offset_in_page(phys);
+	phys = round_down(phys, PAGE_SIZE);
 	size = PAGE_ALIGN(size + start_off);
 
-	order = __fls(min(size, (size_t)SZ_1M));
-#ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
-	iova_size = ALIGN(size, SZ_64K);
-	start = (dma_addr_t)gen_pool_alloc_aligned(vmm->vmm_pool, iova_size,
-									order);
-#else
-	start = (dma_addr_t)gen_pool_alloc_aligned(vmm->vmm_pool, size, order);
-#endif
-	if (!start)
-		goto err_map_nomem_lock;
-
-	addr = start;
-	do {
-		phys_addr_t phys;
-		size_t len;
-
-		phys = sg_phys(sg);
-		len = sg_dma_len(sg);
+	region = iovmm_cache_get(vmm, phys, start_off, size);
+	if (region) {
+		/* the same first page does not mean the same pages */
+		if (iovmm_walk_sg(vmm->domain, sg, offset, region->start,
+					size, iovmm_match_chunk) == size) {
+			spin_lock_irqsave(&vmm->lock, flags);
+			vmm->hits++;
+			spin_unlock_irqrestore(&vmm->lock, flags);
 
-		if (offset > 0) {
-			len -= offset;
-			phys += offset;
-			offset = 0;
+			return region->start + start_off;
 		}
 
-		if (offset_in_page(phys)) {
-			len += offset_in_page(phys);
-			phys = round_down(phys, PAGE_SIZE);
-		}
-
-		len = PAGE_ALIGN(len);
-
-		if (len > (size - mapped_size))
-			len = size - mapped_size;
-
-		while (len > 0) {
-			order = min3(__ffs(phys), __ffs(addr), __fls(len));
+		iovmm_free_region(vmm, region);
+	}
 
-			if (iommu_map(vmm->domain, addr, phys,
-							order - PAGE_SHIFT, 0))
-				goto err_map_map;
+	region = kmalloc(sizeof(*region), GFP_KERNEL);
+	if (!region)
+		goto err_map_nomem;
 
-			addr += (1 << order);
-			phys += (1 << order);
-			len -= (1 << order);
-			mapped_size += (1 << order);
-		}
-	} while ((sg = sg_next(sg)) && (mapped_size < size));
+	INIT_LIST_HEAD(&region->lru);
+	region->phys = phys;
+	region->mapped = size;
+	region->offset = start_off;
 
-	BUG_ON(mapped_size > size);
+	align = 1 << __fls(min(size, (size_t)SZ_1M));
+	color = phys & (align - 1);
+	iova_size = size;
+#ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
+	iova_size = ALIGN(size, SZ_64K);
+	color = round_down(color, SZ_64K);
+#endif
+	if (iovmm_alloc(vmm, region, iova_size, align, color))
+		goto err_map_noiova;
 
-	if (mapped_size < size)
+	mapped = iovmm_walk_sg(vmm->domain, sg, offset, region->start, size,
+							iovmm_map_chunk);
+	if (mapped < size)
 		goto err_map_map;
 
 #ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
-	if (iova_size != size) {
-		/* System MMU v3 support in SMDK5250 EVT0 */
-		addr = start + size;
-		size = iova_size;
-
-		for (; addr < start + size; addr += PAGE_SIZE) {
-			if (iommu_map(vmm->domain, addr,
-					page_to_phys(ZERO_PAGE(0)), 0, 0)) {
-				goto err_map_map;
-			}
-			mapped_size += PAGE_SIZE;
-		}
+	/* System MMU v3 support in SMDK5250 EVT0 */
+	for (addr = region->start + size; addr < region->start + iova_size;
+							addr += PAGE_SIZE) {
+		if (iommu_map(vmm->domain, addr,
+				page_to_phys(ZERO_PAGE(0)), 0, 0))
+			goto err_map_map;
+		mapped += PAGE_SIZE;
 	}
 #endif
-	region = kmalloc(sizeof(*region), GFP_KERNEL);
-	if (!region)
-		goto err_map_map;
 
-	region->start = start + start_off;
-	region->size = size;
-	INIT_LIST_HEAD(&region->node);
-
-	list_add(&region->node, &vmm->regions_list);
+	return region->start + start_off;
 
-	spin_unlock(&vmm->lock);
-
-	return region->start;
 err_map_map:
-	while (addr >= start) {
-		int order;
-		mapped_size = addr - start;
+	iovmm_unmap_range(vmm->domain, region->start, mapped);
 
-		if (mapped_size == 0) /* Mapping failed at the first page */
-			mapped_size = size;
-
-		BUG_ON(mapped_size < PAGE_SIZE);
-
-		order = min(__fls(mapped_size), __ffs(start));
-
-		iommu_unmap(vmm->domain, start, order - PAGE_SHIFT);
-
-		start += 1 << order;
-		mapped_size -= 1 << order;
-	}
-	gen_pool_free(vmm->vmm_pool, start, size);
-
-err_map_nomem_lock:
-	spin_unlock(&vmm->lock);
+	spin_lock_irqsave(&vmm->lock, flags);
+	iova_free(vmm, region);
+	spin_unlock_irqrestore(&vmm->lock, flags);
+err_map_noiova:
+	kfree(region);
 err_map_nomem:
 	return (dma_addr_t)0;
 }
@@ -336,33 +663,57 @@ void iovmm_unmap(struct device *dev, dma_addr_t iova)
 	spin_lock_irqsave(&vmm->lock, flags);
 
 	region = find_region(vmm, iova);
-	if (WARN_ON(!region))
-		goto err_region_not_found;
+	if (WARN_ON(!region)) {
+		spin_unlock_irqrestore(&vmm->lock, flags);
+		return;
+	}
 
-	region->start = round_down(region->start, PAGE_SIZE);
+	/* also takes back a mapping left by iovmm_unmap_cached() */
+	if (!list_empty(&region->lru)) {
+		list_del_init(&region->lru);
+		vmm->nr_cached--;
+	}
 
-	gen_pool_free(vmm->vmm_pool, region->start, region->size);
-	list_del(&region->node);
+	spin_unlock_irqrestore(&vmm->lock, flags);
 
-	while (region->size != 0) {
-		int order;
+	iovmm_free_region(vmm, region);
+}
 
-		order = min(__fls(region->size), __ffs(region->start));
+void iovmm_unmap_cached(struct device *dev, dma_addr_t iova)
+{
+	struct s5p_vm_region *region, *victim = NULL;
+	struct s5p_iovmm *vmm;
+	unsigned long flags;
 
-		iommu_unmap(vmm->domain, region->start, order - PAGE_SHIFT);
+	vmm = find_iovmm(dev);
 
-		region->start += 1 << order;
-		region->size -= 1 << order;
-	}
+	if (WARN_ON(!vmm))
+		return;
 
-	kfree(region);
+	spin_lock_irqsave(&vmm->lock, flags);
+
+	region = find_region(vmm, iova);
+	if (WARN_ON(!region || !list_empty(&region->lru)))
+		goto err_region_not_found;
+
+	/* keep the mapping for the next iovmm_map() of the same pages */
+	list_add(&region->lru, &vmm->cache);
+	if (++vmm->nr_cached > IOVMM_CACHE_MAX)
+		victim = iovmm_cache_evict(vmm);
 
 err_region_not_found:
 	spin_unlock_irqrestore(&vmm->lock, flags);
+
+	if (victim)
+		iovmm_free_region(vmm, victim);
 }
 
 static int __init s5p_iovmm_init(void)
 {
+	iovmm_debugfs_root = debugfs_create_dir("iovmm", NULL);
+	if (IS_ERR(iovmm_debugfs_root))
+		iovmm_debugfs_root = NULL;
+
 	return 0;
 }
 arch_initcall(s5p_iovmm_init);
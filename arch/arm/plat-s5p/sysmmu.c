@@ -32,6 +32,13 @@
 #define CTRL_BLOCK	0x7
 #define CTRL_DISABLE	0x0
 
+/*
+ * Invalidating a range takes a register write per page, and the TLB only
+ * holds a few dozen entries. Beyond this many pages, one full flush costs
+ * no more TLB misses and far fewer writes.
+ */
+#define FLUSH_ENTRY_MAX	64
+
 static unsigned short fault_reg_offset[SYSMMU_FAULTS_NUM] = {
 	S5P_PAGE_FAULT_ADDR,
 	S5P_AR_FAULT_ADDR,
@@ -148,6 +155,22 @@ static void __sysmmu_tlb_invalidate(void __iomem *sfrbase)
 	__raw_writel(0x1, sfrbase + S5P_MMU_FLUSH);
 }
 
+static void __sysmmu_tlb_invalidate_range(void __iomem *sfrbase,
+					  unsigned long iova, size_t size)
+{
+	unsigned long end = PAGE_ALIGN(iova + size);
+
+	iova &= PAGE_MASK;
+
+	if (((end - iova) >> PAGE_SHIFT) > FLUSH_ENTRY_MAX) {
+		__sysmmu_tlb_invalidate(sfrbase);
+		return;
+	}
+
+	for (; iova != end; iova += PAGE_SIZE)
+		__raw_writel(iova | 0x1, sfrbase + S5P_MMU_FLUSH_ENTRY);
+}
+
 static void __sysmmu_set_ptbase(void __iomem *sfrbase,
 				       unsigned long pgd)
 {
@@ -181,8 +204,12 @@ void s5p_sysmmu_set_prefbuf(struct device *owner,
 	BUG_ON((base1 + (size1 - 1)) <= base1);
 
 	while ((data = get_sysmmu_data(owner, data))) {
-		if (WARN_ON(data->version != 3))
+		/* callers set them per buffer without knowing the version */
+		if (data->version != 3) {
+			dev_dbg(data->dev, "No prefetch buffer: version %lu\n",
+								data->version);
 			continue;
+		}
 
 		read_lock_irqsave(&data->lock, flags);
 		if (is_sysmmu_active(data)) {
@@ -467,6 +494,30 @@ void s5p_sysmmu_tlb_invalidate(struct device *owner)
 	}
 }
 
+void s5p_sysmmu_tlb_invalidate_range(struct device *owner,
+				     unsigned long iova, size_t size)
+{
+	struct sysmmu_drvdata *mmudata = NULL;
+
+	while ((mmudata = get_sysmmu_data(owner, mmudata))) {
+		unsigned long flags;
+
+		read_lock_irqsave(&mmudata->lock, flags);
+
+		if (is_sysmmu_active(mmudata)) {
+			sysmmu_block(mmudata->sfrbase);
+			__sysmmu_tlb_invalidate_range(mmudata->sfrbase,
+								iova, size);
+			sysmmu_unblock(mmudata->sfrbase);
+		} else {
+			dev_dbg(mmudata->dev,
+				"Disabled: Skipping invalidating TLB.\n");
+		}
+
+		read_unlock_irqrestore(&mmudata->lock, flags);
+	}
+}
+
 static int s5p_sysmmu_probe(struct platform_device *pdev)
 {
 	struct resource *res, *ioarea;
@@ -1429,6 +1429,22 @@ int __cpufreq_driver_target(struct cpufreq_policy *policy,
 }
 EXPORT_SYMBOL_GPL(__cpufreq_driver_target);
 
+/*
+ * Changes the frequency from atomic context if the driver can do the
+ * transition without sleeping. The caller has to make sure the policy
+ * stays valid, e.g. by being its governor.
+ */
+int cpufreq_driver_fast_switch(struct cpufreq_policy *policy,
+			       unsigned int target_freq,
+			       unsigned int relation)
+{
+	if (!cpufreq_driver->fast_switch)
+		return -EAGAIN;
+
+	return cpufreq_driver->fast_switch(policy, target_freq, relation);
+}
+EXPORT_SYMBOL_GPL(cpufreq_driver_fast_switch);
+
 int cpufreq_driver_target(struct cpufreq_policy *policy,
 			  unsigned int target_freq,
 			  unsigned int relation)
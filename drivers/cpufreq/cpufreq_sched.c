@@ -0,0 +1,486 @@
+/*
+ * drivers/cpufreq/cpufreq_sched.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * 'sched' governor: the frequency follows the utilization of the
+ * runqueues, which the scheduler reports whenever nr_running changes
+ * and on every tick. The utilization of a cpu is the fraction of time it
+ * had tasks queued, averaged with a half-life of up_halflife_us while
+ * busy and down_halflife_us while idle, so load spikes show up within
+ * one tick. The frequency is re-evaluated at most every rate_limit_us.
+ * No sampling timer is used, so idle cpus are not woken up.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+
+#define UTIL_SCALE		1024
+
+#define DEFAULT_UP_HALFLIFE	(2 * USEC_PER_MSEC)
+#define DEFAULT_DOWN_HALFLIFE	(16 * USEC_PER_MSEC)
+#define DEFAULT_TARGET_LOAD	80
+#define DEFAULT_GO_HISPEED_LOAD	95
+#define DEFAULT_DOWN_DELAY	(20 * USEC_PER_MSEC)
+#define DEFAULT_RATE_LIMIT	(1 * USEC_PER_MSEC)
+
+/* delay of the kthread kick, see cpufreq_sched_slow_kick() */
+#define SLOW_KICK_DELAY_NS	(20 * NSEC_PER_USEC)
+
+static unsigned long up_halflife_us;
+static unsigned long down_halflife_us;
+static unsigned long target_load;
+static unsigned long go_hispeed_load;
+static unsigned long down_delay_us;
+static unsigned long rate_limit_us;
+
+/* 1024 * 0.5^(k/32) */
+static const u16 half_pow[32] = {
+	1024, 1002, 981, 960, 939, 919, 899, 880,
+	861, 843, 825, 807, 790, 773, 756, 740,
+	724, 709, 693, 679, 664, 650, 636, 622,
+	609, 596, 583, 571, 558, 546, 535, 523,
+};
+
+struct cpufreq_sched_policy {
+	raw_spinlock_t lock;		/* also protects the cpuinfo of cpus */
+	struct cpufreq_policy *policy;
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int freq;		/* last requested */
+	unsigned int slow_freq;		/* pending for the slow path */
+	u64 up_time;			/* of the last increase */
+	u64 last_eval;
+};
+
+struct cpufreq_sched_cpuinfo {
+	struct cpufreq_sched_policy *sp;
+	u64 last_update;
+	unsigned int util;
+	int busy;
+	int enabled;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_sched_cpuinfo, sched_cpuinfo);
+
+static int active_count;
+static DEFINE_MUTEX(gov_lock);
+static DEFINE_MUTEX(set_speed_lock);
+
+/* Transitions which cannot be done from the scheduler run in here */
+static struct task_struct *slow_task;
+static cpumask_t slow_cpumask;
+static DEFINE_RAW_SPINLOCK(slow_lock);
+static DEFINE_PER_CPU(struct hrtimer, slow_kick);
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+static
+#endif
+struct cpufreq_governor cpufreq_gov_sched = {
+	.name = "sched",
+	.governor = cpufreq_governor_sched,
+	.max_transition_latency = 10000000,
+	.owner = THIS_MODULE,
+};
+
+static inline unsigned int util_decay(unsigned int val, u64 periods)
+{
+	if (periods >= 32 * 11)
+		return 0;
+
+	return ((val * half_pow[periods & 31]) >> 10) >> (periods >> 5);
+}
+
+/*
+ * Utilization of pcpu at now. The time left over from whole 1/32
+ * half-life periods is returned in rest.
+ */
+static unsigned int util_at(struct cpufreq_sched_cpuinfo *pcpu, u64 now,
+			    u64 *rest)
+{
+	u32 period;
+	u64 delta, periods;
+	unsigned int util = pcpu->util;
+
+	*rest = 0;
+	if (now <= pcpu->last_update)
+		return util;
+
+	delta = now - pcpu->last_update;
+	if (pcpu->busy)
+		period = up_halflife_us * NSEC_PER_USEC / 32;
+	else
+		period = down_halflife_us * NSEC_PER_USEC / 32;
+
+	periods = div_u64(delta, period ? : 1);
+	*rest = delta - periods * period;
+
+	if (pcpu->busy)
+		return UTIL_SCALE - util_decay(UTIL_SCALE - util, periods);
+
+	return util_decay(util, periods);
+}
+
+static enum hrtimer_restart cpufreq_sched_kick(struct hrtimer *timer)
+{
+	wake_up_process(slow_task);
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Wake up slow_task soon. Our caller holds a runqueue lock, so the
+ * wakeup cannot be done here, and irq_work would only run from the next
+ * tick since ARM has no way to raise it. A pinned hrtimer is started
+ * without waking softirqs, as hrtick_start() does; the kick is then
+ * made from the timer interrupt.
+ */
+static void cpufreq_sched_slow_kick(void)
+{
+	struct hrtimer *timer = &__get_cpu_var(slow_kick);
+
+	if (!hrtimer_active(timer))
+		__hrtimer_start_range_ns(timer,
+					 ns_to_ktime(SLOW_KICK_DELAY_NS), 0,
+					 HRTIMER_MODE_REL_PINNED, 0);
+}
+
+/* Called with sp->lock held and interrupts disabled. */
+static void cpufreq_sched_eval(struct cpufreq_sched_policy *sp, u64 now)
+{
+	struct cpufreq_policy *policy = sp->policy;
+	unsigned int max_util = 0, util, load, freq, index;
+	u64 rest;
+	int j, ret;
+
+	for_each_cpu(j, policy->cpus) {
+		struct cpufreq_sched_cpuinfo *pjcpu = &per_cpu(sched_cpuinfo, j);
+
+		if (!cpu_online(j) || !pjcpu->enabled)
+			continue;
+
+		util = util_at(pjcpu, now, &rest);
+		if (util > max_util)
+			max_util = util;
+	}
+
+	load = max_util * 100 / UTIL_SCALE;
+	if (load >= go_hispeed_load)
+		freq = policy->max;
+	else
+		freq = sp->freq * load / target_load;
+
+	if (cpufreq_frequency_table_target(policy, sp->freq_table, freq,
+					   CPUFREQ_RELATION_L, &index))
+		return;
+
+	freq = sp->freq_table[index].frequency;
+	if (freq == sp->freq)
+		return;
+
+	if (freq < sp->freq &&
+	    now - sp->up_time < (u64)down_delay_us * NSEC_PER_USEC)
+		return;
+
+	ret = cpufreq_driver_fast_switch(policy, freq, CPUFREQ_RELATION_L);
+	if (!ret) {
+		if (freq > sp->freq)
+			sp->up_time = now;
+		sp->freq = freq;
+	} else if (ret == -EAGAIN && sp->slow_freq != freq) {
+		sp->slow_freq = freq;
+		raw_spin_lock(&slow_lock);
+		cpumask_set_cpu(policy->cpu, &slow_cpumask);
+		raw_spin_unlock(&slow_lock);
+		cpufreq_sched_slow_kick();
+	}
+}
+
+void cpufreq_sched_update(int cpu, unsigned long nr_running, u64 now)
+{
+	struct cpufreq_sched_cpuinfo *pcpu = &per_cpu(sched_cpuinfo, cpu);
+	struct cpufreq_sched_policy *sp;
+	unsigned long flags;
+	u64 rest;
+
+	if (!pcpu->enabled)
+		return;
+
+	smp_rmb();
+	sp = pcpu->sp;
+
+	raw_spin_lock_irqsave(&sp->lock, flags);
+	pcpu->util = util_at(pcpu, now, &rest);
+	if (now > pcpu->last_update)
+		pcpu->last_update = now - rest;
+	pcpu->busy = nr_running > 0;
+
+	/* the runqueue clocks of the cpus may be slightly apart */
+	if ((s64)(now - sp->last_eval) >=
+	    (s64)rate_limit_us * NSEC_PER_USEC) {
+		sp->last_eval = now;
+		cpufreq_sched_eval(sp, now);
+	}
+	raw_spin_unlock_irqrestore(&sp->lock, flags);
+}
+
+static int cpufreq_sched_slow_task(void *data)
+{
+	struct cpufreq_sched_cpuinfo *pcpu;
+	struct cpufreq_sched_policy *sp;
+	unsigned long flags;
+	unsigned int cpu, freq;
+	cpumask_t tmp_mask;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		raw_spin_lock_irqsave(&slow_lock, flags);
+
+		if (cpumask_empty(&slow_cpumask)) {
+			raw_spin_unlock_irqrestore(&slow_lock, flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			raw_spin_lock_irqsave(&slow_lock, flags);
+		}
+
+		set_current_state(TASK_RUNNING);
+		tmp_mask = slow_cpumask;
+		cpumask_clear(&slow_cpumask);
+		raw_spin_unlock_irqrestore(&slow_lock, flags);
+
+		for_each_cpu(cpu, &tmp_mask) {
+			mutex_lock(&set_speed_lock);
+
+			pcpu = &per_cpu(sched_cpuinfo, cpu);
+			smp_rmb();
+			if (!pcpu->enabled) {
+				mutex_unlock(&set_speed_lock);
+				continue;
+			}
+
+			sp = pcpu->sp;
+			raw_spin_lock_irqsave(&sp->lock, flags);
+			freq = sp->slow_freq;
+			sp->slow_freq = 0;
+			raw_spin_unlock_irqrestore(&sp->lock, flags);
+
+			if (freq)
+				__cpufreq_driver_target(sp->policy, freq,
+							CPUFREQ_RELATION_L);
+
+			raw_spin_lock_irqsave(&sp->lock, flags);
+			if (sp->policy->cur > sp->freq)
+				sp->up_time = sched_clock();
+			sp->freq = sp->policy->cur;
+			raw_spin_unlock_irqrestore(&sp->lock, flags);
+
+			mutex_unlock(&set_speed_lock);
+		}
+	}
+
+	return 0;
+}
+
+#define sched_gov_attr(_name, _min, _max)				\
+static ssize_t show_##_name(struct kobject *kobj,			\
+			    struct attribute *attr, char *buf)		\
+{									\
+	return sprintf(buf, "%lu\n", _name);				\
+}									\
+									\
+static ssize_t store_##_name(struct kobject *kobj,			\
+			     struct attribute *attr, const char *buf,	\
+			     size_t count)				\
+{									\
+	int ret;							\
+	unsigned long val;						\
+									\
+	ret = strict_strtoul(buf, 0, &val);				\
+	if (ret < 0)							\
+		return ret;						\
+	if (val < (_min) || val > (_max))				\
+		return -EINVAL;						\
+	_name = val;							\
+	return count;							\
+}									\
+									\
+static struct global_attr _name##_attr = __ATTR(_name, 0644,		\
+		show_##_name, store_##_name)
+
+sched_gov_attr(up_halflife_us, 1, USEC_PER_SEC);
+sched_gov_attr(down_halflife_us, 1, USEC_PER_SEC);
+sched_gov_attr(target_load, 1, 100);
+sched_gov_attr(go_hispeed_load, 1, 100);
+sched_gov_attr(down_delay_us, 0, USEC_PER_SEC);
+sched_gov_attr(rate_limit_us, 0, 100 * USEC_PER_MSEC);
+
+static struct attribute *sched_attributes[] = {
+	&up_halflife_us_attr.attr,
+	&down_halflife_us_attr.attr,
+	&target_load_attr.attr,
+	&go_hispeed_load_attr.attr,
+	&down_delay_us_attr.attr,
+	&rate_limit_us_attr.attr,
+	NULL,
+};
+
+static struct attribute_group sched_attr_group = {
+	.attrs = sched_attributes,
+	.name = "sched",
+};
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	int rc;
+	unsigned int j;
+	unsigned long flags;
+	struct cpufreq_sched_cpuinfo *pcpu;
+	struct cpufreq_sched_policy *sp;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!cpu_online(policy->cpu))
+			return -EINVAL;
+
+		sp = kzalloc(sizeof(*sp), GFP_KERNEL);
+		if (!sp)
+			return -ENOMEM;
+
+		raw_spin_lock_init(&sp->lock);
+		sp->policy = policy;
+		sp->freq_table = cpufreq_frequency_get_table(policy->cpu);
+		sp->freq = policy->cur;
+		if (!sp->freq_table) {
+			kfree(sp);
+			return -EINVAL;
+		}
+
+		/*
+		 * Do not create sysfs entries if we have already done so.
+		 */
+		mutex_lock(&gov_lock);
+		if (!active_count) {
+			rc = sysfs_create_group(cpufreq_global_kobject,
+					&sched_attr_group);
+			if (rc) {
+				mutex_unlock(&gov_lock);
+				kfree(sp);
+				return rc;
+			}
+		}
+		active_count++;
+		mutex_unlock(&gov_lock);
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(sched_cpuinfo, j);
+			pcpu->sp = sp;
+			pcpu->util = 0;
+			pcpu->busy = 0;
+			pcpu->last_update = sched_clock();
+			smp_wmb();
+			pcpu->enabled = 1;
+		}
+
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		pcpu = &per_cpu(sched_cpuinfo, policy->cpu);
+		sp = pcpu->sp;
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(sched_cpuinfo, j);
+			pcpu->enabled = 0;
+			smp_wmb();
+		}
+
+		/* the scheduler hook runs with interrupts disabled */
+		synchronize_sched();
+
+		mutex_lock(&set_speed_lock);
+		raw_spin_lock_irqsave(&slow_lock, flags);
+		cpumask_clear_cpu(policy->cpu, &slow_cpumask);
+		raw_spin_unlock_irqrestore(&slow_lock, flags);
+		mutex_unlock(&set_speed_lock);
+
+		kfree(sp);
+
+		mutex_lock(&gov_lock);
+		if (!--active_count)
+			sysfs_remove_group(cpufreq_global_kobject,
+					&sched_attr_group);
+		mutex_unlock(&gov_lock);
+
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		mutex_lock(&set_speed_lock);
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->min, CPUFREQ_RELATION_L);
+
+		sp = per_cpu(sched_cpuinfo, policy->cpu).sp;
+		raw_spin_lock_irqsave(&sp->lock, flags);
+		sp->freq = policy->cur;
+		raw_spin_unlock_irqrestore(&sp->lock, flags);
+		mutex_unlock(&set_speed_lock);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_sched_init(void)
+{
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
+	unsigned int cpu;
+
+	up_halflife_us = DEFAULT_UP_HALFLIFE;
+	down_halflife_us = DEFAULT_DOWN_HALFLIFE;
+	target_load = DEFAULT_TARGET_LOAD;
+	go_hispeed_load = DEFAULT_GO_HISPEED_LOAD;
+	down_delay_us = DEFAULT_DOWN_DELAY;
+	rate_limit_us = DEFAULT_RATE_LIMIT;
+
+	for_each_possible_cpu(cpu) {
+		struct hrtimer *timer = &per_cpu(slow_kick, cpu);
+
+		hrtimer_init(timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		timer->function = cpufreq_sched_kick;
+	}
+
+	slow_task = kthread_create(cpufreq_sched_slow_task, NULL,
+				   "ksched_freq");
+	if (IS_ERR(slow_task))
+		return PTR_ERR(slow_task);
+
+	sched_setscheduler_nocheck(slow_task, SCHED_FIFO, &param);
+	get_task_struct(slow_task);
+
+	return cpufreq_register_governor(&cpufreq_gov_sched);
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+fs_initcall(cpufreq_sched_init);
+#else
+module_init(cpufreq_sched_init);
+#endif
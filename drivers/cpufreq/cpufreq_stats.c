@@ -20,6 +20,7 @@
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
+#include <linux/ktime.h>
 #include <asm/cputime.h>
 
 static spinlock_t cpufreq_stats_lock;
@@ -30,6 +31,12 @@ static struct freq_attr _attr_##_name = {\
 	.show = _show,\
 };
 
+/* upper bounds in usecs of the transition latency histogram buckets */
+static const unsigned int trans_lat_bound[] = {
+	10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000,
+};
+#define TRANS_LAT_BUCKETS	(ARRAY_SIZE(trans_lat_bound) + 1)
+
 struct cpufreq_stats {
 	unsigned int cpu;
 	unsigned int total_trans;
@@ -42,6 +49,8 @@ struct cpufreq_stats {
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
+	ktime_t trans_start;		/* of the transition in flight */
+	unsigned int trans_lat[TRANS_LAT_BUCKETS];
 };
 
 static DEFINE_PER_CPU(struct cpufreq_stats *, cpufreq_stats_table);
@@ -93,6 +102,24 @@ static ssize_t show_time_in_state(struct cpufreq_policy *policy, char *buf)
 	return len;
 }
 
+/* time from PRECHANGE to POSTCHANGE, i.e. until the new frequency runs */
+static ssize_t show_trans_latency(struct cpufreq_policy *policy, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	spin_lock(&cpufreq_stats_lock);
+	for (i = 0; i < TRANS_LAT_BUCKETS - 1; i++)
+		len += sprintf(buf + len, "<=%uus %u\n", trans_lat_bound[i],
+				stat->trans_lat[i]);
+	len += sprintf(buf + len, ">%uus %u\n", trans_lat_bound[i - 1],
+			stat->trans_lat[i]);
+	spin_unlock(&cpufreq_stats_lock);
+	return len;
+}
+
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
 {
@@ -142,10 +169,12 @@ CPUFREQ_STATDEVICE_ATTR(trans_table, 0444, show_trans_table);
 
 CPUFREQ_STATDEVICE_ATTR(total_trans, 0444, show_total_trans);
 CPUFREQ_STATDEVICE_ATTR(time_in_state, 0444, show_time_in_state);
+CPUFREQ_STATDEVICE_ATTR(trans_latency, 0444, show_trans_latency);
 
 static struct attribute *default_attrs[] = {
 	&_attr_total_trans.attr,
 	&_attr_time_in_state.attr,
+	&_attr_trans_latency.attr,
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	&_attr_trans_table.attr,
 #endif
@@ -287,14 +316,31 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	struct cpufreq_freqs *freq = data;
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
+	unsigned int lat, i;
 
-	if (val != CPUFREQ_POSTCHANGE)
+	if (val != CPUFREQ_PRECHANGE && val != CPUFREQ_POSTCHANGE)
 		return 0;
 
 	stat = per_cpu(cpufreq_stats_table, freq->cpu);
 	if (!stat)
 		return 0;
 
+	if (val == CPUFREQ_PRECHANGE) {
+		stat->trans_start = ktime_get();
+		return 0;
+	}
+
+	if (stat->trans_start.tv64) {
+		lat = ktime_to_us(ktime_sub(ktime_get(), stat->trans_start));
+		for (i = 0; i < TRANS_LAT_BUCKETS - 1; i++)
+			if (lat <= trans_lat_bound[i])
+				break;
+		spin_lock(&cpufreq_stats_lock);
+		stat->trans_lat[i]++;
+		spin_unlock(&cpufreq_stats_lock);
+		stat->trans_start.tv64 = 0;
+	}
+
 	old_index = stat->last_index;
 	new_index = freq_table_get_index(stat, freq->new);
 
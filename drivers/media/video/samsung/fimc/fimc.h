@@ -272,6 +272,22 @@ struct fimc_capinfo {
 	u32			flip;
 	u32			rotate;
 	bool			cacheable;
+	/* geometry of the allocated buffer pool, kept across REQBUFS(0) */
+	u32			pool_fmt;
+	u32			pool_width;
+	u32			pool_height;
+	u32			pool_pktdata;
+	int			pool_bufs;
+};
+
+/* capture buffer exported to other devices/processes by fd */
+struct fimc_capbuf_export {
+	struct fimc_control	*ctrl;
+	dma_addr_t		base[4];
+	size_t			length[4];
+	dma_addr_t		start;
+	size_t			size;
+	bool			cacheable;
 };
 
 /* for output overlay device */
@@ -418,6 +434,8 @@ struct fimc_is {
 	u32 zoom_in_height;
 };
 
+struct fimc_m2m_dev;
+
 /* fimc controller abstration */
 struct fimc_control {
 	int				id;		/* controller id */
@@ -465,6 +483,9 @@ struct fimc_control {
 	enum fimc_power_status		power_status;
 	char 				cma_name[16];
 	bool				restart;
+	atomic_t			cap_exported;	/* exported capbufs */
+	struct fimc_capinfo		*cap_orphan;	/* closed, still exported */
+	struct fimc_m2m_dev		*m2m;		/* owned by fimc-m2m */
 };
 
 /* global */
@@ -577,6 +598,7 @@ extern int fimc_s_fmt_vid_capture(struct file *file, void *fh, struct v4l2_forma
 extern int fimc_s_fmt_vid_private(struct file *file, void *fh, struct v4l2_format *f);
 extern int fimc_try_fmt_vid_capture(struct file *file, void *fh, struct v4l2_format *f);
 extern int fimc_reqbufs_capture(void *fh, struct v4l2_requestbuffers *b);
+extern int fimc_capbuf_get_phys(int fd, struct fimc_buf *buf);
 extern int fimc_querybuf_capture(void *fh, struct v4l2_buffer *b);
 extern int fimc_g_ctrl_capture(void *fh, struct v4l2_control *c);
 extern int fimc_g_ext_ctrls_capture(void *fh, struct v4l2_ext_controls *c);
@@ -643,6 +665,20 @@ extern int fimc_s_fmt_vid_overlay(struct file *filp, void *fh, struct v4l2_forma
 extern int fimc_g_fbuf(struct file *filp, void *fh, struct v4l2_framebuffer *fb);
 extern int fimc_s_fbuf(struct file *filp, void *fh, struct v4l2_framebuffer *fb);
 
+/* mem-to-mem device */
+#ifdef CONFIG_VIDEO_FIMC_M2M
+extern int fimc_m2m_register(struct fimc_control *ctrl);
+extern void fimc_m2m_unregister(struct fimc_control *ctrl);
+extern void fimc_irq_m2m(struct fimc_control *ctrl);
+#else
+static inline int fimc_m2m_register(struct fimc_control *ctrl)
+{
+	return 0;
+}
+static inline void fimc_m2m_unregister(struct fimc_control *ctrl) {}
+static inline void fimc_irq_m2m(struct fimc_control *ctrl) {}
+#endif
+
 /* Register access file */
 extern int fimc_hwset_camera_source(struct fimc_control *ctrl);
 extern int fimc_hwset_camera_change_source(struct fimc_control *ctrl);
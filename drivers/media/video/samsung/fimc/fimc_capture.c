@@ -21,6 +21,8 @@
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
 #include <linux/uaccess.h>
+#include <linux/anon_inodes.h>
+#include <linux/file.h>
 #include <plat/media.h>
 #include <plat/clock.h>
 #include <plat/fimc.h>
@@ -1488,8 +1490,167 @@ static void fimc_free_buffers(struct fimc_control *ctrl)
 	}
 
 	ctrl->mem.curr = ctrl->mem.base;
+	cap->pool_bufs = 0;
 }
 
+/*
+ * Buffers are kept allocated across REQBUFS(0) and stream restarts.
+ * A following REQBUFS with the same format and no more buffers than
+ * the pool holds reuses them without reallocation.
+ */
+static int fimc_capture_pool_match(struct fimc_capinfo *cap, int count)
+{
+	return cap->pool_bufs && count <= cap->pool_bufs &&
+		cap->pool_fmt == cap->fmt.pixelformat &&
+		cap->pool_width == cap->fmt.width &&
+		cap->pool_height == cap->fmt.height &&
+		cap->pool_pktdata == (cap->pktdata_enable ? cap->pktdata_size : 0);
+}
+
+static void fimc_capture_pool_set(struct fimc_capinfo *cap)
+{
+	cap->pool_fmt = cap->fmt.pixelformat;
+	cap->pool_width = cap->fmt.width;
+	cap->pool_height = cap->fmt.height;
+	cap->pool_pktdata = cap->pktdata_enable ? cap->pktdata_size : 0;
+	cap->pool_bufs = cap->nr_bufs;
+}
+
+/*
+ * Frees the buffers of a capture device closed while some of them were
+ * exported, once the last exported descriptor is closed.
+ */
+static int fimc_capbuf_release(struct inode *inode, struct file *filp)
+{
+	struct fimc_capbuf_export *exp = filp->private_data;
+	struct fimc_control *ctrl = exp->ctrl;
+	struct fimc_capinfo *cap = NULL;
+	int i;
+
+	mutex_lock(&ctrl->v4l2_lock);
+	if (atomic_dec_and_test(&ctrl->cap_exported)) {
+		cap = ctrl->cap_orphan;
+		ctrl->cap_orphan = NULL;
+	}
+
+	if (cap) {
+		for (i = 0; i < FIMC_CAPBUFS; i++) {
+			fimc_dma_free(ctrl, &cap->bufs[i], 0);
+			fimc_dma_free(ctrl, &cap->bufs[i], 1);
+			fimc_dma_free(ctrl, &cap->bufs[i], 2);
+		}
+		if (!ctrl->cap)
+			ctrl->mem.curr = ctrl->mem.base;
+		kfree(cap);
+	}
+	mutex_unlock(&ctrl->v4l2_lock);
+
+	kfree(exp);
+
+	return 0;
+}
+
+static int fimc_capbuf_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct fimc_capbuf_export *exp = filp->private_data;
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	/* no shifted or summed value may wrap before the checks */
+	if (vma->vm_pgoff > (exp->size >> PAGE_SHIFT) ||
+	    size > exp->size - (vma->vm_pgoff << PAGE_SHIFT))
+		return -EINVAL;
+
+	if (!exp->cacheable)
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
+	vma->vm_flags |= VM_RESERVED;
+
+	if (remap_pfn_range(vma, vma->vm_start,
+			__phys_to_pfn(exp->start) + vma->vm_pgoff,
+			size, vma->vm_page_prot))
+		return -EAGAIN;
+
+	return 0;
+}
+
+static const struct file_operations fimc_capbuf_fops = {
+	.release	= fimc_capbuf_release,
+	.mmap		= fimc_capbuf_mmap,
+};
+
+/*
+ * Export capture buffer @idx as a file descriptor which can be passed
+ * to other processes and mmapped, or resolved to its physical planes
+ * by other drivers with fimc_capbuf_get_phys(). The buffer pool is not
+ * reallocated while any exported descriptor is open, and outlives the
+ * capture device being closed until the last one is.
+ */
+static int fimc_capbuf_export(struct fimc_control *ctrl, int idx)
+{
+	struct fimc_capinfo *cap = ctrl->cap;
+	struct fimc_buf_set *bs;
+	struct fimc_capbuf_export *exp;
+	dma_addr_t end = 0;
+	int i, fd;
+
+	if (idx < 0 || idx >= cap->nr_bufs || !cap->bufs[idx].base[0])
+		return -EINVAL;
+
+	exp = kzalloc(sizeof(*exp), GFP_KERNEL);
+	if (!exp)
+		return -ENOMEM;
+
+	bs = &cap->bufs[idx];
+	for (i = 0; i < 4; i++) {
+		exp->base[i] = bs->base[i];
+		exp->length[i] = bs->length[i];
+		if (bs->base[i] && bs->base[i] + bs->length[i] > end)
+			end = bs->base[i] + bs->length[i];
+	}
+	exp->ctrl = ctrl;
+	exp->start = bs->base[0];
+	exp->size = PAGE_ALIGN(end - exp->start);
+	exp->cacheable = cap->cacheable;
+
+	atomic_inc(&ctrl->cap_exported);
+	fd = anon_inode_getfd("fimc-capbuf", &fimc_capbuf_fops, exp,
+				O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		atomic_dec(&ctrl->cap_exported);
+		kfree(exp);
+	}
+
+	fimc_info1("%s: buf %d exported fd %d\n", __func__, idx, fd);
+	return fd;
+}
+
+/* The addresses stay valid only as long as the caller keeps @fd open */
+int fimc_capbuf_get_phys(int fd, struct fimc_buf *buf)
+{
+	struct fimc_capbuf_export *exp;
+	struct file *filp;
+	int i;
+
+	filp = fget(fd);
+	if (!filp)
+		return -EBADF;
+
+	if (filp->f_op != &fimc_capbuf_fops) {
+		fput(filp);
+		return -EINVAL;
+	}
+
+	exp = filp->private_data;
+	for (i = 0; i < 3; i++) {
+		buf->base[i] = exp->base[i];
+		buf->length[i] = exp->length[i];
+	}
+	fput(filp);
+
+	return 0;
+}
+EXPORT_SYMBOL(fimc_capbuf_get_phys);
+
 int fimc_reqbufs_capture_mmap(void *fh, struct v4l2_requestbuffers *b)
 {
 	struct fimc_control *ctrl = fh;
@@ -1501,6 +1662,7 @@ int fimc_reqbufs_capture_mmap(void *fh, struct v4l2_requestbuffers *b)
 	int ret = 0, i;
 	int bpp = 0;
 	int size = 0;
+	int reuse;
 
 	if (!cap) {
 		fimc_err("%s: no capture device info\n", __func__);
@@ -1509,22 +1671,52 @@ int fimc_reqbufs_capture_mmap(void *fh, struct v4l2_requestbuffers *b)
 
 	mutex_lock(&ctrl->v4l2_lock);
 
-	/*  A count value of zero frees all buffers */
+	/*
+	 * A count value of zero stops streaming but keeps the buffer pool
+	 * for the next REQBUFS; an out of range count frees all buffers.
+	 */
 	if ((b->count == 0) || (b->count >= FIMC_CAPBUFS)) {
 		/* aborting or finishing any DMA in progress */
 		if (ctrl->status == FIMC_STREAMON)
 			fimc_streamoff_capture(fh);
+
+		if (b->count == 0 && cap->pool_bufs) {
+			mutex_unlock(&ctrl->v4l2_lock);
+			return 0;
+		}
+
+		if (atomic_read(&ctrl->cap_exported)) {
+			mutex_unlock(&ctrl->v4l2_lock);
+			return -EBUSY;
+		}
+
 		for (i = 0; i < FIMC_CAPBUFS; i++) {
 			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 0);
 			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 1);
 			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 2);
 		}
+		cap->pool_bufs = 0;
 
 		mutex_unlock(&ctrl->v4l2_lock);
 		return 0;
 	}
+
+	if (cap->pktdata_enable)
+		cap->pktdata_size = 0x1000;
+
+	reuse = fimc_capture_pool_match(cap, b->count);
+	if (!reuse && atomic_read(&ctrl->cap_exported)) {
+		fimc_err("%s: buffers are exported, cannot reallocate\n",
+				__func__);
+		mutex_unlock(&ctrl->v4l2_lock);
+		return -EBUSY;
+	}
+
 	/* free previous buffers */
-	if ((cap->nr_bufs >= 0) && (cap->nr_bufs < FIMC_CAPBUFS)) {
+	if (reuse) {
+		fimc_info1("%s: reuse %d of %d pooled buffers\n", __func__,
+				b->count, cap->pool_bufs);
+	} else if ((cap->nr_bufs >= 0) && (cap->nr_bufs < FIMC_CAPBUFS)) {
 		fimc_err("%s : remained previous buffer count is %d\n", __func__,
 				cap->nr_bufs);
 		for (i = 0; i < cap->nr_bufs; i++) {
@@ -1533,7 +1725,8 @@ int fimc_reqbufs_capture_mmap(void *fh, struct v4l2_requestbuffers *b)
 			fimc_dma_free(ctrl, &cap->bufs[i], 2);
 		}
 	}
-	fimc_free_buffers(ctrl);
+	if (!reuse)
+		fimc_free_buffers(ctrl);
 
 	cap->nr_bufs = b->count;
 	if (pdata->hw_ver >= 0x51) {
@@ -1567,9 +1760,14 @@ int fimc_reqbufs_capture_mmap(void *fh, struct v4l2_requestbuffers *b)
 		}
 	}
 
-	if (cap->pktdata_enable)
-		cap->pktdata_size = 0x1000;
-		
+	if (reuse) {
+		for (i = 0; i < cap->nr_bufs; i++)
+			cap->bufs[i].state = VIDEOBUF_PREPARED;
+
+		mutex_unlock(&ctrl->v4l2_lock);
+		return 0;
+	}
+
 	bpp = fimc_fmt_depth(ctrl, &cap->fmt);
 
 	switch (cap->fmt.pixelformat) {
@@ -1630,6 +1828,7 @@ int fimc_reqbufs_capture_mmap(void *fh, struct v4l2_requestbuffers *b)
 		return -ENOMEM;
 	}
 
+	fimc_capture_pool_set(cap);
 	mutex_unlock(&ctrl->v4l2_lock);
 
 	return 0;
@@ -1855,6 +2054,16 @@ int fimc_s_ctrl_capture(void *fh, struct v4l2_control *c)
 		if (&ctrl->cap->bufs[c->value])
 			c->value = ctrl->cap->bufs[c->value].base[FIMC_ADDR_CR];
 		break;
+
+	case V4L2_CID_CAPBUF_EXPORT:
+		mutex_lock(&ctrl->v4l2_lock);
+		ret = fimc_capbuf_export(ctrl, c->value);
+		mutex_unlock(&ctrl->v4l2_lock);
+		if (ret >= 0) {
+			c->value = ret;
+			ret = 0;
+		}
+		break;
 	/* Implementation as per C100 FIMC driver */
 	case V4L2_CID_STREAM_PAUSE:
 		fimc_hwset_stop_processing(ctrl);
@@ -648,7 +648,9 @@ static irqreturn_t fimc_irq(int irq, void *dev_id)
 	struct fimc_control *ctrl = (struct fimc_control *) dev_id;
 	struct s3c_platform_fimc *pdata;
 
-	if (ctrl->cap)
+	if (ctrl->m2m)
+		fimc_irq_m2m(ctrl);
+	else if (ctrl->cap)
 		fimc_irq_cap(ctrl);
 	else if (ctrl->out)
 		fimc_irq_out(ctrl);
@@ -1380,18 +1382,30 @@ static int fimc_release(struct file *filp)
 
 	if (ctrl->cap) {
 		cap = ctrl->cap;
-		ctrl->mem.curr = ctrl->mem.base;
 		kfree(filp->private_data);
 		filp->private_data = NULL;
 		if (pdata->hw_ver >= 0x51)
 			INIT_LIST_HEAD(&cap->outgoing_q);
-		for (i = 0; i < FIMC_CAPBUFS; i++) {
-			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 0);
-			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 1);
-			fimc_dma_free(ctrl, &ctrl->cap->bufs[i], 2);
-		}
-		kfree(ctrl->cap);
+
+		mutex_lock(&ctrl->v4l2_lock);
 		ctrl->cap = NULL;
+		if (atomic_read(&ctrl->cap_exported)) {
+			/* freed by the release of the last exported fd */
+			ctrl->cap_orphan = cap;
+			cap = NULL;
+		} else {
+			ctrl->mem.curr = ctrl->mem.base;
+		}
+		mutex_unlock(&ctrl->v4l2_lock);
+
+		if (cap) {
+			for (i = 0; i < FIMC_CAPBUFS; i++) {
+				fimc_dma_free(ctrl, &cap->bufs[i], 0);
+				fimc_dma_free(ctrl, &cap->bufs[i], 1);
+				fimc_dma_free(ctrl, &cap->bufs[i], 2);
+			}
+			kfree(cap);
+		}
 	}
 
 	/*
@@ -1746,6 +1760,9 @@ static int __devinit fimc_probe(struct platform_device *pdev)
 
 	video_set_drvdata(ctrl->vd, ctrl);
 
+	if (fimc_m2m_register(ctrl))
+		fimc_warn("%s: cannot register m2m device\n", __func__);
+
 #ifdef CONFIG_VIDEO_FIMC_RANGE_WIDE
 	ctrl->range = FIMC_RANGE_WIDE;
 #else
@@ -1801,6 +1818,7 @@ err_alloc:
 
 static int fimc_remove(struct platform_device *pdev)
 {
+	fimc_m2m_unregister(get_fimc_ctrl(pdev->id));
 	fimc_unregister_controller(pdev);
 
 	device_remove_file(&(pdev->dev), &dev_attr_log_level);
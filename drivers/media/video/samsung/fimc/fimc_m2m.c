@@ -0,0 +1,1029 @@
+/* linux/drivers/media/video/samsung/fimc/fimc_m2m.c
+ *
+ * Copyright (c) 2011 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Memory-to-memory scaler/CSC node for Samsung Camera Interface (FIMC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <media/v4l2-ioctl.h>
+#include <media/v4l2-mem2mem.h>
+#include <media/videobuf2-core.h>
+#include <media/videobuf2-cma-phys.h>
+
+#include "fimc.h"
+
+/*
+ * One v4l2-mem2mem node converts between any two formats of the output
+ * path. Every FIMC instance which is idle when the node is first opened
+ * is reserved for it, and jobs are spread over the reserved instances:
+ * the m2m core is only told a job has finished while another instance is
+ * still free, so up to one job per instance is in flight. An instance
+ * which last ran a job of the same context keeps its scaler and DMA setup
+ * and only gets the new buffer addresses.
+ */
+#define FIMC_M2M_NAME		"fimc-m2m"
+#define FIMC_M2M_NODE		13
+#define FIMC_M2M_MAX_SIZE	8192
+
+static unsigned int m2m_instances = (1 << FIMC_DEVICES) - 1;
+module_param(m2m_instances, uint, 0644);
+MODULE_PARM_DESC(m2m_instances, "mask of fimc instances used by fimc-m2m");
+
+struct fimc_m2m_fmt {
+	char	*name;
+	u32	fourcc;
+	int	depth;		/* bits per pixel */
+	int	planar;		/* bytesperline counts the Y plane only */
+};
+
+struct fimc_m2m_frame {
+	struct fimc_m2m_fmt	*fmt;
+	u32			width;
+	u32			height;
+	unsigned long		size;
+};
+
+struct fimc_m2m_ctx {
+	struct fimc_m2m_dev	*m2m;
+	struct v4l2_m2m_ctx	*m2m_ctx;
+	struct fimc_m2m_frame	src;
+	struct fimc_m2m_frame	dst;
+	struct fimc_ctx		hw;		/* for the output path helpers */
+	u32			cfg;		/* changes with every s_fmt */
+	int			nr_running;
+};
+
+struct fimc_m2m_job {
+	struct fimc_m2m_ctx	*ctx;		/* NULL while idle */
+	struct vb2_buffer	*src;		/* NULL for kernel scale jobs */
+	struct vb2_buffer	*dst;
+	dma_addr_t		src_addr;
+	dma_addr_t		dst_addr;
+	u32			cfg;		/* setup held by the registers */
+};
+
+struct fimc_m2m_dev {
+	struct fimc_control	*parent;
+	struct video_device	*vfd;
+	struct v4l2_m2m_dev	*m2m_dev;
+	void			*alloc_ctx;
+	struct mutex		lock;
+	spinlock_t		slock;
+	wait_queue_head_t	wq;
+	int			nr_open;
+	unsigned long		claimed;	/* reserved instances */
+	struct fimc_m2m_job	job[FIMC_DEVICES];
+	struct fimc_m2m_ctx	*deferred;	/* job_finish pending */
+	atomic_t		cfg_seq;
+};
+
+static struct fimc_m2m_dev *fimc_m2m;
+
+static struct fimc_m2m_fmt fimc_m2m_formats[] = {
+	{
+		.name	= "RGB565",
+		.fourcc	= V4L2_PIX_FMT_RGB565,
+		.depth	= 16,
+	}, {
+		.name	= "XRGB-8-8-8-8, 32 bpp",
+		.fourcc	= V4L2_PIX_FMT_RGB32,
+		.depth	= 32,
+	}, {
+		.name	= "YUV 4:2:2 packed, YCbYCr",
+		.fourcc	= V4L2_PIX_FMT_YUYV,
+		.depth	= 16,
+	}, {
+		.name	= "YUV 4:2:2 planar, Y/CbCr",
+		.fourcc	= V4L2_PIX_FMT_NV16,
+		.depth	= 16,
+		.planar	= 1,
+	}, {
+		.name	= "YUV 4:2:0 planar, Y/CbCr",
+		.fourcc	= V4L2_PIX_FMT_NV12,
+		.depth	= 12,
+		.planar	= 1,
+	}, {
+		.name	= "YUV 4:2:0 planar, Y/CrCb",
+		.fourcc	= V4L2_PIX_FMT_NV21,
+		.depth	= 12,
+		.planar	= 1,
+	}, {
+		.name	= "YUV 4:2:0 planar, Y/Cb/Cr",
+		.fourcc	= V4L2_PIX_FMT_YUV420,
+		.depth	= 12,
+		.planar	= 1,
+	},
+};
+
+static struct fimc_m2m_fmt *fimc_m2m_find_format(u32 fourcc)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fimc_m2m_formats); i++)
+		if (fimc_m2m_formats[i].fourcc == fourcc)
+			return &fimc_m2m_formats[i];
+
+	return NULL;
+}
+
+static void fimc_m2m_set_addr(struct fimc_buf_set *bs,
+			      struct fimc_m2m_frame *frame, dma_addr_t base)
+{
+	u32 y_size = frame->width * frame->height;
+
+	memset(bs, 0, sizeof(*bs));
+	bs->base[FIMC_ADDR_Y] = base;
+
+	switch (frame->fmt->fourcc) {
+	case V4L2_PIX_FMT_YUV420:
+		bs->base[FIMC_ADDR_CB] = base + y_size;
+		bs->base[FIMC_ADDR_CR] = base + y_size + (y_size >> 2);
+		break;
+	case V4L2_PIX_FMT_NV12:		/* fall through */
+	case V4L2_PIX_FMT_NV21:		/* fall through */
+	case V4L2_PIX_FMT_NV16:
+		bs->base[FIMC_ADDR_CB] = base + y_size;
+		break;
+	}
+}
+
+/* Called with slock held, from process or interrupt context. */
+static int fimc_m2m_start(struct fimc_control *ctrl, struct fimc_m2m_job *job)
+{
+	struct fimc_m2m_ctx *ctx = job->ctx;
+	struct fimc_buf_set src, dst;
+	int ret, i, cfg;
+
+	if (job->cfg != ctx->cfg) {
+		ret = fimc_outdev_set_ctx_param(ctrl, &ctx->hw);
+		if (ret < 0) {
+			job->cfg = 0;
+			return ret;
+		}
+		job->cfg = ctx->cfg;
+	}
+
+	fimc_m2m_set_addr(&src, &ctx->src, job->src_addr);
+	fimc_m2m_set_addr(&dst, &ctx->dst, job->dst_addr);
+
+	cfg = fimc_hwget_output_buf_sequence(ctrl);
+	for (i = 0; i < FIMC_PHYBUFS; i++) {
+		if (check_bit(cfg, i))
+			fimc_hwset_output_address(ctrl, &dst, i);
+	}
+
+	fimc_outdev_set_src_addr(ctrl, src.base);
+	ctrl->status = FIMC_STREAMON;
+
+	return fimc_outdev_start_camif(ctrl);
+}
+
+static int fimc_m2m_idle_instance(struct fimc_m2m_dev *m2m)
+{
+	int i;
+
+	for (i = 0; i < FIMC_DEVICES; i++) {
+		if (test_bit(i, &m2m->claimed) && !m2m->job[i].ctx)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Hands the buffers of a job back and frees its instance. Returns the
+ * context whose job_finish was held back for want of an idle instance,
+ * to be finished by the caller once slock is dropped.
+ */
+static struct fimc_m2m_ctx *fimc_m2m_put_job(struct fimc_m2m_dev *m2m,
+					     struct fimc_m2m_job *job,
+					     enum vb2_buffer_state state)
+{
+	struct fimc_m2m_ctx *ctx = job->ctx, *deferred;
+
+	if (job->src) {
+		job->dst->v4l2_buf.timestamp = job->src->v4l2_buf.timestamp;
+		v4l2_m2m_buf_done(job->src, state);
+		v4l2_m2m_buf_done(job->dst, state);
+	}
+
+	job->ctx = NULL;
+	if (!--ctx->nr_running)
+		wake_up(&m2m->wq);
+
+	deferred = m2m->deferred;
+	m2m->deferred = NULL;
+
+	return deferred;
+}
+
+static void fimc_m2m_device_run(void *priv)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	struct fimc_m2m_dev *m2m = ctx->m2m;
+	struct fimc_control *ctrl;
+	struct fimc_m2m_job *job;
+	struct fimc_m2m_ctx *finish = ctx;
+	unsigned long flags;
+	int id, ret;
+
+	spin_lock_irqsave(&m2m->slock, flags);
+
+	/*
+	 * job_finish is only called while an instance is idle, but a kernel
+	 * scale job may have taken it since. The context is then finished
+	 * without running and rescheduled by the next completion.
+	 */
+	id = fimc_m2m_idle_instance(m2m);
+	if (id < 0) {
+		m2m->deferred = ctx;
+		spin_unlock_irqrestore(&m2m->slock, flags);
+		return;
+	}
+
+	ctrl = get_fimc_ctrl(id);
+	job = &m2m->job[id];
+	job->ctx = ctx;
+	job->src = v4l2_m2m_src_buf_remove(ctx->m2m_ctx);
+	job->dst = v4l2_m2m_dst_buf_remove(ctx->m2m_ctx);
+	job->src_addr = vb2_cma_phys_plane_paddr(job->src, 0);
+	job->dst_addr = vb2_cma_phys_plane_paddr(job->dst, 0);
+	ctx->nr_running++;
+
+	ret = fimc_m2m_start(ctrl, job);
+	if (ret < 0) {
+		fimc_err("%s: failed to start job (%d)\n", __func__, ret);
+		fimc_m2m_put_job(m2m, job, VB2_BUF_STATE_ERROR);
+	} else if (fimc_m2m_idle_instance(m2m) < 0) {
+		m2m->deferred = ctx;
+		finish = NULL;
+	}
+
+	spin_unlock_irqrestore(&m2m->slock, flags);
+
+	if (finish)
+		v4l2_m2m_job_finish(m2m->m2m_dev, finish->m2m_ctx);
+}
+
+void fimc_irq_m2m(struct fimc_control *ctrl)
+{
+	struct fimc_m2m_dev *m2m = ctrl->m2m;
+	struct fimc_m2m_job *job = &m2m->job[ctrl->id];
+	struct fimc_m2m_ctx *deferred = NULL;
+	unsigned long flags;
+
+	fimc_hwset_clear_irq(ctrl);
+
+	spin_lock_irqsave(&m2m->slock, flags);
+	if (job->ctx) {
+		ctrl->status = FIMC_STREAMON_IDLE;
+		deferred = fimc_m2m_put_job(m2m, job, VB2_BUF_STATE_DONE);
+	}
+	spin_unlock_irqrestore(&m2m->slock, flags);
+
+	if (deferred)
+		v4l2_m2m_job_finish(m2m->m2m_dev, deferred->m2m_ctx);
+}
+
+/* Waits for the jobs of ctx; instances which do not finish are stopped. */
+static int fimc_m2m_drain(struct fimc_m2m_ctx *ctx)
+{
+	struct fimc_m2m_dev *m2m = ctx->m2m;
+	struct fimc_m2m_ctx *deferred = NULL;
+	struct fimc_control *ctrl;
+	unsigned long flags;
+	int i;
+
+	if (wait_event_timeout(m2m->wq, !ctx->nr_running, FIMC_ONESHOT_TIMEOUT))
+		return 0;
+
+	spin_lock_irqsave(&m2m->slock, flags);
+	for (i = 0; i < FIMC_DEVICES; i++) {
+		if (m2m->job[i].ctx != ctx)
+			continue;
+
+		ctrl = get_fimc_ctrl(i);
+		fimc_err("%s: job timed out\n", __func__);
+		fimc_hwset_stop_input_dma(ctrl);
+		fimc_hwset_disable_autoload(ctrl);
+		fimc_hwset_stop_scaler(ctrl);
+		fimc_hwset_disable_capture(ctrl);
+		ctrl->status = FIMC_STREAMOFF;
+
+		m2m->job[i].cfg = 0;
+		deferred = fimc_m2m_put_job(m2m, &m2m->job[i],
+					VB2_BUF_STATE_ERROR) ? : deferred;
+	}
+	spin_unlock_irqrestore(&m2m->slock, flags);
+
+	if (deferred)
+		v4l2_m2m_job_finish(m2m->m2m_dev, deferred->m2m_ctx);
+
+	return -ETIMEDOUT;
+}
+
+static void fimc_m2m_job_abort(void *priv)
+{
+	fimc_m2m_drain(priv);
+}
+
+static struct v4l2_m2m_ops fimc_m2m_ops = {
+	.device_run	= fimc_m2m_device_run,
+	.job_abort	= fimc_m2m_job_abort,
+};
+
+static int fimc_m2m_queue_setup(struct vb2_queue *vq, unsigned int *num_buffers,
+				unsigned int *num_planes, unsigned long sizes[],
+				void *allocators[])
+{
+	struct fimc_m2m_ctx *ctx = vb2_get_drv_priv(vq);
+	struct fimc_m2m_frame *frame;
+
+	if (vq->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
+		frame = &ctx->src;
+	else
+		frame = &ctx->dst;
+
+	*num_planes = 1;
+	sizes[0] = frame->size;
+	allocators[0] = ctx->m2m->alloc_ctx;
+
+	return 0;
+}
+
+static int fimc_m2m_buf_prepare(struct vb2_buffer *vb)
+{
+	struct fimc_m2m_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+	struct fimc_m2m_frame *frame;
+
+	if (vb->vb2_queue->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
+		frame = &ctx->src;
+	else
+		frame = &ctx->dst;
+
+	if (vb2_plane_size(vb, 0) < frame->size)
+		return -EINVAL;
+
+	vb2_set_plane_payload(vb, 0, frame->size);
+
+	return 0;
+}
+
+static void fimc_m2m_buf_queue(struct vb2_buffer *vb)
+{
+	struct fimc_m2m_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+
+	if (ctx->m2m_ctx)
+		v4l2_m2m_buf_queue(ctx->m2m_ctx, vb);
+}
+
+static void fimc_m2m_unlock(struct vb2_queue *vq)
+{
+	struct fimc_m2m_ctx *ctx = vb2_get_drv_priv(vq);
+	mutex_unlock(&ctx->m2m->lock);
+}
+
+static void fimc_m2m_lock(struct vb2_queue *vq)
+{
+	struct fimc_m2m_ctx *ctx = vb2_get_drv_priv(vq);
+	mutex_lock(&ctx->m2m->lock);
+}
+
+static int fimc_m2m_stop_streaming(struct vb2_queue *vq)
+{
+	struct fimc_m2m_ctx *ctx = vb2_get_drv_priv(vq);
+
+	fimc_m2m_drain(ctx);
+
+	return 0;
+}
+
+static struct vb2_ops fimc_m2m_vb2_qops = {
+	.queue_setup		= fimc_m2m_queue_setup,
+	.buf_prepare		= fimc_m2m_buf_prepare,
+	.buf_queue		= fimc_m2m_buf_queue,
+	.wait_prepare		= fimc_m2m_unlock,
+	.wait_finish		= fimc_m2m_lock,
+	.stop_streaming		= fimc_m2m_stop_streaming,
+};
+
+static int fimc_m2m_queue_init(void *priv, struct vb2_queue *src_vq,
+			       struct vb2_queue *dst_vq)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	int ret;
+
+	memset(src_vq, 0, sizeof(*src_vq));
+	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	src_vq->io_modes = VB2_MMAP | VB2_USERPTR;
+	src_vq->drv_priv = ctx;
+	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	src_vq->ops = &fimc_m2m_vb2_qops;
+	src_vq->mem_ops = &vb2_cma_phys_memops;
+
+	ret = vb2_queue_init(src_vq);
+	if (ret)
+		return ret;
+
+	memset(dst_vq, 0, sizeof(*dst_vq));
+	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	dst_vq->io_modes = VB2_MMAP | VB2_USERPTR;
+	dst_vq->drv_priv = ctx;
+	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	dst_vq->ops = &fimc_m2m_vb2_qops;
+	dst_vq->mem_ops = &vb2_cma_phys_memops;
+
+	return vb2_queue_init(dst_vq);
+}
+
+/* Rebuilds the output path context from the two formats. */
+static void fimc_m2m_update_hw(struct fimc_m2m_ctx *ctx)
+{
+	struct fimc_ctx *hw = &ctx->hw;
+
+	memset(hw, 0, sizeof(*hw));
+	hw->overlay.mode = FIMC_OVLY_NONE_SINGLE_BUF;
+	hw->status = FIMC_STREAMOFF;
+
+	hw->pix.width = ctx->src.width;
+	hw->pix.height = ctx->src.height;
+	hw->pix.pixelformat = ctx->src.fmt->fourcc;
+	hw->pix.field = V4L2_FIELD_NONE;
+	hw->crop.width = ctx->src.width;
+	hw->crop.height = ctx->src.height;
+
+	hw->fbuf.fmt.width = ctx->dst.width;
+	hw->fbuf.fmt.height = ctx->dst.height;
+	hw->fbuf.fmt.pixelformat = ctx->dst.fmt->fourcc;
+	hw->win.w.width = ctx->dst.width;
+	hw->win.w.height = ctx->dst.height;
+
+	ctx->cfg = atomic_inc_return(&ctx->m2m->cfg_seq);
+}
+
+static int fimc_m2m_querycap(struct file *file, void *priv,
+			     struct v4l2_capability *cap)
+{
+	strncpy(cap->driver, FIMC_M2M_NAME, sizeof(cap->driver) - 1);
+	strncpy(cap->card, FIMC_M2M_NAME, sizeof(cap->card) - 1);
+	cap->bus_info[0] = 0;
+	cap->version = KERNEL_VERSION(1, 0, 0);
+	cap->capabilities = V4L2_CAP_STREAMING |
+		V4L2_CAP_VIDEO_CAPTURE_MPLANE | V4L2_CAP_VIDEO_OUTPUT_MPLANE;
+
+	return 0;
+}
+
+static int fimc_m2m_enum_fmt(struct file *file, void *priv,
+			     struct v4l2_fmtdesc *f)
+{
+	struct fimc_m2m_fmt *fmt;
+
+	if (f->index >= ARRAY_SIZE(fimc_m2m_formats))
+		return -EINVAL;
+
+	fmt = &fimc_m2m_formats[f->index];
+	strncpy(f->description, fmt->name, sizeof(f->description) - 1);
+	f->pixelformat = fmt->fourcc;
+
+	return 0;
+}
+
+static int fimc_m2m_g_fmt(struct file *file, void *priv,
+			  struct v4l2_format *f)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	struct v4l2_pix_format_mplane *pixm = &f->fmt.pix_mp;
+	struct fimc_m2m_frame *frame;
+
+	if (f->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
+		frame = &ctx->src;
+	else
+		frame = &ctx->dst;
+
+	pixm->width = frame->width;
+	pixm->height = frame->height;
+	pixm->pixelformat = frame->fmt->fourcc;
+	pixm->field = V4L2_FIELD_NONE;
+	pixm->num_planes = 1;
+	pixm->plane_fmt[0].sizeimage = frame->size;
+	pixm->plane_fmt[0].bytesperline = frame->fmt->planar ?
+		frame->width : (frame->width * frame->fmt->depth) >> 3;
+
+	return 0;
+}
+
+static int fimc_m2m_try_fmt(struct file *file, void *priv,
+			    struct v4l2_format *f)
+{
+	struct v4l2_pix_format_mplane *pixm = &f->fmt.pix_mp;
+	struct fimc_m2m_fmt *fmt;
+
+	fmt = fimc_m2m_find_format(pixm->pixelformat);
+	if (!fmt)
+		return -EINVAL;
+
+	if (pixm->field == V4L2_FIELD_ANY)
+		pixm->field = V4L2_FIELD_NONE;
+	else if (pixm->field != V4L2_FIELD_NONE)
+		return -EINVAL;
+
+	v4l_bound_align_image(&pixm->width, 16, FIMC_M2M_MAX_SIZE, 4,
+			      &pixm->height, 8, FIMC_M2M_MAX_SIZE, 1, 0);
+
+	pixm->num_planes = 1;
+	pixm->plane_fmt[0].bytesperline = fmt->planar ?
+		pixm->width : (pixm->width * fmt->depth) >> 3;
+	pixm->plane_fmt[0].sizeimage =
+		(pixm->width * pixm->height * fmt->depth) >> 3;
+
+	return 0;
+}
+
+static int fimc_m2m_s_fmt(struct file *file, void *priv,
+			  struct v4l2_format *f)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	struct v4l2_pix_format_mplane *pixm = &f->fmt.pix_mp;
+	struct fimc_m2m_frame *frame;
+	struct vb2_queue *vq;
+	int ret;
+
+	ret = fimc_m2m_try_fmt(file, priv, f);
+	if (ret)
+		return ret;
+
+	vq = v4l2_m2m_get_vq(ctx->m2m_ctx, f->type);
+	if (!vq)
+		return -EINVAL;
+
+	if (vb2_is_busy(vq)) {
+		v4l2_err(ctx->m2m->vfd->v4l2_dev, "queue (%d) busy\n", f->type);
+		return -EBUSY;
+	}
+
+	if (f->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
+		frame = &ctx->src;
+	else
+		frame = &ctx->dst;
+
+	frame->fmt = fimc_m2m_find_format(pixm->pixelformat);
+	frame->width = pixm->width;
+	frame->height = pixm->height;
+	frame->size = pixm->plane_fmt[0].sizeimage;
+
+	fimc_m2m_update_hw(ctx);
+
+	return 0;
+}
+
+static int fimc_m2m_reqbufs(struct file *file, void *priv,
+			    struct v4l2_requestbuffers *reqbufs)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	return v4l2_m2m_reqbufs(file, ctx->m2m_ctx, reqbufs);
+}
+
+static int fimc_m2m_querybuf(struct file *file, void *priv,
+			     struct v4l2_buffer *buf)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	return v4l2_m2m_querybuf(file, ctx->m2m_ctx, buf);
+}
+
+static int fimc_m2m_qbuf(struct file *file, void *priv,
+			 struct v4l2_buffer *buf)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	return v4l2_m2m_qbuf(file, ctx->m2m_ctx, buf);
+}
+
+static int fimc_m2m_dqbuf(struct file *file, void *priv,
+			  struct v4l2_buffer *buf)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	return v4l2_m2m_dqbuf(file, ctx->m2m_ctx, buf);
+}
+
+static int fimc_m2m_streamon(struct file *file, void *priv,
+			     enum v4l2_buf_type type)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	return v4l2_m2m_streamon(file, ctx->m2m_ctx, type);
+}
+
+static int fimc_m2m_streamoff(struct file *file, void *priv,
+			      enum v4l2_buf_type type)
+{
+	struct fimc_m2m_ctx *ctx = priv;
+	return v4l2_m2m_streamoff(file, ctx->m2m_ctx, type);
+}
+
+static const struct v4l2_ioctl_ops fimc_m2m_ioctl_ops = {
+	.vidioc_querycap		= fimc_m2m_querycap,
+
+	.vidioc_enum_fmt_vid_cap_mplane	= fimc_m2m_enum_fmt,
+	.vidioc_enum_fmt_vid_out_mplane	= fimc_m2m_enum_fmt,
+
+	.vidioc_g_fmt_vid_cap_mplane	= fimc_m2m_g_fmt,
+	.vidioc_g_fmt_vid_out_mplane	= fimc_m2m_g_fmt,
+
+	.vidioc_try_fmt_vid_cap_mplane	= fimc_m2m_try_fmt,
+	.vidioc_try_fmt_vid_out_mplane	= fimc_m2m_try_fmt,
+	.vidioc_s_fmt_vid_cap_mplane	= fimc_m2m_s_fmt,
+	.vidioc_s_fmt_vid_out_mplane	= fimc_m2m_s_fmt,
+
+	.vidioc_reqbufs			= fimc_m2m_reqbufs,
+	.vidioc_querybuf		= fimc_m2m_querybuf,
+	.vidioc_qbuf			= fimc_m2m_qbuf,
+	.vidioc_dqbuf			= fimc_m2m_dqbuf,
+	.vidioc_streamon		= fimc_m2m_streamon,
+	.vidioc_streamoff		= fimc_m2m_streamoff,
+};
+
+static void fimc_m2m_power(struct fimc_control *ctrl, int on)
+{
+#if (defined(CONFIG_EXYNOS_DEV_PD) && defined(CONFIG_PM_RUNTIME))
+	if (on)
+		pm_runtime_get_sync(ctrl->dev);
+	else
+		pm_runtime_put_sync(ctrl->dev);
+#else
+	struct s3c_platform_fimc *pdata = to_fimc_plat(ctrl->dev);
+
+	if (on && pdata->clk_on)
+		pdata->clk_on(to_platform_device(ctrl->dev), &ctrl->clk);
+	else if (!on && pdata->clk_off)
+		pdata->clk_off(to_platform_device(ctrl->dev), &ctrl->clk);
+#endif
+}
+
+/*
+ * Reserves every idle instance in m2m_instances which has no camera
+ * attached. An in_use count above any open limit keeps fimc_open() out
+ * until the last m2m context is closed.
+ */
+static int fimc_m2m_claim(struct fimc_m2m_dev *m2m)
+{
+	struct s3c_platform_fimc *pdata;
+	struct fimc_control *ctrl;
+	int i;
+
+	for (i = 0; i < FIMC_DEVICES; i++) {
+		ctrl = get_fimc_ctrl(i);
+		if (!(m2m_instances & (1 << i)) || !ctrl->dev)
+			continue;
+
+		pdata = to_fimc_plat(ctrl->dev);
+		if (pdata->camera[0])
+			continue;
+
+		mutex_lock(&ctrl->lock);
+		if (atomic_read(&ctrl->in_use) == 0) {
+			atomic_set(&ctrl->in_use, FIMC_MAX_CTXS + 1);
+			fimc_m2m_power(ctrl, 1);
+			ctrl->status = FIMC_STREAMOFF;
+			m2m->job[i].cfg = 0;
+			ctrl->m2m = m2m;
+			set_bit(i, &m2m->claimed);
+		}
+		mutex_unlock(&ctrl->lock);
+	}
+
+	return m2m->claimed ? 0 : -EBUSY;
+}
+
+static void fimc_m2m_unclaim(struct fimc_m2m_dev *m2m)
+{
+	struct fimc_control *ctrl;
+	int i;
+
+	for (i = 0; i < FIMC_DEVICES; i++) {
+		if (!test_and_clear_bit(i, &m2m->claimed))
+			continue;
+
+		ctrl = get_fimc_ctrl(i);
+		mutex_lock(&ctrl->lock);
+		ctrl->m2m = NULL;
+		fimc_m2m_power(ctrl, 0);
+		atomic_set(&ctrl->in_use, 0);
+		mutex_unlock(&ctrl->lock);
+	}
+}
+
+static void fimc_m2m_put(struct fimc_m2m_dev *m2m)
+{
+	mutex_lock(&m2m->lock);
+	if (!--m2m->nr_open)
+		fimc_m2m_unclaim(m2m);
+	mutex_unlock(&m2m->lock);
+}
+
+static void fimc_m2m_set_default(struct fimc_m2m_ctx *ctx)
+{
+	struct fimc_m2m_frame *frame[] = { &ctx->src, &ctx->dst };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(frame); i++) {
+		frame[i]->fmt = &fimc_m2m_formats[0];
+		frame[i]->width = 640;
+		frame[i]->height = 480;
+		frame[i]->size = (640 * 480 * frame[i]->fmt->depth) >> 3;
+	}
+
+	fimc_m2m_update_hw(ctx);
+}
+
+static int fimc_m2m_open(struct file *file)
+{
+	struct fimc_m2m_dev *m2m = video_drvdata(file);
+	struct fimc_m2m_ctx *ctx;
+	int ret = 0;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	mutex_lock(&m2m->lock);
+	if (!m2m->nr_open)
+		ret = fimc_m2m_claim(m2m);
+	if (!ret)
+		m2m->nr_open++;
+	mutex_unlock(&m2m->lock);
+
+	if (ret) {
+		kfree(ctx);
+		return ret;
+	}
+
+	ctx->m2m = m2m;
+	fimc_m2m_set_default(ctx);
+	file->private_data = ctx;
+
+	ctx->m2m_ctx = v4l2_m2m_ctx_init(m2m->m2m_dev, ctx,
+					 fimc_m2m_queue_init);
+	if (IS_ERR(ctx->m2m_ctx)) {
+		ret = PTR_ERR(ctx->m2m_ctx);
+		goto err_ctx;
+	}
+
+	return 0;
+
+err_ctx:
+	fimc_m2m_put(m2m);
+	kfree(ctx);
+
+	return ret;
+}
+
+static int fimc_m2m_release(struct file *file)
+{
+	struct fimc_m2m_ctx *ctx = file->private_data;
+	struct fimc_m2m_dev *m2m = ctx->m2m;
+
+	mutex_lock(&m2m->lock);
+	v4l2_m2m_ctx_release(ctx->m2m_ctx);
+	if (!--m2m->nr_open)
+		fimc_m2m_unclaim(m2m);
+	mutex_unlock(&m2m->lock);
+
+	kfree(ctx);
+
+	return 0;
+}
+
+static unsigned int fimc_m2m_poll(struct file *file,
+				  struct poll_table_struct *wait)
+{
+	struct fimc_m2m_ctx *ctx = file->private_data;
+
+	return v4l2_m2m_poll(file, ctx->m2m_ctx, wait);
+}
+
+static int fimc_m2m_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fimc_m2m_ctx *ctx = file->private_data;
+
+	return v4l2_m2m_mmap(file, ctx->m2m_ctx, vma);
+}
+
+static const struct v4l2_file_operations fimc_m2m_fops = {
+	.owner		= THIS_MODULE,
+	.open		= fimc_m2m_open,
+	.release	= fimc_m2m_release,
+	.poll		= fimc_m2m_poll,
+	.unlocked_ioctl	= video_ioctl2,
+	.mmap		= fimc_m2m_mmap,
+};
+
+static struct video_device fimc_m2m_videodev = {
+	.name		= FIMC_M2M_NAME,
+	.fops		= &fimc_m2m_fops,
+	.ioctl_ops	= &fimc_m2m_ioctl_ops,
+	.minor		= FIMC_M2M_NODE,
+	.release	= video_device_release,
+};
+
+/*
+ * Starts a one-shot scale of physically contiguous buffers for another
+ * driver, e.g. the thumbnail of a JPEG encode, on an idle instance. The
+ * request holds the instances claimed like an open context does until
+ * fimc_m2m_scale_wait() returns.
+ */
+int fimc_m2m_scale_start(struct fimc_scale_req *req)
+{
+	struct fimc_m2m_dev *m2m = fimc_m2m;
+	struct fimc_m2m_ctx *ctx, *deferred = NULL;
+	struct fimc_control *ctrl;
+	struct fimc_m2m_job *job;
+	unsigned long flags;
+	int id, ret = 0;
+
+	if (!m2m)
+		return -ENODEV;
+
+	if (!req->src_width || !req->src_height ||
+			!req->dst_width || !req->dst_height ||
+			req->src_width > FIMC_M2M_MAX_SIZE ||
+			req->src_height > FIMC_M2M_MAX_SIZE ||
+			req->dst_width > FIMC_M2M_MAX_SIZE ||
+			req->dst_height > FIMC_M2M_MAX_SIZE)
+		return -EINVAL;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->m2m = m2m;
+	ctx->src.fmt = fimc_m2m_find_format(req->fourcc);
+	if (!ctx->src.fmt) {
+		ret = -EINVAL;
+		goto err_fmt;
+	}
+
+	ctx->dst.fmt = ctx->src.fmt;
+	ctx->src.width = req->src_width;
+	ctx->src.height = req->src_height;
+	ctx->dst.width = req->dst_width;
+	ctx->dst.height = req->dst_height;
+	fimc_m2m_update_hw(ctx);
+
+	mutex_lock(&m2m->lock);
+	if (!m2m->nr_open)
+		ret = fimc_m2m_claim(m2m);
+	if (!ret)
+		m2m->nr_open++;
+	mutex_unlock(&m2m->lock);
+
+	if (ret)
+		goto err_fmt;
+
+	spin_lock_irqsave(&m2m->slock, flags);
+	id = fimc_m2m_idle_instance(m2m);
+	if (id < 0) {
+		ret = -EBUSY;
+	} else {
+		ctrl = get_fimc_ctrl(id);
+		job = &m2m->job[id];
+		job->ctx = ctx;
+		job->src = NULL;
+		job->dst = NULL;
+		job->src_addr = req->src;
+		job->dst_addr = req->dst;
+		ctx->nr_running++;
+
+		ret = fimc_m2m_start(ctrl, job);
+		if (ret < 0) {
+			fimc_err("%s: failed to start job (%d)\n", __func__, ret);
+			deferred = fimc_m2m_put_job(m2m, job,
+						VB2_BUF_STATE_ERROR);
+		}
+	}
+	spin_unlock_irqrestore(&m2m->slock, flags);
+
+	if (deferred)
+		v4l2_m2m_job_finish(m2m->m2m_dev, deferred->m2m_ctx);
+
+	if (ret < 0)
+		goto err_start;
+
+	req->priv = ctx;
+
+	return 0;
+
+err_start:
+	fimc_m2m_put(m2m);
+err_fmt:
+	kfree(ctx);
+
+	return ret;
+}
+EXPORT_SYMBOL(fimc_m2m_scale_start);
+
+int fimc_m2m_scale_wait(struct fimc_scale_req *req)
+{
+	struct fimc_m2m_ctx *ctx = req->priv;
+	struct fimc_m2m_dev *m2m;
+	int ret;
+
+	if (!ctx)
+		return -EINVAL;
+
+	m2m = ctx->m2m;
+	ret = fimc_m2m_drain(ctx);
+	fimc_m2m_put(m2m);
+
+	kfree(ctx);
+	req->priv = NULL;
+
+	return ret;
+}
+EXPORT_SYMBOL(fimc_m2m_scale_wait);
+
+int fimc_m2m_register(struct fimc_control *ctrl)
+{
+	struct fimc_m2m_dev *m2m;
+	struct video_device *vfd;
+	int ret;
+
+	if (fimc_m2m)
+		return 0;
+
+	m2m = kzalloc(sizeof(*m2m), GFP_KERNEL);
+	if (!m2m)
+		return -ENOMEM;
+
+	mutex_init(&m2m->lock);
+	spin_lock_init(&m2m->slock);
+	init_waitqueue_head(&m2m->wq);
+	m2m->parent = ctrl;
+
+	m2m->alloc_ctx = vb2_cma_phys_init(ctrl->dev, NULL, 0, false);
+	if (IS_ERR(m2m->alloc_ctx)) {
+		ret = PTR_ERR(m2m->alloc_ctx);
+		goto err_alloc_ctx;
+	}
+
+	m2m->m2m_dev = v4l2_m2m_init(&fimc_m2m_ops);
+	if (IS_ERR(m2m->m2m_dev)) {
+		ret = PTR_ERR(m2m->m2m_dev);
+		goto err_m2m_init;
+	}
+
+	vfd = video_device_alloc();
+	if (!vfd) {
+		ret = -ENOMEM;
+		goto err_vd_alloc;
+	}
+
+	*vfd = fimc_m2m_videodev;
+	vfd->v4l2_dev = &ctrl->v4l2_dev;
+	vfd->lock = &m2m->lock;
+	ret = video_register_device(vfd, VFL_TYPE_GRABBER, FIMC_M2M_NODE);
+	if (ret) {
+		video_device_release(vfd);
+		goto err_vd_alloc;
+	}
+
+	video_set_drvdata(vfd, m2m);
+	m2m->vfd = vfd;
+	fimc_m2m = m2m;
+
+	printk(KERN_INFO "FIMC m2m registered to /dev/video%d\n", vfd->num);
+
+	return 0;
+
+err_vd_alloc:
+	v4l2_m2m_release(m2m->m2m_dev);
+err_m2m_init:
+	vb2_cma_phys_cleanup(m2m->alloc_ctx);
+err_alloc_ctx:
+	kfree(m2m);
+
+	return ret;
+}
+
+void fimc_m2m_unregister(struct fimc_control *ctrl)
+{
+	struct fimc_m2m_dev *m2m = fimc_m2m;
+
+	if (!m2m || m2m->parent != ctrl)
+		return;
+
+	video_unregister_device(m2m->vfd);
+	v4l2_m2m_release(m2m->m2m_dev);
+	vb2_cma_phys_cleanup(m2m->alloc_ctx);
+	kfree(m2m);
+	fimc_m2m = NULL;
+}
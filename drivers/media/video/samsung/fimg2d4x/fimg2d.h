@@ -21,10 +21,12 @@
 #include <linux/workqueue.h>
 #include <linux/platform_device.h>
 #include <linux/atomic.h>
+#include <linux/ktime.h>
 #include <linux/dma-mapping.h>
 #include <asm/cacheflush.h>
 
 #define FIMG2D_MINOR			(240)
+#define FIMG2D_STARVE_MSEC		(100)
 #define to_fimg2d_plat(d)		(to_platform_device(d)->dev.platform_data)
 
 #ifdef CONFIG_VIDEO_FIMG2D_DEBUG
@@ -40,6 +42,9 @@
 #define FIMG2D_BITBLT_BLIT	_IOWR(FIMG2D_IOCTL_MAGIC, 0, struct fimg2d_blit)
 #define FIMG2D_BITBLT_SYNC	_IOW(FIMG2D_IOCTL_MAGIC, 1, int)
 #define FIMG2D_BITBLT_VERSION	_IOR(FIMG2D_IOCTL_MAGIC, 2, struct fimg2d_version)
+#define FIMG2D_BITBLT_FENCE	_IOR(FIMG2D_IOCTL_MAGIC, 3, unsigned int)
+#define FIMG2D_BITBLT_WAIT	_IOW(FIMG2D_IOCTL_MAGIC, 4, unsigned int)
+#define FIMG2D_BITBLT_PRIORITY	_IOW(FIMG2D_IOCTL_MAGIC, 5, int)
 
 struct fimg2d_version {
 	unsigned int hw;
@@ -50,12 +55,33 @@ struct fimg2d_version {
  * @BLIT_SYNC: sync mode, to wait for blit done irq
  * @BLIT_ASYNC: async mode, not to wait for blit done irq
  *
+ * In async mode the blit ioctl returns as soon as the command is queued.
+ * FIMG2D_BITBLT_FENCE returns the fence number of the last queued command,
+ * FIMG2D_BITBLT_WAIT blocks until the given fence has been signaled and
+ * fails if a command up to it could not be blitted, and poll() reports
+ * POLLIN when every queued command of the context is done.
  */
 enum blit_sync {
 	BLIT_SYNC,
 	BLIT_ASYNC,
 };
 
+/**
+ * @FIMG2D_PRIO_LOW: background context, runs when nothing else is queued
+ * @FIMG2D_PRIO_NORMAL: default priority of a new context
+ * @FIMG2D_PRIO_HIGH: compositor context, requires CAP_SYS_NICE
+ *
+ * Contexts of the same priority are served round-robin, one command at
+ * a time. A command that has waited longer than FIMG2D_STARVE_MSEC is
+ * served regardless of its context priority.
+ */
+enum fimg2d_priority {
+	FIMG2D_PRIO_LOW,
+	FIMG2D_PRIO_NORMAL,
+	FIMG2D_PRIO_HIGH,
+	FIMG2D_PRIO_END,
+};
+
 /**
  * @ADDR_PHYS: physical address
  * @ADDR_USER: user virtual address (physically Non-contiguous)
@@ -422,11 +448,37 @@ struct fimg2d_perf {
  * @pgd: base address of arm mmu pagetable
  * @ncmd: request count in blit command queue
  * @wait_q: conext wait queue head
+ * @fence_seq: fence number of the last queued command
+ * @fence_done: fence number of the last completed command
+ * @err: error of a failed command not reported by FIMG2D_BITBLT_WAIT yet
+ * @fence_err: fence number of that command
+ * @pid: tgid of the process which opened the context
+ * @priority: scheduling priority, see enum fimg2d_priority
+ * @cmd_q: blit commands queued by this context
+ * @node: list head in fimg2d_control.ctx_q while commands are pending
+ * @list: list head in fimg2d_control.ctx_list
+ * @max_depth: high water mark of ncmd
+ * @nr_blits: number of commands dispatched to hardware
+ * @wait_total: sum of queueing delays in usec
+ * @wait_max: worst queueing delay in usec
 */
 struct fimg2d_context {
 	struct mm_struct *mm;
 	atomic_t ncmd;
 	wait_queue_head_t wait_q;
+	unsigned int fence_seq;
+	atomic_t fence_done;
+	int err;
+	unsigned int fence_err;
+	pid_t pid;
+	enum fimg2d_priority priority;
+	struct list_head cmd_q;
+	struct list_head node;
+	struct list_head list;
+	unsigned int max_depth;
+	unsigned long nr_blits;
+	u64 wait_total;
+	unsigned long wait_max;
 	struct fimg2d_perf perf[MAX_PERF_DESCS];
 };
 
@@ -442,15 +494,19 @@ struct fimg2d_context {
  *         * tmp image must be the same to dst except memory address
  * @seq_no: user debugging info.
  *          for example, user can set sequence number or pid.
+ * @fence: per-context completion fence number
+ * @queued: time when the command was queued
  * @dma_all: total dma size of src, msk, dst
  * @dma: array of dma info for each src, msk, tmp and dst
  * @ctx: context is created when user open fimg2d device.
- * @node: list head of blit command queue
+ * @node: list head of context command queue
  */
 struct fimg2d_bltcmd {
 	enum blit_op op;
 	enum blit_sync sync;
 	unsigned int seq_no;
+	unsigned int fence;
+	ktime_t queued;
 	size_t dma_all;
 	struct fimg2d_param param;
 	struct fimg2d_image image[MAX_IMAGES];
@@ -471,8 +527,12 @@ struct fimg2d_bltcmd {
  * @busy: 1 if hardware is running
  * @bltlock: spinlock for blit
  * @wait_q: blit wait queue head
- * @cmd_q: blit command queue
+ * @ctx_q: contexts which have pending blit commands
+ * @ctx_list: all open contexts
+ * @curr: command being processed by hardware
  * @workqueue: workqueue_struct for kfimg2dd
+ * @debugfs: per-context scheduling statistics
+ * @sysmmu_pgd: page table the System MMU is enabled with, 0 if disabled
 */
 struct fimg2d_control {
 	atomic_t suspended;
@@ -490,8 +550,12 @@ struct fimg2d_control {
 	atomic_t active;
 	spinlock_t bltlock;
 	wait_queue_head_t wait_q;
-	struct list_head cmd_q;
+	struct list_head ctx_q;
+	struct list_head ctx_list;
+	struct fimg2d_bltcmd *curr;
 	struct workqueue_struct *work_q;
+	struct dentry *debugfs;
+	unsigned long sysmmu_pgd;
 
 	void (*blit)(struct fimg2d_control *info);
 	int (*configure)(struct fimg2d_control *info,
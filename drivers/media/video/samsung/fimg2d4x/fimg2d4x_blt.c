@@ -47,12 +47,78 @@ static void fimg2d4x_pre_bitblt(struct fimg2d_control *info, struct fimg2d_bltcm
 	/* TODO */
 }
 
+static void fimg2d4x_sysmmu_prefetch(struct fimg2d_control *info,
+				     struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_dma *src = &cmd->dma[ISRC];
+	struct fimg2d_dma *dst = &cmd->dma[IDST];
+
+	if (dst->size < PAGE_SIZE)
+		return;
+
+	if (cmd->image[ISRC].addr.type != ADDR_NONE &&
+	    cmd->image[ISRC].addr.type != ADDR_PHYS && src->size >= PAGE_SIZE)
+		s5p_sysmmu_set_prefbuf(info->dev, src->addr, src->size,
+					dst->addr, dst->size);
+	else
+		s5p_sysmmu_set_prefbuf(info->dev, dst->addr, dst->size, 0, 0);
+}
+
+/*
+ * The System MMU stays enabled from one command to the next while they
+ * share a page table, and is disabled when the queue drains. The mm may
+ * have changed since the previous command, so the TLB entries of the areas
+ * this command accesses are flushed instead of the whole TLB.
+ */
+static void fimg2d4x_sysmmu_enable(struct fimg2d_control *info,
+				   struct fimg2d_bltcmd *cmd, unsigned long pgd)
+{
+	int i;
+
+	if (!info->sysmmu_pgd) {
+		s5p_sysmmu_enable(info->dev, pgd);
+		fimg2d_debug("sysmmu enable: pgd 0x%lx\n", pgd);
+	} else if (info->sysmmu_pgd != pgd) {
+		s5p_sysmmu_set_tablebase_pgd(info->dev, pgd);
+		fimg2d_debug("sysmmu pgd 0x%lx\n", pgd);
+	} else {
+		for (i = 0; i < MAX_IMAGES; i++) {
+			if (cmd->image[i].addr.type == ADDR_NONE)
+				continue;
+
+			/* the 2nd plane has no dma area of its own */
+			if (cmd->image[i].plane2.type != ADDR_NONE) {
+				s5p_sysmmu_tlb_invalidate(info->dev);
+				break;
+			}
+
+			s5p_sysmmu_tlb_invalidate_range(info->dev,
+					cmd->dma[i].addr, cmd->dma[i].size);
+		}
+	}
+
+	info->sysmmu_pgd = pgd;
+
+	fimg2d4x_sysmmu_prefetch(info, cmd);
+}
+
+static void fimg2d4x_sysmmu_disable(struct fimg2d_control *info)
+{
+	if (!info->sysmmu_pgd)
+		return;
+
+	s5p_sysmmu_disable(info->dev);
+	info->sysmmu_pgd = 0;
+	fimg2d_debug("sysmmu disable\n");
+}
+
 void fimg2d4x_bitblt(struct fimg2d_control *info)
 {
 	struct fimg2d_context *ctx;
 	struct fimg2d_bltcmd *cmd;
+	struct mm_struct *mm;
 	unsigned long *pgd;
-	int ret;
+	int ret, err;
 
 	fimg2d_debug("enter blitter\n");
 
@@ -64,22 +130,29 @@ void fimg2d4x_bitblt(struct fimg2d_control *info)
 
 	while ((cmd = fimg2d_get_first_command(info))) {
 		ctx = cmd->ctx;
+		err = 0;
 		if (info->err) {
 			printk(KERN_ERR "[%s] device error\n", __func__);
+			err = -EIO;
 			goto blitend;
 		}
 
 		atomic_set(&info->busy, 1);
 
 		ret = info->configure(info, cmd);
+		if (ret < 0)
+			err = ret;
 		if (ret)
 			goto blitend;
 
 		if (cmd->image[IDST].addr.type != ADDR_PHYS) {
 			pgd = (unsigned long *)ctx->mm->pgd;
-			s5p_sysmmu_enable(info->dev, (unsigned long)virt_to_phys(pgd));
-			fimg2d_debug("sysmmu enable: pgd %p ctx %p seq_no(%u)\n",
+			fimg2d4x_sysmmu_enable(info, cmd,
+					(unsigned long)virt_to_phys(pgd));
+			fimg2d_debug("sysmmu: pgd %p ctx %p seq_no(%u)\n",
 					pgd, ctx, cmd->seq_no);
+		} else {
+			fimg2d4x_sysmmu_disable(info);
 		}
 
 		fimg2d4x_pre_bitblt(info, cmd);
@@ -94,22 +167,28 @@ void fimg2d4x_bitblt(struct fimg2d_control *info)
 #ifdef PERF_PROFILE
 		perf_end(cmd->ctx, PERF_BLIT);
 #endif
-		if (cmd->image[IDST].addr.type != ADDR_PHYS) {
-			s5p_sysmmu_disable(info->dev);
-			fimg2d_debug("sysmmu disable\n");
-		}
 blitend:
+		/* ctx may be released once ncmd drops */
+		mm = ctx->mm;
+
 		spin_lock(&info->bltlock);
-		fimg2d_dequeue(&cmd->node);
+		fimg2d_del_command(info, cmd);
+		if (err) {
+			ctx->err = err;
+			ctx->fence_err = cmd->fence;
+		}
+		atomic_set(&ctx->fence_done, cmd->fence);
 		kfree(cmd);
 		atomic_dec(&ctx->ncmd);
 
-		/* wake up context */
-		if (!atomic_read(&ctx->ncmd))
-			wake_up(&ctx->wait_q);
+		/* wake up context, fence waiters and pollers */
+		wake_up(&ctx->wait_q);
 		spin_unlock(&info->bltlock);
+
+		mmput(mm);
 	}
 
+	fimg2d4x_sysmmu_disable(info);
 	atomic_set(&info->active, 0);
 
 	fimg2d_clk_off(info);
@@ -226,7 +305,7 @@ static int fimg2d4x_configure(struct fimg2d_control *info,
 		fimg2d4x_set_color_fill(info, 0);
 		break;
 	case BLIT_OP_DST:
-		return -1;	/* nop */
+		return 1;	/* nop */
 	default:
 		if (!src->addr.type) {
 			srcsel = IMG_FGCOLOR;
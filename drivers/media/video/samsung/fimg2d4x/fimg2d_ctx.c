@@ -12,12 +12,14 @@
 
 #include <linux/slab.h>
 #include <linux/sched.h>
+#include <linux/capability.h>
 #include <linux/uaccess.h>
 #include <plat/fimg2d.h>
 #include "fimg2d.h"
 #include "fimg2d_ctx.h"
 #include "fimg2d_cache.h"
 #include "fimg2d_helper.h"
+#include "fimg2d_sw.h"
 
 static int fimg2d_check_params(struct fimg2d_blit __user *u)
 {
@@ -308,10 +310,14 @@ static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
 	return 0;
 }
 
+/**
+ * Returns 0 if the command is queued to hardware, 1 if it has already
+ * been done by the CPU, and a negative error code otherwise.
+ */
 int fimg2d_add_command(struct fimg2d_control *info, struct fimg2d_context *ctx,
 			struct fimg2d_blit __user *u)
 {
-	int i;
+	int i, ret;
 	struct fimg2d_bltcmd *cmd;
 	struct fimg2d_image *buf[MAX_IMAGES] = image_table(u);
 
@@ -319,11 +325,6 @@ int fimg2d_add_command(struct fimg2d_control *info, struct fimg2d_context *ctx,
 	fimg2d_print_params(u);
 #endif
 
-	if (info->err) {
-		printk(KERN_ERR "[%s] device error, do sw fallback\n", __func__);
-		return -EFAULT;
-	}
-
 	if (fimg2d_check_params(u)) {
 		printk(KERN_ERR "[%s] invalid params\n", __func__);
 		fimg2d_print_params(u);
@@ -353,21 +354,56 @@ int fimg2d_add_command(struct fimg2d_control *info, struct fimg2d_context *ctx,
 
 	fimg2d_fixup_params(cmd);
 
+	if (fimg2d_sw_capable(cmd) && !atomic_read(&ctx->ncmd) &&
+			(info->err || atomic_read(&info->suspended) ||
+			fimg2d_sw_preferred(cmd))) {
+		ret = fimg2d_sw_blit(cmd);
+		kfree(cmd);
+		if (ret)
+			return ret;
+
+		spin_lock(&info->bltlock);
+		atomic_set(&ctx->fence_done, ++ctx->fence_seq);
+		spin_unlock(&info->bltlock);
+		return 1;
+	}
+
+	if (info->err) {
+		printk(KERN_ERR "[%s] device error, do sw fallback\n", __func__);
+		kfree(cmd);
+		return -EFAULT;
+	}
+
 	if (fimg2d_check_dma_sync(cmd))
 		goto err_user;
 
+	/*
+	 * Keep the address space mapped until the command is done, even if
+	 * the process exits first: exit_mm() runs before its files are
+	 * closed. Dropped by the blitter.
+	 */
+	if (!atomic_inc_not_zero(&ctx->mm->mm_users))
+		goto err_user;
+
 	/* add command node and increase ncmd */
 	spin_lock(&info->bltlock);
 	if (atomic_read(&info->suspended)) {
 		fimg2d_debug("fimg2d suspended, do sw fallback\n");
 		spin_unlock(&info->bltlock);
+		mmput(ctx->mm);
 		goto err_user;
 	}
 	atomic_inc(&ctx->ncmd);
-	fimg2d_enqueue(&cmd->node, &info->cmd_q);
-	fimg2d_debug("ctx %p pgd %p ncmd(%d) seq_no(%u)\n",
+	if (atomic_read(&ctx->ncmd) > ctx->max_depth)
+		ctx->max_depth = atomic_read(&ctx->ncmd);
+	cmd->fence = ++ctx->fence_seq;
+	cmd->queued = ktime_get();
+	if (fimg2d_queue_is_empty(&ctx->cmd_q))
+		fimg2d_enqueue(&ctx->node, &info->ctx_q);
+	fimg2d_enqueue(&cmd->node, &ctx->cmd_q);
+	fimg2d_debug("ctx %p pgd %p ncmd(%d) seq_no(%u) fence(%u)\n",
 			cmd->ctx, (unsigned long *)cmd->ctx->mm->pgd,
-			atomic_read(&ctx->ncmd), cmd->seq_no);
+			atomic_read(&ctx->ncmd), cmd->seq_no, cmd->fence);
 	spin_unlock(&info->bltlock);
 
 	return 0;
@@ -377,10 +413,96 @@ err_user:
 	return -EFAULT;
 }
 
+/**
+ * Pick the next command to blit.
+ *
+ * A command which has waited longer than FIMG2D_STARVE_MSEC wins.
+ * Otherwise the head command of the first context with the highest
+ * priority in ctx_q is taken; ctx_q is rotated on completion, so contexts
+ * of the same priority are served round-robin.
+ */
+struct fimg2d_bltcmd *fimg2d_get_first_command(struct fimg2d_control *info)
+{
+	struct fimg2d_context *ctx;
+	struct fimg2d_bltcmd *cmd, *best = NULL;
+	ktime_t now = ktime_get();
+	unsigned long wait;
+
+	spin_lock(&info->bltlock);
+	list_for_each_entry(ctx, &info->ctx_q, node) {
+		cmd = list_first_entry(&ctx->cmd_q, struct fimg2d_bltcmd, node);
+		if (ktime_us_delta(now, cmd->queued) >
+				FIMG2D_STARVE_MSEC * USEC_PER_MSEC) {
+			best = cmd;
+			break;
+		}
+
+		if (!best || ctx->priority > best->ctx->priority)
+			best = cmd;
+	}
+
+	if (best) {
+		ctx = best->ctx;
+		wait = (unsigned long)ktime_us_delta(now, best->queued);
+		ctx->nr_blits++;
+		ctx->wait_total += wait;
+		if (wait > ctx->wait_max)
+			ctx->wait_max = wait;
+	}
+	info->curr = best;
+	spin_unlock(&info->bltlock);
+
+	return best;
+}
+
+/* caller must hold bltlock */
+void fimg2d_del_command(struct fimg2d_control *info, struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_context *ctx = cmd->ctx;
+
+	fimg2d_dequeue(&cmd->node);
+
+	if (fimg2d_queue_is_empty(&ctx->cmd_q))
+		list_del_init(&ctx->node);
+	else
+		list_move_tail(&ctx->node, &info->ctx_q);
+
+	if (info->curr == cmd)
+		info->curr = NULL;
+}
+
+int fimg2d_set_priority(struct fimg2d_control *info, struct fimg2d_context *ctx,
+			int priority)
+{
+	if (priority < FIMG2D_PRIO_LOW || priority >= FIMG2D_PRIO_END)
+		return -EINVAL;
+
+	if (priority == FIMG2D_PRIO_HIGH && !capable(CAP_SYS_NICE))
+		return -EPERM;
+
+	spin_lock(&info->bltlock);
+	ctx->priority = priority;
+	spin_unlock(&info->bltlock);
+
+	fimg2d_debug("ctx %p priority(%d)\n", ctx, priority);
+	return 0;
+}
+
 void fimg2d_add_context(struct fimg2d_control *info, struct fimg2d_context *ctx)
 {
 	atomic_set(&ctx->ncmd, 0);
 	init_waitqueue_head(&ctx->wait_q);
+	ctx->fence_seq = 0;
+	atomic_set(&ctx->fence_done, 0);
+	ctx->err = 0;
+	ctx->pid = current->tgid;
+	ctx->priority = FIMG2D_PRIO_NORMAL;
+	INIT_LIST_HEAD(&ctx->cmd_q);
+	INIT_LIST_HEAD(&ctx->node);
+
+	spin_lock(&info->bltlock);
+	list_add_tail(&ctx->list, &info->ctx_list);
+	spin_unlock(&info->bltlock);
 
 	atomic_inc(&info->nctx);
 	fimg2d_debug("ctx %p nctx(%d)\n", ctx, atomic_read(&info->nctx));
@@ -388,6 +510,10 @@ void fimg2d_add_context(struct fimg2d_control *info, struct fimg2d_context *ctx)
 
 void fimg2d_del_context(struct fimg2d_control *info, struct fimg2d_context *ctx)
 {
+	spin_lock(&info->bltlock);
+	list_del(&ctx->list);
+	spin_unlock(&info->bltlock);
+
 	atomic_dec(&info->nctx);
 	fimg2d_debug("ctx %p nctx(%d)\n", ctx, atomic_read(&info->nctx));
 }
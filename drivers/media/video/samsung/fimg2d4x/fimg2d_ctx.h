@@ -28,14 +28,17 @@ static inline int fimg2d_queue_is_empty(struct list_head *q)
 	return list_empty(q);
 }
 
-static inline struct fimg2d_bltcmd *fimg2d_get_first_command(struct fimg2d_control *info)
+/* true if @fence is signaled, wrap-around safe */
+static inline int fimg2d_fence_signaled(struct fimg2d_context *ctx,
+					unsigned int fence)
 {
-	if (list_empty(&info->cmd_q))
-		return NULL;
-	else
-		return list_first_entry(&info->cmd_q, struct fimg2d_bltcmd, node);
+	return (int)(atomic_read(&ctx->fence_done) - fence) >= 0;
 }
 
+struct fimg2d_bltcmd *fimg2d_get_first_command(struct fimg2d_control *info);
+void fimg2d_del_command(struct fimg2d_control *info, struct fimg2d_bltcmd *cmd);
+int fimg2d_set_priority(struct fimg2d_control *info, struct fimg2d_context *ctx,
+			int priority);
 void fimg2d_add_context(struct fimg2d_control *info, struct fimg2d_context *ctx);
 void fimg2d_del_context(struct fimg2d_control *info, struct fimg2d_context *ctx);
 int fimg2d_add_command(struct fimg2d_control *info, struct fimg2d_context *ctx,
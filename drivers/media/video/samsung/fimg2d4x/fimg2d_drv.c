@@ -20,12 +20,15 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/slab.h>
+#include <linux/uaccess.h>
 #include <linux/workqueue.h>
 #include <linux/dma-mapping.h>
 #include <linux/sched.h>
 #include <linux/wait.h>
 #include <linux/atomic.h>
 #include <linux/delay.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm/cacheflush.h>
 #include <plat/cpu.h>
 #include <plat/fimg2d.h>
@@ -78,7 +81,7 @@ static int fimg2d_sysmmu_fault_handler(enum S5P_SYSMMU_INTERRUPT_TYPE itype,
 				__func__, itype, pgtable_base, fault_addr);
 	}
 
-	cmd = fimg2d_get_first_command(info);
+	cmd = info->curr;
 	if (!cmd) {
 		printk(KERN_ERR "[%s] null command\n", __func__);
 		goto next;
@@ -111,14 +114,46 @@ static void fimg2d_context_wait(struct fimg2d_context *ctx)
 	}
 }
 
-static void fimg2d_request_bitblt(struct fimg2d_context *ctx)
+static int fimg2d_fence_wait(struct fimg2d_context *ctx, unsigned int fence)
+{
+	int ret = 0;
+
+	/* fence has never been issued */
+	if ((int)(ctx->fence_seq - fence) < 0)
+		return -EINVAL;
+
+	while (!fimg2d_fence_signaled(ctx, fence)) {
+		if (!wait_event_timeout(ctx->wait_q,
+				fimg2d_fence_signaled(ctx, fence), CTX_TIMEOUT)) {
+			fimg2d_debug("[%s] ctx %p fence(%u) wait timeout\n",
+					__func__, ctx, fence);
+			if (info->err)
+				return -EIO;
+		}
+	}
+
+	/* a failed command is reported once, to the first wait covering it */
+	spin_lock(&info->bltlock);
+	if (ctx->err && (int)(fence - ctx->fence_err) >= 0) {
+		ret = ctx->err;
+		ctx->err = 0;
+	}
+	spin_unlock(&info->bltlock);
+
+	return ret;
+}
+
+static void fimg2d_request_bitblt(struct fimg2d_context *ctx,
+					enum blit_sync sync)
 {
 	if (!atomic_read(&info->active)) {
 		atomic_set(&info->active, 1);
 		fimg2d_debug("dispatch ctx %p to kernel thread\n", ctx);
 		queue_work(info->work_q, &fimg2d_work);
 	}
-	fimg2d_context_wait(ctx);
+
+	if (sync == BLIT_SYNC)
+		fimg2d_context_wait(ctx);
 }
 
 static int fimg2d_open(struct inode *inode, struct file *file)
@@ -132,7 +167,9 @@ static int fimg2d_open(struct inode *inode, struct file *file)
 	}
 	file->private_data = (void *)ctx;
 
+	/* the page table must outlive the commands of this context */
 	ctx->mm = current->mm;
+	atomic_inc(&ctx->mm->mm_count);
 	fimg2d_debug("ctx %p current pgd %p init_mm pgd %p\n",
 			ctx, (unsigned long *)ctx->mm->pgd,
 			(unsigned long *)init_mm.pgd);
@@ -154,6 +191,7 @@ static int fimg2d_release(struct inode *inode, struct file *file)
 	}
 	fimg2d_del_context(info, ctx);
 
+	mmdrop(ctx->mm);
 	kfree(ctx);
 	return 0;
 }
@@ -165,7 +203,18 @@ static int fimg2d_mmap(struct file *file, struct vm_area_struct *vma)
 
 static unsigned int fimg2d_poll(struct file *file, struct poll_table_struct *wait)
 {
-	return 0;
+	struct fimg2d_context *ctx = file->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(file, &ctx->wait_q, wait);
+
+	if (fimg2d_fence_signaled(ctx, ctx->fence_seq))
+		mask |= POLLIN | POLLRDNORM;
+
+	if (info->err)
+		mask |= POLLERR;
+
+	return mask;
 }
 
 static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
@@ -173,6 +222,9 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	int ret = 0;
 	struct fimg2d_context *ctx;
 	struct fimg2d_platdata *pdata;
+	enum blit_sync sync;
+	unsigned int fence;
+	int priority;
 	union {
 		struct fimg2d_blit *blit;
 		struct fimg2d_version ver;
@@ -196,9 +248,16 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 //		dev_lock(info->bus_dev, info->dev, 160160);
 //#endif
 //#endif
+		if (get_user(sync, &u.blit->sync)) {
+			dev_unlock(info->bus_dev, info->dev);
+			return -EFAULT;
+		}
+
 		ret = fimg2d_add_command(info, ctx, u.blit);
 		if (!ret)
-			fimg2d_request_bitblt(ctx);
+			fimg2d_request_bitblt(ctx, sync);
+		else if (ret > 0)
+			ret = 0;	/* done by cpu */
 #ifdef PERF_PROFILE
 		perf_print(ctx, u.blit->seq_no);
 		perf_clear(ctx);
@@ -213,7 +272,29 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 
 	case FIMG2D_BITBLT_SYNC:
 		fimg2d_debug("FIMG2D_BITBLT_SYNC ctx: %p\n", ctx);
-		/* FIXME: */
+		fimg2d_context_wait(ctx);
+		break;
+
+	case FIMG2D_BITBLT_FENCE:
+		fence = ctx->fence_seq;
+		fimg2d_debug("FIMG2D_BITBLT_FENCE ctx: %p fence(%u)\n", ctx, fence);
+		if (put_user(fence, (unsigned int __user *)arg))
+			return -EFAULT;
+		break;
+
+	case FIMG2D_BITBLT_WAIT:
+		if (get_user(fence, (unsigned int __user *)arg))
+			return -EFAULT;
+		fimg2d_debug("FIMG2D_BITBLT_WAIT ctx: %p fence(%u)\n", ctx, fence);
+		ret = fimg2d_fence_wait(ctx, fence);
+		break;
+
+	case FIMG2D_BITBLT_PRIORITY:
+		if (get_user(priority, (int __user *)arg))
+			return -EFAULT;
+		fimg2d_debug("FIMG2D_BITBLT_PRIORITY ctx: %p priority(%d)\n",
+				ctx, priority);
+		ret = fimg2d_set_priority(info, ctx, priority);
 		break;
 
 	case FIMG2D_BITBLT_VERSION:
@@ -235,6 +316,43 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	return ret;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int fimg2d_stats_show(struct seq_file *s, void *unused)
+{
+	struct fimg2d_context *ctx;
+
+	seq_printf(s, "%-8s %-4s %-6s %-6s %-10s %-10s %-10s\n",
+			"pid", "prio", "queued", "depth", "blits",
+			"wait_avg", "wait_max");
+
+	spin_lock(&info->bltlock);
+	list_for_each_entry(ctx, &info->ctx_list, list) {
+		seq_printf(s, "%-8d %-4d %-6d %-6u %-10lu %-10llu %-10lu\n",
+				ctx->pid, ctx->priority,
+				atomic_read(&ctx->ncmd), ctx->max_depth,
+				ctx->nr_blits,
+				ctx->nr_blits ?
+				div_u64(ctx->wait_total, ctx->nr_blits) : 0,
+				ctx->wait_max);
+	}
+	spin_unlock(&info->bltlock);
+
+	return 0;
+}
+
+static int fimg2d_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fimg2d_stats_show, inode->i_private);
+}
+
+static const struct file_operations fimg2d_stats_fops = {
+	.open		= fimg2d_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 /* fops */
 static const struct file_operations fimg2d_fops = {
 	.owner          = THIS_MODULE,
@@ -262,7 +380,9 @@ static int fimg2d_setup_controller(struct fimg2d_control *info)
 
 	spin_lock_init(&info->bltlock);
 
-	INIT_LIST_HEAD(&info->cmd_q);
+	INIT_LIST_HEAD(&info->ctx_q);
+	INIT_LIST_HEAD(&info->ctx_list);
+	info->curr = NULL;
 	init_waitqueue_head(&info->wait_q);
 	fimg2d_register_ops(info);
 
@@ -372,6 +492,11 @@ static int fimg2d_probe(struct platform_device *pdev)
 		goto err_reg;
 	}
 
+#ifdef CONFIG_DEBUG_FS
+	info->debugfs = debugfs_create_file("fimg2d", S_IRUGO, NULL, NULL,
+						&fimg2d_stats_fops);
+#endif
+
 	printk(KERN_INFO "Samsung Graphics 2D driver, (c) 2011 Samsung Electronics\n");
 	return 0;
 
@@ -402,6 +527,9 @@ err_plat:
 
 static int fimg2d_remove(struct platform_device *pdev)
 {
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove(info->debugfs);
+#endif
 	free_irq(info->irq, NULL);
 
 	if (info->mem) {
@@ -427,7 +555,7 @@ static int fimg2d_suspend(struct device *dev)
 	fimg2d_debug("suspend... start\n");
 	atomic_set(&info->suspended, 1);
 	while (1) {
-		if (fimg2d_queue_is_empty(&info->cmd_q))
+		if (fimg2d_queue_is_empty(&info->ctx_q))
 			break;
 
 		mdelay(2);
@@ -0,0 +1,239 @@
+/* linux/drivers/media/video/samsung/fimg2d4x/fimg2d_sw.c
+ *
+ * Copyright (c) 2011 Samsung Electronics Co., Ltd.
+ *	http://www.samsung.com/
+ *
+ * Samsung Graphics 2D driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include "fimg2d.h"
+#include "fimg2d_sw.h"
+#include "fimg2d_helper.h"
+
+/*
+ * CPU implementation of the subset of fimg2d4x_configure() which is
+ * common for composition: solid fill, clear, copy and premultiplied
+ * src-over with global alpha and nearest scaling, on 32bpp AX_RGB user
+ * buffers. Blits with fewer destination pixels than sw_threshold are
+ * faster on the CPU than the hardware round-trip. sw_force routes every
+ * capable blit to the CPU, e.g. for testing without the hardware.
+ */
+static unsigned int sw_threshold = 64 * 64;
+module_param(sw_threshold, uint, 0644);
+MODULE_PARM_DESC(sw_threshold, "max dst pixels of a blit done by the CPU");
+
+static bool sw_force;
+module_param(sw_force, bool, 0644);
+MODULE_PARM_DESC(sw_force, "do every supported blit by the CPU");
+
+static inline int sw_format_ok(struct fimg2d_image *img)
+{
+	if (img->addr.type != ADDR_USER && img->addr.type != ADDR_USER_CONTIG)
+		return 0;
+
+	if (img->fmt != CF_ARGB_8888 && img->fmt != CF_XRGB_8888)
+		return 0;
+
+	return img->order == AX_RGB;
+}
+
+/* multiply all four channels by a/255 */
+static inline u32 sw_scale_pixel(u32 p, u32 a)
+{
+	u32 rb, ag;
+
+	rb = (p & 0x00ff00ff) * a + 0x00800080;
+	rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+	ag = ((p >> 8) & 0x00ff00ff) * a + 0x00800080;
+	ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+
+	return rb | ag;
+}
+
+static void sw_draw_rect(struct fimg2d_bltcmd *cmd, struct fimg2d_rect *r)
+{
+	struct fimg2d_clip *clp = &cmd->param.clipping;
+
+	*r = cmd->image[IDST].rect;
+
+	if (clp->enable) {
+		r->x1 = max(r->x1, clp->x1);
+		r->y1 = max(r->y1, clp->y1);
+		r->x2 = min(r->x2, clp->x2);
+		r->y2 = min(r->y2, clp->y2);
+	}
+}
+
+int fimg2d_sw_capable(struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_param *p = &cmd->param;
+	struct fimg2d_image *src = &cmd->image[ISRC];
+	struct fimg2d_image *dst = &cmd->image[IDST];
+	unsigned int ow, oh;
+
+	switch (cmd->op) {
+	case BLIT_OP_SOLID_FILL:
+	case BLIT_OP_CLR:
+	case BLIT_OP_SRC:
+		break;
+	case BLIT_OP_SRC_OVER:
+		if (p->premult != PREMULTIPLIED)
+			return 0;
+		break;
+	default:
+		return 0;
+	}
+
+	if (cmd->image[IMSK].addr.type || !sw_format_ok(dst))
+		return 0;
+
+	if (p->rotate || p->dither || p->bluscr.mode)
+		return 0;
+
+	if (!src->addr.type || cmd->op == BLIT_OP_SOLID_FILL ||
+			cmd->op == BLIT_OP_CLR)
+		return 1;
+
+	if (!sw_format_ok(src) || !rect_w(&src->rect) || !rect_h(&src->rect))
+		return 0;
+
+	if (p->scaling.mode != NO_SCALING &&
+			p->scaling.mode != SCALING_NEAREST)
+		return 0;
+
+	/* repeat has no effect as long as dst fits into the src output */
+	ow = p->scaling.mode ? p->scaling.dst_w : rect_w(&src->rect);
+	oh = p->scaling.mode ? p->scaling.dst_h : rect_h(&src->rect);
+	if (rect_w(&dst->rect) > ow || rect_h(&dst->rect) > oh)
+		return 0;
+
+	return 1;
+}
+
+int fimg2d_sw_preferred(struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_rect r;
+
+	if (sw_force)
+		return 1;
+
+	sw_draw_rect(cmd, &r);
+	return rect_w(&r) * rect_h(&r) <= sw_threshold;
+}
+
+int fimg2d_sw_blit(struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_param *p = &cmd->param;
+	struct fimg2d_scale *scl = &p->scaling;
+	struct fimg2d_image *src = &cmd->image[ISRC];
+	struct fimg2d_image *dst = &cmd->image[IDST];
+	struct fimg2d_rect *sr = &src->rect;
+	struct fimg2d_rect *dr = &dst->rect;
+	struct fimg2d_rect r;
+	u32 *sbuf = NULL, *dbuf;
+	u32 color, s, sa, ga = p->g_alpha;
+	u32 dmask = (dst->fmt == CF_XRGB_8888) ? 0xff000000 : 0;
+	u32 smask = (src->fmt == CF_XRGB_8888) ? 0xff000000 : 0;
+	int use_src = src->addr.type && cmd->op != BLIT_OP_SOLID_FILL &&
+			cmd->op != BLIT_OP_CLR;
+	int w, x, y, sx, sy, ret = 0;
+	unsigned long saddr, daddr;
+
+	sw_draw_rect(cmd, &r);
+	w = rect_w(&r);
+	if (r.x2 <= r.x1 || r.y2 <= r.y1)
+		return 0;
+
+	dbuf = kmalloc(w * sizeof(u32), GFP_KERNEL);
+	if (!dbuf)
+		return -ENOMEM;
+
+	if (use_src) {
+		sbuf = kmalloc(rect_w(sr) * sizeof(u32), GFP_KERNEL);
+		if (!sbuf) {
+			kfree(dbuf);
+			return -ENOMEM;
+		}
+	}
+
+	/* fgcolor is scaled by global alpha except for solid fill */
+	color = p->solid_color;
+	if (cmd->op == BLIT_OP_CLR)
+		color = 0;
+	else if (cmd->op != BLIT_OP_SOLID_FILL && ga != 0xff)
+		color = sw_scale_pixel(color, ga);
+
+	for (y = r.y1; y < r.y2; y++) {
+		daddr = dst->addr.start + y * dst->stride + r.x1 * sizeof(u32);
+
+		if (use_src) {
+			if (scl->mode)
+				sy = sr->y1 + (y - dr->y1) * scl->src_h / scl->dst_h;
+			else
+				sy = sr->y1 + (y - dr->y1);
+			sy = clamp_t(int, sy, sr->y1, sr->y2 - 1);
+
+			saddr = src->addr.start + sy * src->stride +
+					sr->x1 * sizeof(u32);
+			if (copy_from_user(sbuf, (void __user *)saddr,
+						rect_w(sr) * sizeof(u32))) {
+				ret = -EFAULT;
+				break;
+			}
+		}
+
+		if (cmd->op == BLIT_OP_SRC_OVER &&
+				copy_from_user(dbuf, (void __user *)daddr,
+						w * sizeof(u32))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		for (x = 0; x < w; x++) {
+			if (use_src) {
+				if (scl->mode)
+					sx = (r.x1 + x - dr->x1) *
+						scl->src_w / scl->dst_w;
+				else
+					sx = r.x1 + x - dr->x1;
+
+				/* sbuf holds the clipped source row only */
+				sx = clamp_t(int, sx, 0, rect_w(sr) - 1);
+				s = sbuf[sx] | smask;
+				if (ga != 0xff)
+					s = sw_scale_pixel(s, ga);
+			} else {
+				s = color;
+			}
+
+			if (cmd->op == BLIT_OP_SRC_OVER) {
+				sa = s >> 24;
+				if (sa != 0xff)
+					s += sw_scale_pixel(dbuf[x] | dmask,
+								0xff - sa);
+			}
+
+			dbuf[x] = s | dmask;
+		}
+
+		if (copy_to_user((void __user *)daddr, dbuf, w * sizeof(u32))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+
+	kfree(sbuf);
+	kfree(dbuf);
+
+	fimg2d_debug("ctx %p seq_no(%u) op(%d) %dx%d ret(%d)\n", cmd->ctx,
+			cmd->seq_no, cmd->op, w, rect_h(&r), ret);
+	return ret;
+}
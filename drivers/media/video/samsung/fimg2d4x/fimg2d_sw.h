@@ -0,0 +1,39 @@
+/* linux/drivers/media/video/samsung/fimg2d4x/fimg2d_sw.h
+ *
+ * Copyright (c) 2011 Samsung Electronics Co., Ltd.
+ *	http://www.samsung.com/
+ *
+ * Samsung Graphics 2D driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef __FIMG2D_SW_H__
+#define __FIMG2D_SW_H__
+
+#include "fimg2d.h"
+
+#ifdef CONFIG_VIDEO_FIMG2D4X_SW_FALLBACK
+int fimg2d_sw_capable(struct fimg2d_bltcmd *cmd);
+int fimg2d_sw_preferred(struct fimg2d_bltcmd *cmd);
+int fimg2d_sw_blit(struct fimg2d_bltcmd *cmd);
+#else
+static inline int fimg2d_sw_capable(struct fimg2d_bltcmd *cmd)
+{
+	return 0;
+}
+
+static inline int fimg2d_sw_preferred(struct fimg2d_bltcmd *cmd)
+{
+	return 0;
+}
+
+static inline int fimg2d_sw_blit(struct fimg2d_bltcmd *cmd)
+{
+	return -ENOSYS;
+}
+#endif
+
+#endif /* __FIMG2D_SW_H__ */
@@ -11,6 +11,9 @@
 */
 
 #include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/mm.h>
+#include <plat/fimc.h>
 
 #include "jpeg_core.h"
 #include "jpeg_regs.h"
@@ -54,29 +57,37 @@ int jpeg_set_dec_param(struct jpeg_control *ctrl)
 	return 0;
 }
 
-int jpeg_set_enc_param(struct jpeg_control *ctrl)
+static void jpeg_set_enc_regs(struct jpeg_control *ctrl,
+			unsigned int width, unsigned int height,
+			enum jpeg_img_quality_level quality,
+			unsigned int frame_addr, unsigned int stream_addr)
 {
-	if (ctrl) {
-		jpeg_sw_reset(ctrl->reg_base);
-	} else {
-		jpeg_err("jpeg ctrl is NULL\n");
-		return -1;
-	}
-
+	jpeg_sw_reset(ctrl->reg_base);
 	jpeg_set_clk_power_on(ctrl->reg_base);
 	jpeg_set_mode(ctrl->reg_base, 0);
 	jpeg_set_enc_in_fmt(ctrl->reg_base, ctrl->enc_param.in_fmt);
 	jpeg_set_enc_out_fmt(ctrl->reg_base, ctrl->enc_param.out_fmt);
 	jpeg_set_enc_dri(ctrl->reg_base, 2);
-	jpeg_set_frame_size(ctrl->reg_base,
-		ctrl->enc_param.width, ctrl->enc_param.height);
-	jpeg_set_stream_buf(&ctrl->mem.stream_data_addr, ctrl->mem.base);
-	jpeg_set_stream_addr(ctrl->reg_base, ctrl->mem.stream_data_addr);
-	jpeg_set_frame_buf(&ctrl->mem.frame_data_addr, ctrl->mem.base);
-	jpeg_set_frame_addr(ctrl->reg_base, ctrl->mem.frame_data_addr);
+	jpeg_set_frame_size(ctrl->reg_base, width, height);
+	jpeg_set_stream_addr(ctrl->reg_base, stream_addr);
+	jpeg_set_frame_addr(ctrl->reg_base, frame_addr);
 	jpeg_set_enc_coef(ctrl->reg_base);
-	jpeg_set_enc_qtbl(ctrl->reg_base, ctrl->enc_param.quality);
+	jpeg_set_enc_qtbl(ctrl->reg_base, quality);
 	jpeg_set_enc_htbl(ctrl->reg_base);
+}
+
+int jpeg_set_enc_param(struct jpeg_control *ctrl)
+{
+	if (!ctrl) {
+		jpeg_err("jpeg ctrl is NULL\n");
+		return -1;
+	}
+
+	jpeg_set_stream_buf(&ctrl->mem.stream_data_addr, ctrl->mem.base);
+	jpeg_set_frame_buf(&ctrl->mem.frame_data_addr, ctrl->mem.base);
+	jpeg_set_enc_regs(ctrl, ctrl->enc_param.width, ctrl->enc_param.height,
+			ctrl->enc_param.quality, ctrl->mem.frame_data_addr,
+			ctrl->mem.stream_data_addr);
 
 	return 0;
 }
@@ -106,9 +117,8 @@ int jpeg_exe_dec(struct jpeg_control *ctrl)
 	return 0;
 }
 
-int jpeg_exe_enc(struct jpeg_control *ctrl)
+static int jpeg_run_enc(struct jpeg_control *ctrl, unsigned int *size)
 {
-
 	jpeg_start_encode(ctrl->reg_base);
 
 	if (interruptible_sleep_on_timeout(&ctrl->wq, INT_TIMEOUT) == 0)
@@ -119,8 +129,99 @@ int jpeg_exe_enc(struct jpeg_control *ctrl)
 		return -1;
 	}
 
-	ctrl->enc_param.size = jpeg_get_stream_size(ctrl->reg_base);
+	*size = jpeg_get_stream_size(ctrl->reg_base);
+
+	return 0;
+}
+
+int jpeg_exe_enc(struct jpeg_control *ctrl)
+{
+	return jpeg_run_enc(ctrl, &ctrl->enc_param.size);
+}
+
+/*
+ * Encodes the frame set by the enc param and a thumbnail of it in one
+ * request. FIMC downscales the frame into the frame buffer behind it
+ * while the main image is encoded, then the thumbnail is encoded into
+ * the stream buffer behind the main stream. FIMC needs the physical
+ * addresses, so this is not available with the jpeg sysmmu.
+ */
+#if defined(CONFIG_S5P_SYSMMU_JPEG)
+int jpeg_exe_enc_thumb(struct jpeg_control *ctrl)
+{
+	jpeg_err("thumbnail encode needs physical buffers\n");
+	return -ENOSYS;
+}
+#else
+int jpeg_exe_enc_thumb(struct jpeg_control *ctrl)
+{
+	struct jpeg_enc_param *enc = &ctrl->enc_param;
+	struct jpeg_thumb_param *thumb = &ctrl->thumb_param;
+	struct fimc_scale_req req;
+	unsigned int frame_size, thumb_frame;
+	int ret, scale_ret;
+
+	/* both encoder input formats are 16bpp */
+	if (enc->in_fmt == YUV_420 || !thumb->width || !thumb->height ||
+			thumb->width > enc->width ||
+			thumb->height > enc->height ||
+			(thumb->width & 15) || (thumb->height & 7)) {
+		jpeg_err("invalid thumbnail %dx%d for %dx%d fmt(%d)\n",
+			thumb->width, thumb->height,
+			enc->width, enc->height, enc->in_fmt);
+		return -EINVAL;
+	}
+
+	frame_size = PAGE_ALIGN(enc->width * enc->height * 2);
+	if (frame_size + thumb->width * thumb->height * 2 > JPEG_F_BUF_SIZE)
+		return -ENOMEM;
+
+	ret = jpeg_set_enc_param(ctrl);
+	if (ret < 0)
+		return -EINVAL;
+
+	thumb_frame = ctrl->mem.frame_data_addr + frame_size;
+
+	memset(&req, 0, sizeof(req));
+	req.src = ctrl->mem.frame_data_addr;
+	req.dst = thumb_frame;
+	req.fourcc = (enc->in_fmt == RGB_565) ?
+			V4L2_PIX_FMT_RGB565 : V4L2_PIX_FMT_YUYV;
+	req.src_width = enc->width;
+	req.src_height = enc->height;
+	req.dst_width = thumb->width;
+	req.dst_height = thumb->height;
+
+	ret = fimc_m2m_scale_start(&req);
+	if (ret < 0) {
+		jpeg_err("failed to start thumbnail scaling(%d)\n", ret);
+		return ret;
+	}
+
+	ret = jpeg_run_enc(ctrl, &enc->size);
+	scale_ret = fimc_m2m_scale_wait(&req);
+	if (ret < 0)
+		return -EIO;
+	if (scale_ret < 0) {
+		jpeg_err("thumbnail scaling failed(%d)\n", scale_ret);
+		return scale_ret;
+	}
+
+	thumb->main_size = enc->size;
+	thumb->offset = PAGE_ALIGN(enc->size);
+	if (thumb->offset + thumb->width * thumb->height * 2 > JPEG_S_BUF_SIZE)
+		return -ENOMEM;
+
+	jpeg_set_enc_regs(ctrl, thumb->width, thumb->height, thumb->quality,
+			thumb_frame, ctrl->mem.stream_data_addr + thumb->offset);
+	if (jpeg_run_enc(ctrl, &thumb->size) < 0)
+		return -EIO;
+
+	jpeg_info("main(%d bytes) thumb %dx%d(%d bytes at 0x%x)\n",
+			thumb->main_size, thumb->width, thumb->height,
+			thumb->size, thumb->offset);
 
 	return 0;
 }
+#endif
 
@@ -68,6 +68,19 @@ struct jpeg_enc_param {
 	enum jpeg_img_quality_level quality;
 };
 
+/*
+ * Thumbnail encoded together with the main image set by the enc param.
+ * Its stream follows the main one in the stream buffer at offset.
+ */
+struct jpeg_thumb_param {
+	unsigned int width;
+	unsigned int height;
+	enum jpeg_img_quality_level quality;
+	unsigned int main_size;		/* out */
+	unsigned int size;		/* out */
+	unsigned int offset;		/* out */
+};
+
 struct jpeg_control {
 	struct clk		*clk;
 	atomic_t		in_use;
@@ -79,6 +92,7 @@ struct jpeg_control {
 	struct jpeg_mem		mem;		/* for reserved memory */
 	struct jpeg_dec_param	dec_param;
 	struct jpeg_enc_param	enc_param;
+	struct jpeg_thumb_param	thumb_param;
 };
 
 enum jpeg_log {
@@ -132,6 +146,7 @@ int jpeg_set_dec_param(struct jpeg_control *ctrl);
 int jpeg_set_enc_param(struct jpeg_control *ctrl);
 int jpeg_exe_dec(struct jpeg_control *ctrl);
 int jpeg_exe_enc(struct jpeg_control *ctrl);
+int jpeg_exe_enc_thumb(struct jpeg_control *ctrl);
 
 
 #endif /*__JPEG_CORE_H__*/
@@ -154,6 +154,22 @@ static long jpeg_ioctl(struct file *file,
 			sizeof(struct jpeg_enc_param));
 		break;
 
+	case IOCTL_JPEG_ENC_THUMB_EXE:
+		if (copy_from_user(&ctrl->thumb_param,
+				(struct jpeg_thumb_param *)arg,
+				sizeof(struct jpeg_thumb_param)))
+			return -EFAULT;
+
+		ret = jpeg_exe_enc_thumb(ctrl);
+		if (ret < 0)
+			return ret;
+
+		if (copy_to_user((void *)arg,
+				(void *) &ctrl->thumb_param,
+				sizeof(struct jpeg_thumb_param)))
+			return -EFAULT;
+		break;
+
 	case IOCTL_GET_DEC_IN_BUF:
 	case IOCTL_GET_ENC_OUT_BUF:
 		return jpeg_get_stream_buf(arg);
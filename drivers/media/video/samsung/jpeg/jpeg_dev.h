@@ -29,6 +29,7 @@
 #define IOCTL_GET_ENC_OUT_BUF			_IO(JPEG_IOCTL_MAGIC, 6)
 #define IOCTL_SET_DEC_PARAM			_IO(JPEG_IOCTL_MAGIC, 7)
 #define IOCTL_SET_ENC_PARAM			_IO(JPEG_IOCTL_MAGIC, 8)
+#define IOCTL_JPEG_ENC_THUMB_EXE		_IO(JPEG_IOCTL_MAGIC, 9)
 
 #endif /*__JPEG_DEV_H__*/
 
@@ -19,6 +19,7 @@
 #include <linux/interrupt.h>
 #include <linux/spinlock.h>
 #include <linux/sched.h>
+#include <linux/ktime.h>
 
 #include <linux/videodev2.h>
 #include <media/v4l2-device.h>
@@ -172,6 +173,13 @@ struct jpeg_ctx {
 	unsigned long		payload[VIDEO_MAX_PLANES];
 	bool			input_cacheable;
 	bool			output_cacheable;
+
+	/* per-job encode statistics, updated from the irq handler */
+	unsigned int		nr_jobs;
+	unsigned int		last_size;
+	unsigned int		last_us;
+	unsigned int		max_us;
+	u64			total_us;
 };
 
 struct jpeg_vb2 {
@@ -217,6 +225,9 @@ struct jpeg_dev {
 	struct workqueue_struct	*watchdog_workqueue;
 	struct work_struct	watchdog_work;
 	struct device			*bus_dev;
+
+	bool			enc_tbl_loaded;	/* q/huffman tables in place */
+	ktime_t			job_start;
 };
 
 enum jpeg_log {
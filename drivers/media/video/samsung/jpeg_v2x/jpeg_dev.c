@@ -52,22 +52,36 @@
 #include "jpeg_mem.h"
 #include "jpeg_regs.h"
 
+/*
+ * The encoder always uses the same quantization and Huffman tables, so
+ * with batch_enc they are uploaded once and kept for back-to-back encode
+ * jobs until a decode (which loads the tables of its stream), an error
+ * or a power cycle. Every job still starts with a software reset, which
+ * is not documented to preserve the table memory, so this is off by
+ * default and only to be set on parts where it was verified.
+ */
+static bool batch_enc;
+module_param(batch_enc, bool, 0644);
+MODULE_PARM_DESC(batch_enc, "keep encoder tables loaded across jobs");
+
 void jpeg_watchdog(unsigned long arg)
 {
 	struct jpeg_dev *dev = (struct jpeg_dev *)arg;
 
 	printk(KERN_DEBUG "jpeg_watchdog\n");
-	if (test_bit(0, &dev->hw_run)) {
-		atomic_inc(&dev->watchdog_cnt);
-		printk(KERN_DEBUG "jpeg_watchdog_count.\n");
-	}
+	/* idle: the next job run arms the timer again */
+	if (!test_bit(0, &dev->hw_run))
+		return;
+
+	atomic_inc(&dev->watchdog_cnt);
+	printk(KERN_DEBUG "jpeg_watchdog_count.\n");
 
 	if (atomic_read(&dev->watchdog_cnt) >= JPEG_WATCHDOG_CNT)
 		queue_work(dev->watchdog_workqueue, &dev->watchdog_work);
 
-	dev->watchdog_timer.expires = jiffies +
-					msecs_to_jiffies(JPEG_WATCHDOG_INTERVAL);
-	add_timer(&dev->watchdog_timer);
+	/* a job run may have re-armed it meanwhile */
+	mod_timer(&dev->watchdog_timer,
+		  jiffies + msecs_to_jiffies(JPEG_WATCHDOG_INTERVAL));
 }
 
 static void jpeg_watchdog_worker(struct work_struct *work)
@@ -82,6 +96,7 @@ static void jpeg_watchdog_worker(struct work_struct *work)
 
 	spin_lock_irqsave(&dev->slock, flags);
 	clear_bit(0, &dev->hw_run);
+	atomic_set(&dev->watchdog_cnt, 0);
 	if (dev->mode == ENCODING)
 		ctx = v4l2_m2m_get_curr_priv(dev->m2m_dev_enc);
 	else
@@ -91,6 +106,7 @@ static void jpeg_watchdog_worker(struct work_struct *work)
 		src_vb = v4l2_m2m_src_buf_remove(ctx->m2m_ctx);
 		dst_vb = v4l2_m2m_dst_buf_remove(ctx->m2m_ctx);
 
+		dev->enc_tbl_loaded = false;
 		v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_ERROR);
 		v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_ERROR);
 		if (dev->mode == ENCODING)
@@ -499,13 +515,25 @@ static void jpeg_device_enc_run(void *priv)
 	dev = ctx->dev;
 	spin_lock_irqsave(&ctx->slock, flags);
 
+	if (timer_pending(&ctx->dev->watchdog_timer) == 0)
+		mod_timer(&ctx->dev->watchdog_timer,
+			  jiffies + msecs_to_jiffies(JPEG_WATCHDOG_INTERVAL));
+
+	/* the count is per job, not summed over all of them */
+	atomic_set(&ctx->dev->watchdog_cnt, 0);
+	set_bit(0, &ctx->dev->hw_run);
+
 	dev->mode = ENCODING;
+	dev->job_start = ktime_get();
 	enc_param = ctx->param.enc_param;
 
 	jpeg_sw_reset(dev->reg_base);
 	jpeg_set_interrupt(dev->reg_base);
 	jpeg_set_huf_table_enable(dev->reg_base, 1);
-	jpeg_set_enc_tbl(dev->reg_base);
+	if (!batch_enc || !dev->enc_tbl_loaded) {
+		jpeg_set_enc_tbl(dev->reg_base);
+		dev->enc_tbl_loaded = true;
+	}
 	jpeg_set_encode_tbl_select(dev->reg_base, enc_param.quality);
 	jpeg_set_stream_size(dev->reg_base,
 		enc_param.in_width, enc_param.in_height);
@@ -548,15 +576,17 @@ static void jpeg_device_dec_run(void *priv)
 
 	printk(KERN_DEBUG "dec_run.\n");
 
-	if (timer_pending(&ctx->dev->watchdog_timer) == 0) {
-		ctx->dev->watchdog_timer.expires = jiffies +
-					msecs_to_jiffies(JPEG_WATCHDOG_INTERVAL);
-		add_timer(&ctx->dev->watchdog_timer);
-	}
+	if (timer_pending(&ctx->dev->watchdog_timer) == 0)
+		mod_timer(&ctx->dev->watchdog_timer,
+			  jiffies + msecs_to_jiffies(JPEG_WATCHDOG_INTERVAL));
 
+	/* the count is per job, not summed over all of them */
+	atomic_set(&ctx->dev->watchdog_cnt, 0);
 	set_bit(0, &ctx->dev->hw_run);
 
 	dev->mode = DECODING;
+	dev->job_start = ktime_get();
+	dev->enc_tbl_loaded = false;
 	dec_param = ctx->param.dec_param;
 
 	jpeg_sw_reset(dev->reg_base);
@@ -631,6 +661,31 @@ int jpeg_int_pending(struct jpeg_dev *ctrl)
 	return int_status;
 }
 
+/*
+ * The next encode job starts from v4l2_m2m_job_finish() below and
+ * overwrites the size register, so the size of each stream is returned
+ * as the payload of its own buffer.
+ */
+static void jpeg_enc_job_done(struct jpeg_dev *ctrl, struct jpeg_ctx *ctx,
+			      struct vb2_buffer *dst_vb)
+{
+	unsigned int us;
+
+	us = ktime_us_delta(ktime_get(), ctrl->job_start);
+
+	ctx->last_size = jpeg_get_stream_size(ctrl->reg_base);
+	ctx->last_us = us;
+	ctx->max_us = max(ctx->max_us, us);
+	ctx->total_us += us;
+	ctx->nr_jobs++;
+
+	if (ctrl->irq_ret == OK_ENC_OR_DEC)
+		vb2_set_plane_payload(dst_vb, 0, ctx->last_size);
+
+	jpeg_dbg("job %u: %u bytes in %u us\n", ctx->nr_jobs,
+			ctx->last_size, us);
+}
+
 static irqreturn_t jpeg_irq(int irq, void *priv)
 {
 	unsigned int int_status;
@@ -682,15 +737,20 @@ static irqreturn_t jpeg_irq(int irq, void *priv)
 		ctrl->irq_ret = ERR_UNKNOWN;
 	}
 
+	if (ctrl->mode == ENCODING)
+		jpeg_enc_job_done(ctrl, ctx, dst_vb);
+
 	if (ctrl->irq_ret == OK_ENC_OR_DEC) {
 		v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_DONE);
 		v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_DONE);
 	} else {
+		ctrl->enc_tbl_loaded = false;
 		v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_ERROR);
 		v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_ERROR);
 	}
 
 	clear_bit(0, &ctx->dev->hw_run);
+	atomic_set(&ctrl->watchdog_cnt, 0);
 	if (ctrl->mode == ENCODING)
 		v4l2_m2m_job_finish(ctrl->m2m_dev_enc, ctx->m2m_ctx);
 	else
@@ -980,6 +1040,7 @@ static int jpeg_suspend(struct platform_device *pdev, pm_message_t state)
 
 static int jpeg_resume(struct platform_device *pdev)
 {
+	struct jpeg_dev *jpeg_drv = platform_get_drvdata(pdev);
 #ifdef CONFIG_PM_RUNTIME
 #if defined (CONFIG_CPU_EXYNOS5250)
 	struct jpeg_dev *dev = platform_get_drvdata(pdev);
@@ -992,6 +1053,7 @@ static int jpeg_resume(struct platform_device *pdev)
 	pm_runtime_get_sync(&pdev->dev);
 #endif
 #endif
+	jpeg_drv->enc_tbl_loaded = false;
 	return 0;
 }
 
@@ -1044,6 +1106,7 @@ static int jpeg_runtime_resume(struct device *dev)
 #endif
 	clk_enable(jpeg_drv->clk);
 	jpeg_drv->vb2->resume(jpeg_drv->alloc_ctx);
+	jpeg_drv->enc_tbl_loaded = false;
 	return 0;
 }
 #endif
@@ -40,6 +40,7 @@
 #include <mach/irqs.h>
 
 #include <media/v4l2-ioctl.h>
+#include <linux/videodev2_samsung.h>
 
 #include "jpeg_core.h"
 #include "jpeg_dev.h"
@@ -457,11 +458,20 @@ static int jpeg_enc_vidioc_g_ctrl(struct file *file, void *priv,
 			    struct v4l2_control *ctrl)
 {
 	struct jpeg_ctx *ctx = priv;
-	struct jpeg_dev *dev = ctx->dev;
 
 	switch (ctrl->id) {
 	case V4L2_CID_CAM_JPEG_ENCODEDSIZE:
-		ctrl->value = jpeg_get_stream_size(dev->reg_base);
+		ctrl->value = ctx->last_size;
+		break;
+	case V4L2_CID_CAM_JPEG_ENC_TIME:
+		ctrl->value = ctx->last_us;
+		break;
+	case V4L2_CID_CAM_JPEG_ENC_TIME_MAX:
+		ctrl->value = ctx->max_us;
+		break;
+	case V4L2_CID_CAM_JPEG_ENC_TIME_AVG:
+		ctrl->value = ctx->nr_jobs ?
+			div_u64(ctx->total_us, ctx->nr_jobs) : 0;
 		break;
 	default:
 		break;
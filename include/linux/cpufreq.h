@@ -191,6 +191,9 @@ extern int cpufreq_driver_target(struct cpufreq_policy *policy,
 extern int __cpufreq_driver_target(struct cpufreq_policy *policy,
 				   unsigned int target_freq,
 				   unsigned int relation);
+extern int cpufreq_driver_fast_switch(struct cpufreq_policy *policy,
+				      unsigned int target_freq,
+				      unsigned int relation);
 
 
 extern int __cpufreq_driver_getavg(struct cpufreq_policy *policy,
@@ -224,6 +227,11 @@ struct cpufreq_driver {
 				 unsigned int target_freq,
 				 unsigned int relation);
 
+	/* optional, must not sleep: -EAGAIN if target has to be used */
+	int	(*fast_switch)	(struct cpufreq_policy *policy,
+				 unsigned int target_freq,
+				 unsigned int relation);
+
 	/* should be defined, if possible */
 	unsigned int	(*get)	(unsigned int cpu);
 
@@ -364,6 +372,19 @@ extern struct cpufreq_governor cpufreq_gov_interactive;
 #elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_ADAPTIVE)
 extern struct cpufreq_governor cpufreq_gov_adaptive;
 #define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_adaptive)
+#elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED)
+extern struct cpufreq_governor cpufreq_gov_sched;
+#define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_sched)
+#endif
+
+/* called by the scheduler with the runqueue lock of cpu held */
+#ifdef CONFIG_CPU_FREQ_GOV_SCHED
+extern void cpufreq_sched_update(int cpu, unsigned long nr_running, u64 now);
+#else
+static inline void cpufreq_sched_update(int cpu, unsigned long nr_running,
+					u64 now)
+{
+}
 #endif
 
 
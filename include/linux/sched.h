@@ -1859,6 +1859,8 @@ extern void do_set_cpus_allowed(struct task_struct *p,
 
 extern int set_cpus_allowed_ptr(struct task_struct *p,
 				const struct cpumask *new_mask);
+extern int sched_cpu_park(unsigned int cpu, bool park);
+extern bool sched_cpu_parked(unsigned int cpu);
 #else
 static inline void do_set_cpus_allowed(struct task_struct *p,
 				      const struct cpumask *new_mask)
@@ -1871,6 +1873,14 @@ static inline int set_cpus_allowed_ptr(struct task_struct *p,
 		return -EINVAL;
 	return 0;
 }
+static inline int sched_cpu_park(unsigned int cpu, bool park)
+{
+	return -EINVAL;
+}
+static inline bool sched_cpu_parked(unsigned int cpu)
+{
+	return false;
+}
 #endif
 
 #ifndef CONFIG_CPUMASK_OFFSTACK
@@ -995,6 +995,13 @@ typedef enum {
 #define V4L2_CID_CAMERA_BUSFREQ_UNLOCK		(V4L2_CID_PRIVATE_BASE+126)
 #define V4L2_CID_EMBEDDEDDATA_ENABLE      (V4L2_CID_PRIVATE_BASE + 130)
 #define V4L2_CID_CAMERA_MODEL      (V4L2_CID_PRIVATE_BASE + 133)
+/* value: buffer index in, exported buffer fd out */
+#define V4L2_CID_CAPBUF_EXPORT     (V4L2_CID_PRIVATE_BASE + 140)
+
+/* jpeg encoder timing of the last, slowest and average job in usec */
+#define V4L2_CID_CAM_JPEG_ENC_TIME		(V4L2_CID_PRIVATE_BASE + 141)
+#define V4L2_CID_CAM_JPEG_ENC_TIME_MAX		(V4L2_CID_PRIVATE_BASE + 142)
+#define V4L2_CID_CAM_JPEG_ENC_TIME_AVG		(V4L2_CID_PRIVATE_BASE + 143)
 
 /*      Pixel format FOURCC depth  Description  */
 enum v4l2_pix_format_mode {
@@ -0,0 +1,43 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM busfreq
+
+#if !defined(_TRACE_BUSFREQ_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_BUSFREQ_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * Bus level change with the load which caused it. burst is set for
+ * changes made from a PPMU overflow interrupt rather than the sampling
+ * timer.
+ */
+TRACE_EVENT(busfreq_target,
+
+	TP_PROTO(unsigned long old_freq, unsigned long new_freq,
+		 unsigned int load, bool burst),
+
+	TP_ARGS(old_freq, new_freq, load, burst),
+
+	TP_STRUCT__entry(
+		__field(	unsigned long,	old_freq	)
+		__field(	unsigned long,	new_freq	)
+		__field(	unsigned int,	load		)
+		__field(	bool,		burst		)
+	),
+
+	TP_fast_assign(
+		__entry->old_freq	= old_freq;
+		__entry->new_freq	= new_freq;
+		__entry->load		= load;
+		__entry->burst		= burst;
+	),
+
+	TP_printk("old=%lu new=%lu load=%u %s", __entry->old_freq,
+		  __entry->new_freq, __entry->load,
+		  __entry->burst ? "burst" : "poll")
+);
+
+#endif /* _TRACE_BUSFREQ_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,75 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpu_hotplug
+
+#if !defined(_TRACE_CPU_HOTPLUG_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPU_HOTPLUG_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * One evaluation of the dynamic hotplug policy. avg_nr is the averaged
+ * nr_running in hundredths, the loads are percentages of the online CPUs.
+ */
+TRACE_EVENT(cpu_hotplug_sample,
+
+	TP_PROTO(unsigned int online, unsigned int nr_running,
+		 unsigned int avg_nr, unsigned int avg_load,
+		 unsigned int min_load),
+
+	TP_ARGS(online, nr_running, avg_nr, avg_load, min_load),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	online		)
+		__field(	unsigned int,	nr_running	)
+		__field(	unsigned int,	avg_nr		)
+		__field(	unsigned int,	avg_load	)
+		__field(	unsigned int,	min_load	)
+	),
+
+	TP_fast_assign(
+		__entry->online		= online;
+		__entry->nr_running	= nr_running;
+		__entry->avg_nr		= avg_nr;
+		__entry->avg_load	= avg_load;
+		__entry->min_load	= min_load;
+	),
+
+	TP_printk("online=%u nr_running=%u avg_nr=%u.%02u avg_load=%u min_load=%u",
+		  __entry->online, __entry->nr_running,
+		  __entry->avg_nr / 100, __entry->avg_nr % 100,
+		  __entry->avg_load, __entry->min_load)
+);
+
+/*
+ * A CPU the policy decided to plug in (up) or out, and why. park is set
+ * when the CPU is parked or unparked rather than taken offline or online.
+ */
+TRACE_EVENT(cpu_hotplug_decision,
+
+	TP_PROTO(unsigned int cpu, bool up, bool park, const char *reason),
+
+	TP_ARGS(cpu, up, park, reason),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	bool,		up		)
+		__field(	bool,		park		)
+		__string(	reason,		reason		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu	= cpu;
+		__entry->up	= up;
+		__entry->park	= park;
+		__assign_str(reason, reason);
+	),
+
+	TP_printk("cpu%u %s%s reason=%s", __entry->cpu,
+		  __entry->up ? "up" : "down",
+		  __entry->park ? " (park)" : "", __get_str(reason))
+);
+
+#endif /* _TRACE_CPU_HOTPLUG_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
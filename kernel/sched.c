@@ -72,6 +72,7 @@
 #include <linux/ftrace.h>
 #include <linux/slab.h>
 #include <linux/cpuacct.h>
+#include <linux/cpufreq.h>
 
 #include <asm/tlb.h>
 #include <asm/irq_regs.h>
@@ -1783,11 +1784,13 @@ static const struct sched_class rt_sched_class;
 static void inc_nr_running(struct rq *rq)
 {
 	rq->nr_running++;
+	cpufreq_sched_update(cpu_of(rq), rq->nr_running, rq->clock);
 }
 
 static void dec_nr_running(struct rq *rq)
 {
 	rq->nr_running--;
+	cpufreq_sched_update(cpu_of(rq), rq->nr_running, rq->clock);
 }
 
 static void set_load_weight(struct task_struct *p)
@@ -2423,6 +2426,10 @@ int select_task_rq(struct task_struct *p, int sd_flags, int wake_flags)
 	if (unlikely(!cpumask_test_cpu(cpu, &p->cpus_allowed) ||
 		     !cpu_online(cpu)))
 		cpu = select_fallback_rq(task_cpu(p), p);
+	/* keep tasks off a parked cpu unless they are bound to it */
+	else if (unlikely(!cpu_active(cpu)) &&
+		 cpumask_intersects(&p->cpus_allowed, cpu_active_mask))
+		cpu = select_fallback_rq(cpu, p);
 
 	return cpu;
 }
@@ -4075,6 +4082,7 @@ void scheduler_tick(void)
 	update_rq_clock(rq);
 	update_cpu_load_active(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
+	cpufreq_sched_update(cpu, rq->nr_running, rq->clock);
 	raw_spin_unlock(&rq->lock);
 
 	perf_event_task_tick();
@@ -6127,6 +6135,86 @@ static int migration_cpu_stop(void *data)
 	return 0;
 }
 
+/*
+ * CPU parking: a parked cpu stays online but is taken out of cpu_active_mask
+ * and the sched domains, so that it only runs the kthreads bound to it and
+ * otherwise sits in idle. Unlike cpu_down() no notifier chain is run and the
+ * cpu can be unparked within a sched domain rebuild.
+ */
+static DEFINE_MUTEX(sched_park_mutex);
+
+/*
+ * Push every task which may run on an active cpu off the parked cpu;
+ * tasks bound to it stay, sleeping tasks are moved by select_task_rq().
+ */
+static int sched_park_cpu_stop(void *data)
+{
+	unsigned int cpu = raw_smp_processor_id();
+	struct task_struct *g, *p;
+
+	rcu_read_lock();
+	do_each_thread(g, p) {
+		if (p == current || task_cpu(p) != cpu || !p->on_rq)
+			continue;
+		if (!cpumask_intersects(&p->cpus_allowed, cpu_active_mask))
+			continue;
+
+		local_irq_disable();
+		__migrate_task(p, cpu, select_fallback_rq(cpu, p));
+		local_irq_enable();
+	} while_each_thread(g, p);
+	rcu_read_unlock();
+
+	return 0;
+}
+
+/**
+ * sched_cpu_park - park or unpark an online cpu
+ * @cpu: cpu other than the boot cpu
+ * @park: true to park, false to unpark
+ */
+int sched_cpu_park(unsigned int cpu, bool park)
+{
+	int ret = 0;
+
+	if (!cpu || cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	mutex_lock(&sched_park_mutex);
+	get_online_cpus();
+
+	if (!cpu_online(cpu)) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	if (cpu_active(cpu) != park)
+		goto out;
+
+	if (park && num_active_cpus() == 1) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	set_cpu_active(cpu, !park);
+	cpuset_update_active_cpus();
+
+	if (park)
+		stop_one_cpu(cpu, sched_park_cpu_stop, NULL);
+out:
+	put_online_cpus();
+	mutex_unlock(&sched_park_mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sched_cpu_park);
+
+bool sched_cpu_parked(unsigned int cpu)
+{
+	return cpu_online(cpu) && !cpu_active(cpu);
+}
+EXPORT_SYMBOL_GPL(sched_cpu_parked);
+
 #ifdef CONFIG_HOTPLUG_CPU
 
 /*